@@ -0,0 +1,87 @@
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "zaf/zaf.hpp"
+
+// Usage: ActorSpawnBenchmark [num_actors] [num_blocking_actors]
+//
+// Measures the time to spawn idle actors on an ActorSystem and the resident memory each
+// of them costs, for actors run by the default scheduler versus blocking actors that are
+// run on dedicated threads. Each actor waits for one message before it terminates.
+// Each actor owns an eventfd, so the limit of open files is raised as much as allowed.
+
+using Clock = std::chrono::steady_clock;
+
+class Idle : public zaf::ActorBehavior {
+public:
+  zaf::MessageHandlers behavior() override {
+    return {
+      zaf::Code{0} - [&]() {
+        this->deactivate();
+      }
+    };
+  }
+};
+
+class BlockingIdle : public Idle {
+public:
+  bool is_blocking() const override {
+    return true;
+  }
+};
+
+size_t resident_bytes() {
+  std::ifstream statm("/proc/self/statm");
+  size_t pages = 0, resident = 0;
+  statm >> pages >> resident;
+  return resident * sysconf(_SC_PAGESIZE);
+}
+
+template<typename ActorType>
+void bench(const char* name, int n_actors) {
+  zaf::ActorSystem actor_system;
+  auto sender = actor_system.create_scoped_actor();
+  // start the scheduler before measuring
+  sender->send(actor_system.spawn<Idle>(), 0);
+  std::vector<zaf::Actor> actors;
+  actors.reserve(n_actors);
+
+  auto mem_before = resident_bytes();
+  auto start = Clock::now();
+  for (int i = 0; i < n_actors; i++) {
+    actors.emplace_back(actor_system.spawn<ActorType>());
+  }
+  auto spawn_end = Clock::now();
+  auto mem_after = resident_bytes();
+
+  for (auto& a : actors) {
+    sender->send(a, 0);
+  }
+  sender = nullptr;
+  actor_system.await_all_actors_done();
+  auto end = Clock::now();
+
+  auto spawn_us = std::chrono::duration_cast<std::chrono::microseconds>(spawn_end - start).count();
+  auto total_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+  LOG(INFO) << name << ": " << n_actors << " actors spawned in " << spawn_us << "us ("
+    << double(spawn_us) / n_actors << "us per actor), "
+    << (mem_after > mem_before ? (mem_after - mem_before) / n_actors : 0) << " bytes per actor, "
+    << total_ms << "ms until all actors are done";
+}
+
+int main(int argc, char** argv) {
+  int n_actors = argc > 1 ? std::atoi(argv[1]) : 10000;
+  int n_blocking_actors = argc > 2 ? std::atoi(argv[2]) : 1000;
+  rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+  bench<Idle>("Scheduled", n_actors);
+  bench<BlockingIdle>("Blocking", n_blocking_actors);
+}
@@ -0,0 +1,97 @@
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "zaf/zaf.hpp"
+
+// Usage: HandlerDispatchBenchmark [num_dispatches]
+//
+// Measures the ns/op to dispatch a message to its handler via MessageHandlers,
+// versus a handler set that looks up a hash map per level of child handlers.
+// As ActorBehavior does, the user handlers are the child of a handler set with
+// a few DefaultCodes handlers. Both dense codes (0, 1, 2, ...) and sparse codes
+// are measured for different numbers of handlers.
+
+using Clock = std::chrono::steady_clock;
+
+// the hash map per level layout of handlers
+class HashMapHandlers {
+public:
+  template<typename ... CodeHandler>
+  HashMapHandlers(CodeHandler&& ... code_handlers) {
+    (handlers.emplace(std::forward<CodeHandler>(code_handlers)), ...);
+  }
+
+  void add(std::pair<size_t, std::unique_ptr<zaf::MessageHandler>>&& code_handler) {
+    handlers.emplace(std::move(code_handler));
+  }
+
+  bool try_process(zaf::Message& m) {
+    auto iter = handlers.find(m.get_body().get_code());
+    if (iter != handlers.end()) {
+      iter->second->process_body(m.get_body());
+      return true;
+    }
+    return child && child->try_process(m);
+  }
+
+  DefaultHashMap<size_t, std::unique_ptr<zaf::MessageHandler>> handlers;
+  HashMapHandlers* child = nullptr;
+};
+
+template<typename Handlers>
+void bench(const char* name, Handlers& handlers, std::vector<zaf::Message*>& messages,
+  long& sum, int n) {
+  auto start = Clock::now();
+  for (int i = 0; i < n; i++) {
+    handlers.try_process(*messages[i % messages.size()]);
+  }
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+  LOG(INFO) << name << ": " << double(ns) / n << " ns/op (checksum " << sum << ")";
+}
+
+void bench(int num_codes, size_t code_stride, int n) {
+  long sum = 0;
+  auto handler = [&](int v) { sum += v; };
+  auto system_handler = [&]() {};
+
+  HashMapHandlers hash_inner{
+    zaf::DefaultCodes::Request - system_handler,
+    zaf::DefaultCodes::Response - system_handler,
+    zaf::DefaultCodes::SWSRMsgQueueRegistration - system_handler
+  };
+  HashMapHandlers hash_user;
+  hash_inner.child = &hash_user;
+
+  zaf::MessageHandlers flat_inner{
+    zaf::DefaultCodes::Request - system_handler,
+    zaf::DefaultCodes::Response - system_handler,
+    zaf::DefaultCodes::SWSRMsgQueueRegistration - system_handler
+  };
+  zaf::MessageHandlers flat_user;
+
+  std::vector<zaf::Message*> messages;
+  for (int i = 0; i < num_codes; i++) {
+    zaf::Code code{i * code_stride};
+    hash_user.add(code - handler);
+    flat_user.add_handlers(code - handler);
+    messages.push_back(zaf::new_message(nullptr, code, i));
+  }
+  flat_inner.add_child_handlers(flat_user);
+
+  LOG(INFO) << num_codes << " handlers, code stride " << code_stride;
+  bench("  Hash map per level", hash_inner, messages, sum, n);
+  bench("  MessageHandlers", flat_inner, messages, sum, n);
+  for (auto m : messages) {
+    delete m;
+  }
+}
+
+int main(int argc, char** argv) {
+  int n = argc > 1 ? std::atoi(argv[1]) : 10000000;
+  for (int num_codes : {4, 16, 64}) {
+    bench(num_codes, 1, n);
+    bench(num_codes, 1000003, n);
+  }
+}
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "zaf/zaf.hpp"
+
+// Based on examples/load_rebalance.cpp.
+// Actors of different work durations are spawned on an ActorEngine so that
+// some executors get more work than others. Compares the duration and the
+// latency of messages (from being sent to being processed) among
+// 1. Polling scheduling without load rebalance,
+// 2. Polling scheduling with load rebalance,
+// 3. WorkStealing scheduling.
+
+using Clock = std::chrono::steady_clock;
+
+class X : public zaf::ActorBehavior {
+public:
+  X(std::chrono::microseconds work_duration,
+    std::vector<long>& latencies, std::mutex& latencies_mutex):
+    work_duration(work_duration),
+    latencies(latencies),
+    latencies_mutex(latencies_mutex) {
+  }
+
+  void start() override {
+    this->send(*this, 0, size_t(0), Clock::now());
+  }
+
+  zaf::MessageHandlers behavior() override {
+    return {
+      zaf::Code{0} - [&](size_t i, Clock::time_point sent) {
+        local_latencies.push_back(
+          std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - sent).count());
+        // busy work
+        for (auto e = Clock::now() + work_duration; Clock::now() < e;);
+        if (i == 200) {
+          this->deactivate();
+        } else {
+          this->send(*this, 0, i + 1, Clock::now());
+        }
+      }
+    };
+  }
+
+  void stop() override {
+    std::lock_guard<std::mutex> _(latencies_mutex);
+    latencies.insert(latencies.end(), local_latencies.begin(), local_latencies.end());
+  }
+
+  const std::chrono::microseconds work_duration;
+  std::vector<long> local_latencies;
+  std::vector<long>& latencies;
+  std::mutex& latencies_mutex;
+};
+
+template<typename Setup>
+void bench(const char* name, zaf::ActorSystem& actor_system,
+  zaf::ActorEngine::Scheduling scheduling, Setup&& setup) {
+  const int num_executors = 4;
+  for (int trial = 0; trial < 3; trial++) {
+    std::vector<long> latencies;
+    std::mutex latencies_mutex;
+    zaf::ActorEngine engine{actor_system, num_executors, scheduling};
+    setup(engine);
+
+    auto start = Clock::now();
+    for (int i = 0; i < num_executors; i++) {
+      for (int j = 0; j < num_executors; j++) {
+        // actors spawned in round-robin, executor j gets the actors of duration (j + 1) * 200us
+        engine.spawn<X>(std::chrono::microseconds{(j + 1) * 200}, latencies, latencies_mutex);
+      }
+    }
+    engine.await_all_actors_done();
+    auto end = Clock::now();
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+      return latencies.empty() ? 0 : latencies[std::min(latencies.size() - 1, size_t(latencies.size() * p))];
+    };
+    LOG(INFO) << name << " (trial " << (trial + 1) << "): "
+      << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << "ms"
+      << ", latency p50: " << percentile(0.5) << "us"
+      << ", p99: " << percentile(0.99) << "us"
+      << ", max: " << (latencies.empty() ? 0 : latencies.back()) << "us";
+  }
+}
+
+int main() {
+  zaf::ActorSystem actor_system;
+
+  bench("Polling w/o load rebalance", actor_system,
+    zaf::ActorEngine::Scheduling::Polling, [](auto&) {});
+
+  bench("Polling w/ load rebalance", actor_system,
+    zaf::ActorEngine::Scheduling::Polling, [](auto& engine) {
+      engine.set_load_diff_ratio(0.1);
+      engine.set_load_rebalance_period(10);
+    });
+
+  bench("WorkStealing", actor_system,
+    zaf::ActorEngine::Scheduling::WorkStealing, [](auto&) {});
+
+  LOG(INFO) << "Best duration should be " << (1 + 4) * 4 / 2 * 200 * 200 / 1000 << "ms";
+}
@@ -0,0 +1,129 @@
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "zaf/zaf.hpp"
+#include "zaf/mailbox.hpp"
+#include "zaf/message_pool.hpp"
+
+#include "zmq.hpp"
+
+// Usage: LocalDeliveryBenchmark [num_senders] [num_messages_per_sender]
+//
+// Compares the messages/sec of local delivery with
+// 1. the ZMQ inproc ROUTER sockets that carry message pointers, i.e., the transport
+//    used by ZAF before Mailbox,
+// 2. Mailbox,
+// 3. actors spawned by ActorSystem, i.e., Mailbox plus message dispatching.
+// Each sender sends messages to a single receiver.
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+void report(const char* name, size_t num_msgs, Clock::time_point start) {
+  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+  LOG(INFO) << name << ": " << num_msgs << " messages in " << ms << "ms, "
+    << (ms == 0 ? 0 : num_msgs * 1000 / ms) << " messages/sec";
+}
+
+void bench_zmq_router(int n_send, int n_msg) {
+  zmq::context_t context;
+  zmq::socket_t recv_socket(context, zmq::socket_type::router);
+  recv_socket.set(zmq::sockopt::routing_id, zmq::str_buffer("R"));
+  recv_socket.bind("inproc://local_delivery_benchmark");
+
+  auto start = Clock::now();
+  std::vector<std::thread> senders;
+  for (int i = 0; i < n_send; i++) {
+    senders.emplace_back([&, i]() {
+      zmq::socket_t send_socket(context, zmq::socket_type::router);
+      send_socket.set(zmq::sockopt::routing_id, zmq::buffer(std::to_string(i)));
+      send_socket.set(zmq::sockopt::sndhwm, 0);
+      send_socket.connect("inproc://local_delivery_benchmark");
+      for (int j = 0; j < n_msg; j++) {
+        auto m = zaf::new_message(nullptr, zaf::Code{0}, j);
+        send_socket.send(zmq::str_buffer("R"), zmq::send_flags::sndmore);
+        send_socket.send(zmq::const_buffer(&m, sizeof(m)));
+      }
+    });
+  }
+  zmq::message_t routing_id, ptr;
+  for (size_t k = 0, n = size_t(n_send) * n_msg; k < n; k++) {
+    (void) recv_socket.recv(routing_id);
+    (void) recv_socket.recv(ptr);
+    delete *ptr.data<zaf::Message*>();
+  }
+  report("ZMQ inproc ROUTER", size_t(n_send) * n_msg, start);
+  for (auto& s : senders) {
+    s.join();
+  }
+}
+
+void bench_mailbox(int n_send, int n_msg) {
+  zaf::Mailbox mailbox;
+  auto start = Clock::now();
+  std::vector<std::thread> senders;
+  for (int i = 0; i < n_send; i++) {
+    senders.emplace_back([&]() {
+      for (int j = 0; j < n_msg; j++) {
+        mailbox.push(zaf::new_message(nullptr, zaf::Code{0}, j));
+      }
+    });
+  }
+  std::vector<zmq::pollitem_t> poll_items{mailbox.get_poll_item()};
+  for (size_t k = 0, n = size_t(n_send) * n_msg; k < n;) {
+    if (auto m = mailbox.try_pop()) {
+      delete m;
+      ++k;
+    } else if (mailbox.prepare_wait()) {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+      zmq::poll(poll_items);
+#pragma GCC diagnostic pop
+    }
+  }
+  report("Mailbox", size_t(n_send) * n_msg, start);
+  for (auto& s : senders) {
+    s.join();
+  }
+}
+
+void bench_actors(int n_send, int n_msg) {
+  zaf::ActorSystem system;
+  auto receiver = system.spawn([=](zaf::ActorBehavior& self) {
+    size_t num_recv = 0, n = size_t(n_send) * n_msg;
+    self.receive({
+      zaf::Code{0} - [&](int) {
+        if (++num_recv == n) {
+          self.deactivate();
+        }
+      }
+    });
+  });
+  auto start = Clock::now();
+  for (int i = 0; i < n_send; i++) {
+    system.spawn([=](zaf::ActorBehavior& self) {
+      for (int j = 0; j < n_msg; j++) {
+        self.send(receiver, zaf::Code{0}, j);
+      }
+    });
+  }
+  system.await_all_actors_done();
+  report("ActorSystem", size_t(n_send) * n_msg, start);
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  int n_send = argc > 1 ? std::atoi(argv[1]) : 4;
+  int n_msg = argc > 2 ? std::atoi(argv[2]) : 1000000;
+  bench_zmq_router(n_send, n_msg);
+  bench_mailbox(n_send, n_msg);
+  bench_actors(n_send, n_msg);
+  auto stats = zaf::MessagePool::get_stats();
+  LOG(INFO) << "MessagePool: " << stats.num_allocations << " allocations, "
+    << stats.num_reuses << " reuses, "
+    << stats.num_remote_deallocations << " remote deallocations, "
+    << stats.num_returned_batches << " returned batches";
+}
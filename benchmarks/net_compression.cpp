@@ -0,0 +1,145 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "zaf/zaf.hpp"
+#include "zaf/compression.hpp"
+#include "zaf/net_gate_client.hpp"
+
+// Usage: NetCompressionBenchmark [num_messages] [payload_bytes]
+//
+// Compares NetGate batches without compression and with LZ4 (if ZAF is built with ENABLE_LZ4)
+// for compressible payloads, i.e., repetitive text records, and incompressible payloads,
+// i.e., random bytes.
+// 1. The CPU cost of the codec: MB/s of compressing and decompressing 1MB batches,
+//    and the ratio of the compressed bytes to the raw bytes.
+// 2. The MB/s of payload sent between two ActorSystems through their NetGates on 127.0.0.1.
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+std::vector<char> make_payload(size_t size, bool compressible, std::mt19937& rand) {
+  std::vector<char> payload;
+  payload.reserve(size);
+  if (compressible) {
+    while (payload.size() < size) {
+      auto record = "{\"id\":" + std::to_string(rand() % 1000) + ",\"status\":\"OK\",\"region\":\"eu-west\"}";
+      payload.insert(payload.end(), record.begin(), record.end());
+    }
+    payload.resize(size);
+  } else {
+    while (payload.size() < size) {
+      payload.push_back(char(rand()));
+    }
+  }
+  return payload;
+}
+
+const char* name_of(zaf::Compression codec) {
+  return codec == zaf::Compression::LZ4 ? "LZ4" : "None";
+}
+
+void bench_codec(zaf::Compression codec, bool compressible) {
+  std::mt19937 rand(0);
+  auto batch = make_payload(1 << 20, compressible, rand);
+  std::vector<char> compressed(zaf::compression::max_compressed_size(codec, batch.size()));
+  std::vector<char> decompressed(batch.size());
+  const int rounds = 100;
+  size_t size = 0;
+  auto start = Clock::now();
+  for (int i = 0; i < rounds; i++) {
+    size = zaf::compression::compress(codec, batch.data(), batch.size(),
+      compressed.data(), compressed.size());
+  }
+  auto compress_us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+  start = Clock::now();
+  for (int i = 0; i < rounds; i++) {
+    zaf::compression::decompress(codec, compressed.data(), size,
+      decompressed.data(), decompressed.size());
+  }
+  auto decompress_us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+  auto total = rounds * batch.size();
+  LOG(INFO) << name_of(codec) << (compressible ? ", compressible" : ", incompressible")
+    << ": compressed to " << size * 100 / batch.size() << "% of raw bytes, compress "
+    << (compress_us == 0 ? 0 : total / compress_us) << " MB/s, decompress "
+    << (decompress_us == 0 ? 0 : total / decompress_us) << " MB/s";
+}
+
+void bench_net(zaf::Compression codec, bool compressible, int port_base, size_t n_msg,
+  size_t payload_bytes) {
+  zaf::NetGate::Options options;
+  options.compression = codec;
+  Clock::time_point start, end;
+  std::thread machine_a([&]() {
+    zaf::ActorSystem actor_system;
+    zaf::NetGate gate{actor_system, "127.0.0.1", port_base, options};
+    auto sender = actor_system.create_scoped_actor();
+    zaf::NetGateClient client{gate.actor()};
+    client.register_actor(*sender, "Sink", actor_system.spawn([&](zaf::ActorBehavior& self) {
+      for (size_t i = 0; i < n_msg; i++) {
+        self.receive_once({
+          zaf::Code{0} - [&](zaf::BytesView) {}
+        });
+      }
+      end = Clock::now();
+    }));
+  });
+  std::thread machine_b([&]() {
+    zaf::ActorSystem actor_system;
+    zaf::NetGate gate{actor_system, "127.0.0.1", port_base + 1, options};
+    actor_system.spawn([&, n = zaf::NetGateClient{gate.actor()}](zaf::ActorBehaviorX& self) {
+      zaf::Actor sink;
+      n.lookup_actor(zaf::Requester{self}, "127.0.0.1:" + std::to_string(port_base), "Sink").on_reply({
+        n.on_lookup_actor_reply([&](zaf::Actor remote_sink) {
+          sink = remote_sink;
+        })
+      });
+      std::mt19937 rand(0);
+      std::vector<std::vector<char>> payloads;
+      for (int i = 0; i < 64; i++) {
+        payloads.push_back(make_payload(payload_bytes, compressible, rand));
+      }
+      start = Clock::now();
+      for (size_t i = 0; i < n_msg; i++) {
+        self.send(sink, 0, payloads[i % payloads.size()]);
+      }
+      self.deactivate();
+    });
+  });
+  machine_a.join();
+  machine_b.join();
+  auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+  auto num_bytes = n_msg * payload_bytes;
+  LOG(INFO) << name_of(codec) << (compressible ? ", compressible" : ", incompressible")
+    << ": " << num_bytes << " bytes in " << us << "us, "
+    << (us <= 0 ? 0 : num_bytes / us) << " MB/s";
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  size_t n_msg = argc > 1 ? std::atoll(argv[1]) : 500000;
+  size_t payload_bytes = argc > 2 ? std::atoll(argv[2]) : 256;
+  std::vector<zaf::Compression> codecs{zaf::Compression::None};
+  if (zaf::compression::is_supported(zaf::Compression::LZ4)) {
+    codecs.push_back(zaf::Compression::LZ4);
+  } else {
+    LOG(INFO) << "ZAF is built without LZ4, only uncompressed batches are measured";
+  }
+  for (auto codec : codecs) {
+    for (bool compressible : {true, false}) {
+      bench_codec(codec, compressible);
+    }
+  }
+  LOG(INFO) << "Messages: " << n_msg << ", payload bytes: " << payload_bytes;
+  int port_base = 15790;
+  for (auto codec : codecs) {
+    for (bool compressible : {true, false}) {
+      bench_net(codec, compressible, port_base, n_msg, payload_bytes);
+      port_base += 2;
+    }
+  }
+}
@@ -0,0 +1,97 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "zaf/zaf.hpp"
+#include "zaf/net_gate_client.hpp"
+
+// Usage: NetLanesBenchmark [max_num_lanes] [num_pairs] [num_messages_per_pair] [payload_bytes]
+//
+// Two ActorSystems in one process, each with its own NetGate on 127.0.0.1.
+// `num_pairs` actors in the second system each send messages to their own actor
+// in the first one. Messages are striped across the lanes by the receiving actors.
+// Reports the MB/s of payload for 1, 2, 4, ... up to `max_num_lanes` lanes.
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+int64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    Clock::now().time_since_epoch()).count();
+}
+
+void update_min(std::atomic<int64_t>& a, int64_t v) {
+  for (auto x = a.load(); v < x && !a.compare_exchange_weak(x, v););
+}
+
+void update_max(std::atomic<int64_t>& a, int64_t v) {
+  for (auto x = a.load(); v > x && !a.compare_exchange_weak(x, v););
+}
+
+void bench(unsigned num_lanes, int port_base, int n_pair, size_t n_msg, size_t payload_bytes) {
+  std::atomic<int64_t> start_ns{std::numeric_limits<int64_t>::max()};
+  std::atomic<int64_t> end_ns{0};
+  std::thread machine_a([&]() {
+    zaf::ActorSystem actor_system;
+    zaf::NetGate gate{actor_system, "127.0.0.1", port_base, zaf::NetGate::FlushPolicy{}, num_lanes};
+    auto sender = actor_system.create_scoped_actor();
+    zaf::NetGateClient client{gate.actor()};
+    for (int i = 0; i < n_pair; i++) {
+      client.register_actor(*sender, "Sink" + std::to_string(i),
+        actor_system.spawn([&](zaf::ActorBehavior& self) {
+          for (size_t j = 0; j < n_msg; j++) {
+            self.receive_once({
+              zaf::Code{0} - [&](zaf::BytesView) {}
+            });
+          }
+          update_max(end_ns, now_ns());
+        }));
+    }
+  });
+  std::thread machine_b([&]() {
+    zaf::ActorSystem actor_system;
+    zaf::NetGate gate{actor_system, "127.0.0.1", port_base + 1, zaf::NetGate::FlushPolicy{}, num_lanes};
+    auto url = "127.0.0.1:" + std::to_string(port_base);
+    for (int i = 0; i < n_pair; i++) {
+      actor_system.spawn([&, i, n = zaf::NetGateClient{gate.actor()}](zaf::ActorBehaviorX& self) {
+        zaf::Actor sink;
+        n.lookup_actor(zaf::Requester{self}, url, "Sink" + std::to_string(i)).on_reply({
+          n.on_lookup_actor_reply([&](zaf::Actor remote_sink) {
+            sink = remote_sink;
+          })
+        });
+        update_min(start_ns, now_ns());
+        std::vector<char> payload(payload_bytes);
+        for (size_t j = 0; j < n_msg; j++) {
+          self.send(sink, 0, payload);
+        }
+        self.deactivate();
+      });
+    }
+  });
+  machine_a.join();
+  machine_b.join();
+  auto us = (end_ns.load() - start_ns.load()) / 1000;
+  auto num_bytes = n_pair * n_msg * payload_bytes;
+  LOG(INFO) << num_lanes << " lane(s): " << num_bytes << " bytes in " << us << "us, "
+    << (us <= 0 ? 0 : num_bytes / us) << " MB/s";
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  unsigned max_lanes = argc > 1 ? std::atoi(argv[1]) : 4;
+  int n_pair = argc > 2 ? std::atoi(argv[2]) : 8;
+  size_t n_msg = argc > 3 ? std::atoll(argv[3]) : 200000;
+  size_t payload_bytes = argc > 4 ? std::atoll(argv[4]) : 256;
+  LOG(INFO) << "Pairs: " << n_pair << ", messages per pair: " << n_msg
+    << ", payload bytes: " << payload_bytes;
+  int port_base = 14680;
+  for (unsigned lanes = 1; lanes <= max_lanes; lanes *= 2, port_base += 2) {
+    bench(lanes, port_base, n_pair, n_msg, payload_bytes);
+  }
+}
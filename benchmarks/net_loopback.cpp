@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "zaf/zaf.hpp"
+#include "zaf/net_gate_client.hpp"
+
+// Usage: NetLoopbackBenchmark [num_messages] [payload_bytes] [max_linger_us] [max_batch_bytes]
+//
+// Two ActorSystems in one process, each with its own NetGate on 127.0.0.1.
+// An actor in the second system sends messages to an actor in the first one through
+// the NetGates. Reports the MB/s of payload received and the latency of messages,
+// i.e., from being sent to being handled. The flush policy of the sending NetGate
+// is set by `max_linger_us` and `max_batch_bytes`.
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+int64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    Clock::now().time_since_epoch()).count();
+}
+
+class Sink : public zaf::ActorBehavior {
+public:
+  Sink(size_t num_messages):
+    num_messages(num_messages) {
+    latencies.reserve(num_messages);
+  }
+
+  zaf::MessageHandlers behavior() override {
+    return {
+      zaf::Code{0} - [&](int64_t sent_ns, zaf::BytesView payload) {
+        auto now = Clock::now();
+        if (latencies.empty()) {
+          start = now;
+        }
+        latencies.push_back(now_ns() - sent_ns);
+        num_bytes += payload.size();
+        if (latencies.size() == num_messages) {
+          report(now);
+          this->deactivate();
+        }
+      }
+    };
+  }
+
+  void report(Clock::time_point end) {
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+      return latencies[std::min(latencies.size() - 1, size_t(latencies.size() * p))] / 1000;
+    };
+    LOG(INFO) << num_messages << " messages, " << num_bytes << " bytes in " << us << "us, "
+      << (us == 0 ? 0 : num_bytes / us) << " MB/s, latency p50 "
+      << percentile(0.5) << "us, p99 " << percentile(0.99) << "us";
+  }
+
+  const size_t num_messages;
+  size_t num_bytes = 0;
+  Clock::time_point start;
+  std::vector<int64_t> latencies;
+};
+} // namespace
+
+int main(int argc, char** argv) {
+  size_t n_msg = argc > 1 ? std::atoll(argv[1]) : 1000000;
+  size_t payload_bytes = argc > 2 ? std::atoll(argv[2]) : 64;
+  zaf::NetGate::FlushPolicy flush_policy;
+  if (argc > 3) {
+    flush_policy.max_linger = std::chrono::microseconds{std::atoll(argv[3])};
+  }
+  if (argc > 4) {
+    flush_policy.max_bytes = std::atoll(argv[4]);
+  }
+  LOG(INFO) << "Messages: " << n_msg << ", payload bytes: " << payload_bytes
+    << ", max linger: " << flush_policy.max_linger.count() << "us"
+    << ", max batch bytes: " << flush_policy.max_bytes;
+
+  std::thread machine_a([&]() {
+    zaf::ActorSystem actor_system;
+    zaf::NetGate gate{actor_system, "127.0.0.1", 13579};
+    auto sender = actor_system.create_scoped_actor();
+    zaf::NetGateClient client{gate.actor()};
+    client.register_actor(*sender, "Sink", actor_system.spawn<Sink>(n_msg));
+  });
+  std::thread machine_b([&]() {
+    zaf::ActorSystem actor_system;
+    zaf::NetGate gate{actor_system, "127.0.0.1", 24680, flush_policy};
+    actor_system.spawn([&, n = zaf::NetGateClient{gate.actor()}](zaf::ActorBehaviorX& self) {
+      zaf::Actor sink;
+      n.lookup_actor(zaf::Requester{self}, "127.0.0.1:13579", "Sink").on_reply({
+        n.on_lookup_actor_reply([&](zaf::Actor remote_sink) {
+          sink = remote_sink;
+        })
+      });
+      std::vector<char> payload(payload_bytes);
+      for (size_t i = 0; i < n_msg; i++) {
+        self.send(sink, 0, now_ns(), payload);
+      }
+      self.deactivate();
+    });
+  });
+  machine_a.join();
+  machine_b.join();
+}
@@ -0,0 +1,76 @@
+#include <chrono>
+#include <cstdlib>
+
+#include "zaf/zaf.hpp"
+
+// Usage: ReceiveBatchBenchmark [num_messages_per_sender]
+//
+// Measures the messages/sec of actors on an ActorEngine when an actor processes
+// one message per wakeup (max_messages_per_run = 1) versus a burst of messages
+// per wakeup (ActorBehavior::receive_batch), for both scheduling modes.
+// Each sender sends to one receiver, and senders and receivers share the executors.
+
+using Clock = std::chrono::steady_clock;
+
+class Sender : public zaf::ActorBehavior {
+public:
+  Sender(zaf::Actor receiver, int n_msg):
+    receiver(receiver),
+    n_msg(n_msg) {
+  }
+
+  void start() override {
+    for (int i = 0; i < n_msg; i++) {
+      this->send(receiver, 0, i);
+    }
+    this->send(receiver, 1);
+    this->deactivate();
+  }
+
+  zaf::Actor receiver;
+  const int n_msg;
+};
+
+class Receiver : public zaf::ActorBehavior {
+public:
+  zaf::MessageHandlers behavior() override {
+    return {
+      zaf::Code{0} - [&](int i) {
+        sum += i;
+      },
+      zaf::Code{1} - [&]() {
+        this->deactivate();
+      }
+    };
+  }
+
+  long sum = 0;
+};
+
+void bench(zaf::ActorSystem& actor_system, zaf::ActorEngine::Scheduling scheduling,
+  const char* name, size_t max_messages_per_run, int n_msg) {
+  const int num_executors = 4, num_pairs = 8;
+  zaf::ActorEngine engine{actor_system, num_executors, scheduling};
+  engine.set_max_messages_per_run(max_messages_per_run);
+  auto start = Clock::now();
+  for (int i = 0; i < num_pairs; i++) {
+    engine.spawn<Sender>(engine.spawn<Receiver>(), n_msg);
+  }
+  engine.await_all_actors_done();
+  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+  size_t num_msgs = size_t(num_pairs) * n_msg;
+  LOG(INFO) << name << ", max_messages_per_run = " << max_messages_per_run << ": "
+    << num_msgs << " messages in " << ms << "ms, "
+    << (ms == 0 ? 0 : num_msgs * 1000 / ms) << " messages/sec";
+}
+
+int main(int argc, char** argv) {
+  int n_msg = argc > 1 ? std::atoi(argv[1]) : 1000000;
+  zaf::ActorSystem actor_system;
+  for (size_t batch : {1, 16, 64, 256}) {
+    bench(actor_system, zaf::ActorEngine::Scheduling::Polling, "Polling", batch, n_msg);
+  }
+  for (size_t batch : {1, 16, 64, 256}) {
+    bench(actor_system, zaf::ActorEngine::Scheduling::WorkStealing, "WorkStealing", batch, n_msg);
+  }
+}
@@ -0,0 +1,92 @@
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+
+#include "zaf/zaf.hpp"
+
+// Usage: SerializationBenchmark [total_megabytes_per_case]
+//
+// Measures the MB/s to serialize and deserialize std::vector of ints, doubles and structs
+// of 1KB to 64MB, with the bulk path for vectors of POD elements (one memcpy per vector)
+// versus writing and reading the elements one by one.
+
+using Clock = std::chrono::steady_clock;
+
+struct Point {
+  int x;
+  double y;
+  char tag[4];
+};
+
+template<typename E>
+void serialize_elementwise(zaf::Serializer& s, const std::vector<E>& v) {
+  s.write(v.size());
+  for (auto& e : v) {
+    s.write(e);
+  }
+}
+
+template<typename E>
+std::vector<E> deserialize_elementwise(zaf::Deserializer& d) {
+  std::vector<E> v;
+  auto size = d.read<size_t>();
+  v.reserve(size);
+  for (size_t i = 0; i < size; i++) {
+    v.emplace_back(d.read<E>());
+  }
+  return v;
+}
+
+double to_mb_per_sec(size_t num_bytes, Clock::duration d) {
+  auto us = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+  return us == 0 ? 0 : double(num_bytes) / us;
+}
+
+template<typename E>
+void bench(const char* type, size_t num_bytes, size_t total_bytes) {
+  std::vector<E> v(num_bytes / sizeof(E));
+  for (size_t i = 0; i < v.size(); i++) {
+    reinterpret_cast<char*>(v.data())[i * sizeof(E)] = char(i);
+  }
+  const size_t rounds = std::max<size_t>(1, total_bytes / num_bytes);
+  std::vector<char> bytes;
+  bytes.reserve(num_bytes + sizeof(size_t));
+  size_t checksum = 0;
+
+  Clock::duration bulk_write{0}, bulk_read{0}, elem_write{0}, elem_read{0};
+  for (size_t r = 0; r < rounds; r++) {
+    bytes.clear();
+    auto start = Clock::now();
+    zaf::Serializer(bytes).write(v);
+    bulk_write += Clock::now() - start;
+    start = Clock::now();
+    zaf::Deserializer d(bytes);
+    checksum += d.read<std::vector<E>>().size();
+    bulk_read += Clock::now() - start;
+
+    bytes.clear();
+    start = Clock::now();
+    zaf::Serializer s(bytes);
+    serialize_elementwise(s, v);
+    elem_write += Clock::now() - start;
+    start = Clock::now();
+    zaf::Deserializer e(bytes);
+    checksum += deserialize_elementwise<E>(e).size();
+    elem_read += Clock::now() - start;
+  }
+  auto n = rounds * num_bytes;
+  LOG(INFO) << type << " x " << v.size() << " (" << num_bytes / 1024 << "KB), "
+    << "bulk: write " << to_mb_per_sec(n, bulk_write) << " MB/s, read "
+    << to_mb_per_sec(n, bulk_read) << " MB/s; "
+    << "element-wise: write " << to_mb_per_sec(n, elem_write) << " MB/s, read "
+    << to_mb_per_sec(n, elem_read) << " MB/s (checksum " << checksum << ")";
+}
+
+int main(int argc, char** argv) {
+  size_t total_bytes = size_t(argc > 1 ? std::atoi(argv[1]) : 256) << 20;
+  for (size_t kb : {1, 64, 1024, 64 * 1024}) {
+    bench<int>("int", kb << 10, total_bytes);
+    bench<double>("double", kb << 10, total_bytes);
+    bench<Point>("struct", kb << 10, total_bytes);
+  }
+}
@@ -0,0 +1,123 @@
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+
+#include "zaf/zaf.hpp"
+
+// Usage: ShuffleXBenchmark [num_senders] [num_receivers] [num_messages] [num_executors]
+//
+// Runs the shuffle of examples/shufflex.cpp, i.e., each sender sends `num_messages` integers to
+// each receiver by the SWSR queues of ActorBehaviorX, with the actors
+// 1. on dedicated threads,
+// 2. on an ActorEngine under Polling scheduling,
+// 3. on an ActorEngine under WorkStealing scheduling,
+// and reports the messages/sec of each.
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+template<bool Blocking>
+class ShuffleSender : public zaf::ActorBehaviorX {
+public:
+  ShuffleSender(int n_msg):
+    n_msg(n_msg) {
+  }
+
+  zaf::MessageHandlers behavior() override {
+    return {
+      zaf::Code{0} - [&](const std::vector<zaf::Actor>& receivers) {
+        for (int i = 0; i < n_msg; i++) {
+          for (auto& r : receivers) {
+            this->send(r, 0, i);
+          }
+        }
+        for (auto& r : receivers) {
+          this->send(r, 1);
+        }
+        this->deactivate();
+      }
+    };
+  }
+
+  bool is_blocking() const override {
+    return Blocking;
+  }
+
+  const int n_msg;
+};
+
+template<bool Blocking>
+class ShuffleReceiver : public zaf::ActorBehaviorX {
+public:
+  ShuffleReceiver(int n_send):
+    n_send(n_send) {
+  }
+
+  zaf::MessageHandlers behavior() override {
+    return {
+      zaf::Code{0} - [&](int) {
+        ++num_msg_recv;
+      },
+      zaf::Code{1} - [&]() {
+        if (++num_termination == n_send) {
+          this->deactivate();
+        }
+      }
+    };
+  }
+
+  bool is_blocking() const override {
+    return Blocking;
+  }
+
+  const int n_send;
+  int num_termination = 0;
+  long num_msg_recv = 0;
+};
+
+template<bool Blocking>
+void shuffle(const char* name, zaf::ActorSystem& system, zaf::ActorGroup& group,
+  int n_send, int n_recv, int n_msg) {
+  std::vector<zaf::Actor> senders, receivers;
+  for (int i = 0; i < n_send; i++) {
+    senders.emplace_back(group.spawn<ShuffleSender<Blocking>>(n_msg));
+  }
+  for (int i = 0; i < n_recv; i++) {
+    receivers.emplace_back(group.spawn<ShuffleReceiver<Blocking>>(n_send));
+  }
+  auto start = Clock::now();
+  {
+    auto trigger = system.create_scoped_actor();
+    for (auto& s : senders) {
+      trigger->send(s, 0, receivers);
+    }
+  }
+  group.await_all_actors_done();
+  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+  auto num_msgs = size_t(n_send) * n_recv * n_msg;
+  LOG(INFO) << name << ": " << num_msgs << " messages in " << ms << "ms, "
+    << (ms == 0 ? 0 : num_msgs * 1000 / ms) << " messages/sec";
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  int n_send = argc > 1 ? std::atoi(argv[1]) : 3;
+  int n_recv = argc > 2 ? std::atoi(argv[2]) : 3;
+  int n_msg = argc > 3 ? std::atoi(argv[3]) : 1000000;
+  size_t n_exec = argc > 4 ? std::atol(argv[4]) : 2;
+
+  {
+    zaf::ActorSystem system;
+    shuffle<true>("Threads", system, system, n_send, n_recv, n_msg);
+  }
+  {
+    zaf::ActorSystem system;
+    zaf::ActorEngine engine{system, n_exec};
+    shuffle<false>("ActorEngine (Polling)", system, engine, n_send, n_recv, n_msg);
+  }
+  {
+    zaf::ActorSystem system;
+    zaf::ActorEngine engine{system, n_exec, zaf::ActorEngine::Scheduling::WorkStealing};
+    shuffle<false>("ActorEngine (WorkStealing)", system, engine, n_send, n_recv, n_msg);
+  }
+}
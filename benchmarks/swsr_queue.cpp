@@ -0,0 +1,91 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "zaf/zaf.hpp"
+
+// Usage: SWSRQueueBenchmark [num_items] [batch_size]
+//
+// Measures the SWSRDeliveryQueue between two threads in the scenarios of
+// tests/swsr_delivery_queue.cpp, with the reader polling the queue (and yielding when it finds
+// nothing) instead of waiting for a notification:
+// 1. Streaming: the writer pushes `num_items` items to a queue of 2^16 slots, item by item with
+//    `push` or `batch_size` items at a time with `push_n`, and the reader takes them with
+//    `pop_some`. Reports the ns per item.
+// 2. Ping-pong: two threads bounce an item through a pair of queues `num_items / 100` times.
+//    Reports the ns per round trip.
+
+using Clock = std::chrono::steady_clock;
+using Queue = zaf::SWSRDeliveryQueue<uintptr_t>;
+
+double elapsed_ns(Clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+void streaming(unsigned n, unsigned batch_size) {
+  Queue queue;
+  queue.resize(16);
+  uintptr_t sum = 0;
+  auto start = Clock::now();
+  std::thread reader([&]() {
+    for (unsigned num_read = 0; num_read < n;) {
+      auto k = queue.pop_some([&](uintptr_t i) { sum += i; }, 1024u);
+      if (k == 0) {
+        std::this_thread::yield();
+      }
+      num_read += k;
+    }
+  });
+  if (batch_size <= 1) {
+    for (uintptr_t i = 0; i < n; i++) {
+      queue.push(i);
+    }
+  } else {
+    std::vector<uintptr_t> batch(batch_size);
+    for (uintptr_t i = 0; i < n; i += batch_size) {
+      for (unsigned j = 0; j < batch_size; j++) {
+        batch[j] = i + j;
+      }
+      queue.push_n(batch.begin(), std::min<uintptr_t>(batch_size, n - i));
+    }
+  }
+  reader.join();
+  LOG(INFO) << "Streaming with batch size " << batch_size << ": "
+    << elapsed_ns(start) / n << " ns/item (checksum " << sum << ")";
+}
+
+void ping_pong(unsigned n) {
+  Queue ping, pong;
+  ping.resize(4);
+  pong.resize(4);
+  auto start = Clock::now();
+  std::thread peer([&]() {
+    for (unsigned i = 0; i < n;) {
+      if (ping.pop_some([&](uintptr_t x) { pong.push(x + 1); }, 1u) == 0) {
+        std::this_thread::yield();
+      } else {
+        i++;
+      }
+    }
+  });
+  uintptr_t x = 0;
+  for (unsigned i = 0; i < n;) {
+    ping.push(x);
+    while (pong.pop_some([&](uintptr_t y) { x = y; }, 1u) == 0) {
+      std::this_thread::yield();
+    }
+    i++;
+  }
+  peer.join();
+  LOG(INFO) << "Ping-pong: " << elapsed_ns(start) / n << " ns/round trip (checksum " << x << ")";
+}
+
+int main(int argc, char** argv) {
+  unsigned n = argc > 1 ? std::atoi(argv[1]) : 50000000;
+  unsigned batch_size = argc > 2 ? std::atoi(argv[2]) : 64;
+  streaming(n, 1);
+  streaming(n, batch_size);
+  ping_pong(n / 100);
+}
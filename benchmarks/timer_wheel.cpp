@@ -0,0 +1,103 @@
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "zaf/zaf.hpp"
+
+// Usage: TimerWheelBenchmark [num_timers]
+//
+// Measures the ns/op to add, cancel and expire timers with 1M (by default) timers pending,
+// for the TimerWheel used by ActorBehavior::delayed_send versus the sorted multimap that
+// kept the delayed messages before. The timers are spread over 10 seconds, half of them
+// are cancelled, and the others are expired in 1ms steps of a simulated clock.
+
+using Clock = std::chrono::steady_clock;
+using Value = std::unique_ptr<int>;
+
+long long elapsed_ns(Clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+template<typename AddFn, typename CancelFn, typename ExpireFn>
+void bench(const char* name, const std::vector<long>& delays, AddFn add, CancelFn cancel,
+  ExpireFn expire) {
+  auto n = delays.size();
+  auto t0 = Clock::now();
+  auto start = Clock::now();
+  for (size_t i = 0; i < n; i++) {
+    add(t0 + std::chrono::milliseconds{delays[i]}, i);
+  }
+  auto add_ns = elapsed_ns(start);
+
+  start = Clock::now();
+  for (size_t i = 0; i < n; i += 2) {
+    cancel(i);
+  }
+  auto cancel_ns = elapsed_ns(start);
+
+  size_t num_fired = 0;
+  start = Clock::now();
+  for (long ms = 0; ms <= 10000; ms++) {
+    num_fired += expire(t0 + std::chrono::milliseconds{ms + 1});
+  }
+  auto expire_ns = elapsed_ns(start);
+
+  LOG(INFO) << name << ": add " << double(add_ns) / n << " ns/op, cancel "
+    << double(cancel_ns) / (n / 2) << " ns/op, expire " << double(expire_ns) / num_fired
+    << " ns/op (" << num_fired << " fired)";
+}
+
+int main(int argc, char** argv) {
+  size_t n = argc > 1 ? std::atol(argv[1]) : 1000000;
+  std::mt19937 rng(2023);
+  std::vector<long> delays(n);
+  for (auto& d : delays) {
+    d = rng() % 10000;
+  }
+
+  {
+    zaf::TimerWheel<Value> wheel;
+    std::vector<zaf::TimerHandle> handles(n);
+    bench("TimerWheel", delays,
+      [&](Clock::time_point t, size_t i) {
+        handles[i] = wheel.add(t, std::make_unique<int>(i));
+      },
+      [&](size_t i) { wheel.cancel(handles[i]); },
+      [&](Clock::time_point now) {
+        size_t fired = 0;
+        wheel.expire(now, [&](Value&&) { fired++; });
+        return fired;
+      });
+  }
+  {
+    using Map = DefaultSortedMultiMap<Clock::time_point, Value>;
+    Map map;
+    // keep the keys as the iterators of btree maps are not stable
+    std::vector<Clock::time_point> keys(n);
+    bench("SortedMultiMap", delays,
+      [&](Clock::time_point t, size_t i) {
+        keys[i] = t;
+        map.emplace(t, std::make_unique<int>(i));
+      },
+      [&](size_t i) {
+        // find the entry of the timer by its key and value
+        auto range = map.equal_range(keys[i]);
+        for (auto iter = range.first; iter != range.second; ++iter) {
+          if (*iter->second == int(i)) {
+            map.erase(iter);
+            break;
+          }
+        }
+      },
+      [&](Clock::time_point now) {
+        size_t fired = 0;
+        while (!map.empty() && map.begin()->first <= now) {
+          map.erase(map.begin());
+          fired++;
+        }
+        return fired;
+      });
+  }
+}
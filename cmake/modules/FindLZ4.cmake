@@ -0,0 +1,27 @@
+find_path(LZ4_INCLUDE_DIR
+  NAMES lz4.h
+  PATHS ${LZ4_ROOT_DIR}/include
+)
+
+find_library(LZ4_LIBRARY
+  NAMES lz4
+  PATHS ${LZ4_ROOT_DIR}/lib
+)
+
+include(FindPackageHandleStandardArgs)
+
+find_package_handle_standard_args(LZ4
+  FOUND_VAR LZ4_FOUND
+  REQUIRED_VARS LZ4_LIBRARY LZ4_INCLUDE_DIR
+)
+
+mark_as_advanced(LZ4_ROOT_DIR
+  LZ4_LIBRARY
+  LZ4_INCLUDE_DIR
+)
+
+if (LZ4_FOUND)
+  message(STATUS "Found valid LZ4 version:")
+  message(STATUS "  LZ4 include dir: ${LZ4_INCLUDE_DIR}")
+  message(STATUS "  LZ4 libraries: ${LZ4_LIBRARY}")
+endif ()
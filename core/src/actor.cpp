@@ -20,6 +20,13 @@ size_t LocalActorHandle::hash_code() const {
   return local_actor_id;
 }
 
+const LocalActorHandle& NetSenderInfo::net_sender_of(const LocalActorHandle& remote_actor) const {
+  if (lanes.size() <= 1) {
+    return net_sender;
+  }
+  return lanes[remote_actor.local_actor_id % lanes.size()];
+}
+
 RemoteActorHandle::RemoteActorHandle(const NetSenderInfo& net_sender_info,
   const LocalActorHandle& remote_actor):
   net_sender_info(&net_sender_info),
@@ -1,11 +1,13 @@
 #include <chrono>
 #include <memory>
 #include <string>
+#include <variant>
 
 #include "zaf/actor.hpp"
 #include "zaf/actor_behavior.hpp"
 #include "zaf/actor_system.hpp"
 #include "zaf/count_pointer.hpp"
+#include "zaf/mailbox.hpp"
 #include "zaf/receive_guard.hpp"
 #include "zaf/thread_utils.hpp"
 #include "zaf/zaf_exception.hpp"
@@ -14,6 +16,9 @@
 
 namespace zaf {
 ActorBehavior::ActorBehavior() {
+  if constexpr (ENABLE_METRICS) {
+    metrics = std::make_unique<ActorMetrics>();
+  }
   inner_handlers.add_handlers(
     DefaultCodes::Request -
     [&](unsigned /*req_id*/, std::unique_ptr<MessageBody>& request) {
@@ -90,38 +95,49 @@ std::string ActorBehavior::get_name() const {
   return to_string("ZAF/A", this->get_actor_id());
 }
 
+bool ActorBehavior::is_blocking() const {
+  return false;
+}
+
+void ActorBehavior::set_executor_driven() {
+  executor_driven = true;
+}
+
+bool ActorBehavior::is_executor_driven() const {
+  return executor_driven;
+}
+
+bool ActorBehavior::has_side_messages() const {
+  return false;
+}
+
+size_t ActorBehavior::receive_side_messages(MessageHandlers&, size_t) {
+  return 0;
+}
+
 void ActorBehavior::send(const LocalActorHandle& receiver, Message* m) {
-  auto receiver_id = receiver.local_actor_id;
-  if (connected_receivers.insert(receiver_id).second) {
-    // newly inserted
-    connect(receiver_id);
-  }
-  auto recv_routing_id = get_routing_id(receiver_id, false);
-  try {
-    receive_guard([&]() {
-      send_socket.send(zmq::buffer(recv_routing_id), zmq::send_flags::sndmore);
-    });
-  } catch (...) {
-    std::throw_with_nested(ZAFException(
-      "Failed to send a multi-part zmq message for receiver routing id:\n",
-      "  from sender: ", this->actor_id, '\n',
-      "  to receiver: ", receiver_id, '\n',
-      "  receiver routing id: ", recv_routing_id));
+  if (!actor_system_ptr) {
+    delete m;
+    throw ZAFException("Exception caught when sending a message in actor ", this->actor_id, '\n',
+      "  Attempt to send message before the actor is initialized.");
   }
-  try {
-    receive_guard([&]() {
-      send_socket.send(zmq::const_buffer(&m, sizeof(m)));
-    });
-  } catch (...) {
-    if (!bool(send_socket)) {
-      std::throw_with_nested(ZAFException(
-        "Exception caught when sending a message in actor ", this->actor_id, '\n',
-        "  Attempt to send message before sockets are setup."));
-    } else {
-      std::throw_with_nested(ZAFException(
-        "Exception caught when sending a message in actor ", this->actor_id));
+  auto receiver_id = receiver.local_actor_id;
+  auto& receiver_mailbox = connected_receivers[receiver_id];
+  if (!receiver_mailbox || receiver_mailbox->is_closed()) {
+    // newly connected, or the cached receiver has terminated and its id may be reused
+    receiver_mailbox = actor_system_ptr->lookup_mailbox(receiver_id);
+    if (!receiver_mailbox) {
+      // the receiver has terminated, the message is discarded.
+      connected_receivers.erase(receiver_id);
+      delete m;
+      return;
     }
   }
+  if constexpr (ENABLE_METRICS) {
+    metrics->messages_sent.add();
+  }
+  tracer::record_send(this->actor_id, receiver_id, m);
+  receiver_mailbox->push(m);
 }
 
 bool ActorBehavior::receive_once(MessageHandlers&& handlers, bool non_blocking) {
@@ -148,24 +164,49 @@ bool ActorBehavior::receive_once(MessageHandlers&& handlers, long timeout) {
 
 bool ActorBehavior::receive_once(MessageHandlers& handlers, long timeout) {
   return this->receive_once([&](Message* m) {
-    auto prev_message = this->current_message;
-    this->current_message = m;
-    inner_handlers.add_child_handlers(handlers);
-    try {
-      inner_handlers.process(*m);
-    } catch (...) {
-      std::throw_with_nested(ZAFException(
-        "Exception caught when processing a message with code ", m->get_body().get_code(),
-        " (", std::hex, m->get_body().get_code(), ")."));
-    }
-    inner_handlers.remove_child_handlers();
-    if (this->current_message) {
-      delete this->current_message;
-    }
-    this->current_message = prev_message;
+    this->process_message(handlers, m);
   }, timeout);
 }
 
+size_t ActorBehavior::receive_batch(MessageHandlers&& handlers, size_t max_n, long timeout) {
+  return this->receive_batch(handlers, max_n, timeout);
+}
+
+size_t ActorBehavior::receive_batch(MessageHandlers& handlers, size_t max_n, long timeout) {
+  return this->receive_batch([&](Message* m) {
+    this->process_message(handlers, m);
+  }, max_n, timeout);
+}
+
+void ActorBehavior::process_message(MessageHandlers& handlers, Message* m) {
+  auto prev_message = this->current_message;
+  this->current_message = m;
+  inner_handlers.add_child_handlers(handlers);
+  try {
+    HandlerTimer timer(metrics.get());
+    tracer::HandleScope scope(this->actor_id, m);
+    inner_handlers.process(*m);
+  } catch (...) {
+    std::throw_with_nested(ZAFException(
+      "Exception caught when processing a message with code ", m->get_body().get_code(),
+      " (", std::hex, m->get_body().get_code(), ")."));
+  }
+  inner_handlers.remove_child_handlers();
+  if (this->current_message) {
+    delete this->current_message;
+  }
+  this->current_message = prev_message;
+}
+
+Message* ActorBehavior::try_take_ready_message() {
+  if (!waiting_for_response && !pending_messages.empty()) {
+    auto m = pending_messages.front();
+    pending_messages.pop_front();
+    return m;
+  }
+  return mailbox->try_pop();
+}
+
 void ActorBehavior::receive(MessageHandlers&& handlers) {
   this->receive(handlers);
 }
@@ -177,44 +218,28 @@ void ActorBehavior::receive(MessageHandlers& handlers) {
   }
 }
 
-void ActorBehavior::initialize_recv_socket() {
-  auto recv_routing_id = get_routing_id(this->actor_id, false);
-  recv_socket = zmq::socket_t(
-    this->get_actor_system().get_zmq_context(), zmq::socket_type::router);
-  // must set routing_id before bind
-  recv_socket.set(zmq::sockopt::routing_id, zmq::buffer(recv_routing_id));
-  recv_socket.bind("inproc://" + recv_routing_id);
-  recv_poll_items.emplace_back(zmq::pollitem_t{
-    recv_socket.handle(), 0, ZMQ_POLLIN, 0
-  });
+void ActorBehavior::initialize_mailbox() {
+  mailbox = std::make_shared<Mailbox>();
+  recv_poll_items.emplace_back(mailbox->get_poll_item());
   recv_poll_callbacks.push_back(nullptr);
+  this->get_actor_system().register_mailbox(this->actor_id, mailbox);
 }
 
-void ActorBehavior::terminate_recv_socket() {
-  auto recv_routing_id = get_routing_id(this->actor_id, false);
-  recv_socket.unbind("inproc://" + recv_routing_id);
-  recv_socket.close();
+void ActorBehavior::terminate_mailbox() {
+  this->get_actor_system().deregister_mailbox(this->actor_id, mailbox);
+  // Messages sent by the writers that have not noticed the closure
+  // are deleted when the mailbox is destroyed.
+  mailbox->close();
+  while (auto m = mailbox->try_pop()) {
+    delete m;
+  }
+  mailbox = nullptr;
   recv_poll_items.clear();
-}
-
-void ActorBehavior::initialize_send_socket() {
-  auto send_routing_id = get_routing_id(this->actor_id, true);
-  send_socket = zmq::socket_t(
-    this->get_actor_system().get_zmq_context(), zmq::socket_type::router);
-  // must set routing_id before connect
-  send_socket.set(zmq::sockopt::routing_id, zmq::buffer(send_routing_id));
-  send_socket.set(zmq::sockopt::sndhwm, 0);
-  // send_socket.set(zmq::sockopt::linger, 0);
-  // connect to self
-  connected_receivers.insert(this->get_actor_id());
-  connect(this->actor_id);
+  recv_poll_callbacks.clear();
 }
 
 void ActorBehavior::terminate_send_socket() {
-  for (auto& i : connected_receivers) {
-    disconnect(i);
-  }
-  send_socket.close();
+  connected_receivers.clear();
 }
 
 void ActorBehavior::initialize_actor(ActorSystem& sys, ActorGroup& group) {
@@ -225,8 +250,8 @@ void ActorBehavior::initialize_actor(ActorSystem& sys, ActorGroup& group) {
   actor_group_ptr = &group;
   sys.inc_num_alive_actors();
   this->actor_id = sys.get_next_available_actor_id();
-  this->initialize_routing_id_buffer();
   try {
+    this->initialize_mailbox();
     this->initialize_recv_socket();
     this->initialize_send_socket();
   } catch (...) {
@@ -234,23 +259,20 @@ void ActorBehavior::initialize_actor(ActorSystem& sys, ActorGroup& group) {
       "Exception caught in ", __PRETTY_FUNCTION__, " in actor ", this->actor_id
     ));
   }
+  if constexpr (ENABLE_METRICS) {
+    metrics->actor_id = this->actor_id;
+    metrics->name = this->get_name();
+    metrics->mailbox = mailbox.get();
+    sys.get_metrics_registry().add(metrics.get());
+  }
 }
 
-void ActorBehavior::initialize_routing_id_buffer() {
-  routing_id_buffer.clear();
-  routing_id_buffer.reserve(ActorIdMaxLen +
-    this->get_actor_system().get_identifier().size() + 1);
-  routing_id_buffer.append(ActorIdMaxLen, '0');
-  routing_id_buffer.append(this->get_actor_system().get_identifier());
-  routing_id_buffer.push_back(' ');
-}
-
-zmq::socket_t& ActorBehavior::get_recv_socket() {
-  return recv_socket;
+Mailbox& ActorBehavior::get_mailbox() {
+  return *mailbox;
 }
 
-zmq::socket_t& ActorBehavior::get_send_socket() {
-  return send_socket;
+void ActorBehavior::set_mailbox_waiter(MailboxWaiter* waiter) {
+  mailbox_waiter = waiter;
 }
 
 void ActorBehavior::add_recv_poll(
@@ -322,16 +344,15 @@ void ActorBehavior::terminate_actor() {
     delete m;
   }
   pending_messages.clear();
+  // the requests refer to their deadlines in `delayed_messages`
+  unfinished_requests.clear();
   delayed_messages.clear();
-  while (true) {
-    // a workaround to avoid memory leak on messages because the receiver
-    // actor is terminated and messages are not processed and freed.
-    if (!this->inner_receive_once([](Message* m) { delete m; }, 1)) {
-      break;
-    }
+  if constexpr (ENABLE_METRICS) {
+    actor_system_ptr->get_metrics_registry().remove(metrics.get());
   }
   terminate_send_socket();
   terminate_recv_socket();
+  terminate_mailbox();
   actor_system_ptr->dec_num_alive_actors();
   actor_system_ptr = nullptr;
 }
@@ -348,130 +369,261 @@ LocalActorHandle ActorBehavior::get_local_actor_handle() const {
   return {actor_id, false};
 }
 
-void ActorBehavior::connect(ActorIdType peer_id) {
-  auto routing_id = "inproc://" + get_routing_id(peer_id, false);
-  try {
-    send_socket.connect(routing_id);
-  } catch (...) {
-    std::throw_with_nested(ZAFException(
-      "Actor", this->get_actor_id(), " failed to connect to receiver actor ",
-      peer_id, " via ", routing_id));
-  }
-}
-
-void ActorBehavior::disconnect(ActorIdType peer_id) {
-  auto routing_id = "inproc://" + get_routing_id(peer_id, false);
-  try {
-    send_socket.disconnect(routing_id);
-  } catch (...) {
-    std::throw_with_nested(ZAFException(
-      this->get_actor_id(), " failed to disconnect to receiver ",
-      peer_id, " via ", routing_id));
-  }
-}
-
-// [actor id][zaf][s/r] as the routing id of the zmq socket.
-// Note: originally we used the exact bytes of the actor id in the routing_id, however,
-// zmq_connect requires a `const char*` instead of `std::string`, in case the routing id
-// contains '\0', zmq ignores the part after the first '\0'. Sad.
-const std::string& ActorBehavior::get_routing_id(ActorIdType id, bool send_or_recv) {
-  for (size_t i = 0; i < ActorIdMaxLen; i++) {
-    routing_id_buffer[i] = id % 10 + '0';
-    id /= 10;
-  }
-  routing_id_buffer.back() = send_or_recv ? 's' : 'r';
-  return routing_id_buffer;
-}
-
 ActorBehavior::RequestHandler::RequestHandler(ActorBehavior& self, unsigned req_id):
   self(&self),
+  owner(&self),
   request_id(req_id) {
-  this->self->unfinished_requests.emplace(req_id, nullptr);
+  this->self->unfinished_requests.emplace(req_id, UnfinishedRequest{});
 }
 
 ActorBehavior::RequestHandler::RequestHandler(RequestHandler&& other):
   self(other.self),
+  owner(other.owner),
   request_id(other.request_id) {
   other.self = nullptr;
+  other.owner = nullptr;
 }
 
 ActorBehavior::RequestHandler&
 ActorBehavior::RequestHandler::operator=(ActorBehavior::RequestHandler&& other) {
   self = other.self;
+  owner = other.owner;
   request_id = other.request_id;
   other.self = nullptr;
+  other.owner = nullptr;
   return *this;
 }
 
 ActorBehavior::RequestHandler::~RequestHandler() {
   if (self) {
-    self->unfinished_requests.erase(request_id);
+    this->cancel();
   }
 }
 
+bool ActorBehavior::RequestHandler::cancel() {
+  if (!owner) {
+    throw ZAFException("Attempt to call cancel on an invalid RequestHandler.");
+  }
+  auto actor = owner;
+  self = nullptr;
+  owner = nullptr;
+  return actor->cancel_request(request_id);
+}
+
+unsigned ActorBehavior::RequestHandler::get_request_id() const {
+  return request_id;
+}
+
 void ActorBehavior::RequestHandler::on_reply(MessageHandlers&& handlers) {
   this->on_reply(handlers);
 }
 
-// Note: need to store the current status of ActorBehavior and create a new round of `receive`
 void ActorBehavior::RequestHandler::on_reply(MessageHandlers& handlers) {
   if (!self) {
     throw ZAFException("Attempt to call on_reply on an invalid RequestHandler.");
   }
-  auto iter = self->unfinished_requests.find(request_id);
-  if (iter->second) {
+  this->wait_for_reply(handlers);
+}
+
+bool ActorBehavior::RequestHandler::on_reply(MessageHandlers&& handlers,
+  std::chrono::milliseconds timeout) {
+  return this->on_reply(handlers, timeout);
+}
+
+bool ActorBehavior::RequestHandler::on_reply(MessageHandlers& handlers,
+  std::chrono::milliseconds timeout) {
+  if (!self) {
+    throw ZAFException("Attempt to call on_reply on an invalid RequestHandler.");
+  }
+  self->set_request_deadline(request_id, timeout);
+  return this->wait_for_reply(handlers);
+}
+
+// Note: need to store the current status of ActorBehavior and create a new round of `receive`
+bool ActorBehavior::RequestHandler::wait_for_reply(MessageHandlers& handlers) {
+  auto actor = self;
+  self = nullptr;
+  owner = nullptr;
+  auto iter = actor->unfinished_requests.find(request_id);
+  if (iter == actor->unfinished_requests.end()) {
+    // cancelled by `cancel_request`
+    return false;
+  }
+  if (iter->second.response) {
     // 1. if the response has been received and stored, process it
-    handlers.process_body(*iter->second);
-    self->unfinished_requests.erase(iter);
-  } else {
-    // 2. if not, wait for the response
-    self->unfinished_requests.erase(iter);
-    ++self->waiting_for_response;
-    auto cur_act = self->is_activated();
-    auto current_inner_handlers = std::move(self->inner_handlers);
-    self->receive({
-      DefaultCodes::Response -
-      [&](unsigned req_id, std::unique_ptr<MessageBody>& rep) {
-        if (req_id != request_id) {
-          self->store_response(req_id, rep);
-          return;
-        }
-        try {
-          handlers.process_body(*rep);
-        } catch (...) {
-          std::throw_with_nested(ZAFException(
-            "Exception caught when processing a message with code ", rep->get_code(),
-            " (", std::hex, rep->get_code(), ")."));
-        }
-        self->deactivate();
-      },
-      DefaultCodes::DefaultMessageHandler - [&](Message&) {
-        self->pending_messages.push_back(self->current_message);
-        self->current_message = nullptr;
+    auto response = std::move(iter->second.response);
+    actor->erase_unfinished_request(iter);
+    handlers.process_body(*response);
+    return true;
+  }
+  if (iter->second.timed_out) {
+    // 2. if the deadline has passed before on_reply is called
+    actor->erase_unfinished_request(iter);
+    return false;
+  }
+  // 3. if not, wait for the response until it arrives or the deadline deactivates the receive
+  iter->second.waited = true;
+  bool replied = false;
+  ++actor->waiting_for_response;
+  auto cur_act = actor->is_activated();
+  auto current_inner_handlers = std::move(actor->inner_handlers);
+  actor->receive({
+    DefaultCodes::Response -
+    [&](unsigned req_id, std::unique_ptr<MessageBody>& rep) {
+      if (req_id != request_id) {
+        actor->store_response(req_id, rep);
+        return;
+      }
+      auto iter = actor->unfinished_requests.find(request_id);
+      if (iter == actor->unfinished_requests.end() || iter->second.timed_out) {
+        // a late response
+        return;
+      }
+      actor->erase_unfinished_request(iter);
+      replied = true;
+      try {
+        handlers.process_body(*rep);
+      } catch (...) {
+        std::throw_with_nested(ZAFException(
+          "Exception caught when processing a message with code ", rep->get_code(),
+          " (", std::hex, rep->get_code(), ")."));
       }
-    });
-    self->inner_handlers = std::move(current_inner_handlers);
-    if (cur_act) {
-      self->activate();
+      actor->deactivate();
+    },
+    DefaultCodes::DefaultMessageHandler - [&](Message&) {
+      actor->pending_messages.push_back(actor->current_message);
+      actor->current_message = nullptr;
     }
-    --self->waiting_for_response;
+  });
+  actor->inner_handlers = std::move(current_inner_handlers);
+  if (cur_act) {
+    actor->activate();
+  }
+  --actor->waiting_for_response;
+  if (!replied) {
+    auto iter = actor->unfinished_requests.find(request_id);
+    if (iter != actor->unfinished_requests.end()) {
+      actor->erase_unfinished_request(iter);
+    }
+  }
+  return replied;
+}
+
+void ActorBehavior::RequestHandler::then(MessageHandlers&& handlers) {
+  if (!self) {
+    throw ZAFException("Attempt to call then on an invalid RequestHandler.");
   }
+  auto actor = self;
   self = nullptr;
+  auto iter = actor->unfinished_requests.find(request_id);
+  if (iter == actor->unfinished_requests.end()) {
+    // cancelled by `cancel_request`
+    return;
+  }
+  if (iter->second.response) {
+    auto response = std::move(iter->second.response);
+    actor->erase_unfinished_request(iter);
+    handlers.process_body(*response);
+    return;
+  }
+  if (iter->second.timed_out) {
+    // the deadline has passed, and `on_timeout` is not given
+    actor->erase_unfinished_request(iter);
+    return;
+  }
+  // the request is kept in `unfinished_requests` until the response arrives
+  iter->second.continuation = std::make_unique<MessageHandlers>(std::move(handlers));
+}
+
+void ActorBehavior::RequestHandler::then(MessageHandlers&& handlers,
+  std::chrono::milliseconds timeout, std::function<void()> on_timeout) {
+  if (!self) {
+    throw ZAFException("Attempt to call then on an invalid RequestHandler.");
+  }
+  auto actor = self;
+  auto req_id = request_id;
+  this->then(std::move(handlers));
+  auto iter = actor->unfinished_requests.find(req_id);
+  if (iter != actor->unfinished_requests.end()) {
+    iter->second.on_timeout = std::move(on_timeout);
+    actor->set_request_deadline(req_id, timeout);
+  }
+}
+
+void ActorBehavior::set_request_deadline(unsigned req_id, std::chrono::milliseconds timeout) {
+  auto& req = unfinished_requests.at(req_id);
+  delayed_messages.cancel(req.deadline);
+  req.deadline = delayed_messages.add(std::chrono::steady_clock::now() + timeout,
+    DelayedMessage(RequestDeadline{req_id}));
+}
+
+void ActorBehavior::expire_request(unsigned req_id) {
+  auto iter = unfinished_requests.find(req_id);
+  if (iter == unfinished_requests.end()) {
+    return;
+  }
+  auto& req = iter->second;
+  if (req.continuation) {
+    auto on_timeout = std::move(req.on_timeout);
+    unfinished_requests.erase(iter);
+    if (on_timeout) {
+      on_timeout();
+    }
+    return;
+  }
+  // keep the request so that on_reply knows it has timed out
+  req.timed_out = true;
+  req.response = nullptr;
+  if (req.waited) {
+    this->deactivate();
+  }
+}
+
+bool ActorBehavior::cancel_request(unsigned req_id) {
+  auto iter = unfinished_requests.find(req_id);
+  if (iter == unfinished_requests.end() || iter->second.timed_out) {
+    return false;
+  }
+  if (iter->second.waited) {
+    // end the nested receive of `on_reply` as if the request timed out
+    delayed_messages.cancel(iter->second.deadline);
+    iter->second.timed_out = true;
+    this->deactivate();
+    return true;
+  }
+  erase_unfinished_request(iter);
+  return true;
+}
+
+void ActorBehavior::erase_unfinished_request(
+  DefaultHashMap<unsigned, UnfinishedRequest>::iterator iter) {
+  delayed_messages.cancel(iter->second.deadline);
+  unfinished_requests.erase(iter);
 }
 
 std::optional<std::chrono::milliseconds>
 ActorBehavior::remaining_time_to_next_delayed_message() const {
-  return delayed_messages.empty()
-    ? std::nullopt
-    : std::optional(
+  auto next = delayed_messages.next_time();
+  return next
+    ? std::optional(
         std::chrono::duration_cast<std::chrono::milliseconds>(
-          delayed_messages.begin()->first - std::chrono::steady_clock::now()));
+          *next - std::chrono::steady_clock::now()))
+    : std::nullopt;
+}
+
+std::optional<ActorBehavior::TimePoint> ActorBehavior::get_next_delayed_message_time() const {
+  return delayed_messages.next_time();
+}
+
+bool ActorBehavior::cancel_delayed_send(const TimerHandle& handle) {
+  return delayed_messages.cancel(handle);
 }
 
 void ActorBehavior::flush_delayed_messages() {
-  while (!delayed_messages.empty() &&
-         delayed_messages.begin()->first <= std::chrono::steady_clock::now()) {
-    auto& msg = delayed_messages.begin()->second;
+  if (delayed_messages.empty()) {
+    return;
+  }
+  delayed_messages.expire(std::chrono::steady_clock::now(), [&](DelayedMessage&& msg) {
     std::visit(overloaded{
       [&](Message*& m) {
         LocalActorHandle& r = static_cast<LocalActorHandle&>(msg.receiver);
@@ -480,25 +632,40 @@ void ActorBehavior::flush_delayed_messages() {
       },
       [&](MessageBytes& m) {
         RemoteActorHandle& r = static_cast<RemoteActorHandle&>(msg.receiver);
-        this->send(r.net_sender_info->net_sender,
-          DefaultCodes::ForwardMessage, std::move(m.header), std::move(m.content));
+        this->send(r.net_sender_info->net_sender_of(r.remote_actor),
+          DefaultCodes::ForwardMessage, std::move(m));
+      },
+      [&](RequestDeadline& d) {
+        this->expire_request(d.request_id);
       }
     }, msg.message);
-    delayed_messages.erase(delayed_messages.begin());
-  }
+  });
 }
 
 void ActorBehavior::store_response(unsigned req_id,
   std::unique_ptr<MessageBody>& response) {
   // If there is a RequestHandler waiting for a response with this req_id,
-  // store this response for this RequestHandler
+  // store this response for this RequestHandler, or process it with the continuation
   auto iter = unfinished_requests.find(req_id);
-  if (iter != unfinished_requests.end()) {
-    iter->second = std::move(response);
+  if (iter != unfinished_requests.end() && !iter->second.timed_out) {
+    if (!iter->second.continuation) {
+      iter->second.response = std::move(response);
+      return;
+    }
+    // process the response with the continuation registered by `then`
+    auto continuation = std::move(iter->second.continuation);
+    erase_unfinished_request(iter);
+    try {
+      continuation->process_body(*response);
+    } catch (...) {
+      std::throw_with_nested(ZAFException(
+        "Exception caught when processing a message with code ", response->get_code(),
+        " (", std::hex, response->get_code(), ")."));
+    }
   } else {
     // Ignore the response.
     // Request id not found because the RequestHandler has been destroyed
-    // before it processes the reply.
+    // before it processes the reply, or the request has timed out.
   }
 }
 } // namespace zaf
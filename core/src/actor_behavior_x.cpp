@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "zaf/actor_behavior_x.hpp"
 
 namespace zaf {
@@ -11,19 +13,24 @@ ActorBehaviorX::ActorBehaviorX() {
       this->notify_swsr_queue();
     },
     DefaultCodes::SWSRMsgQueueConsumption - [&]() {
-      this->consume_swsr_recv_queues(ActorBehavior::inner_handlers.get_child_handlers());
-      this->post_swsr_consumption();
-      if (!this->active_recv_queues.empty()) {
-        this->ActorBehavior::send(*this, DefaultCodes::SWSRMsgQueueConsumption);
+      // an executor consumes the queues by `receive_side_messages` after this message
+      if (!this->executor_driven) {
+        this->continue_swsr_consumption();
       }
+    },
+    DefaultCodes::SWSRMsgQueueRoom - [&]() {
+      this->on_swsr_queue_room();
     });
 }
 
 void ActorBehaviorX::initialize_actor(ActorSystem& sys, ActorGroup& group) {
   this->ActorBehavior::initialize_actor(sys, group);
+  this->ready_list = std::make_shared<SWSRReadyList<SWSRDeliveryQueue<Message*>>>();
   { // a queue for sending messages to self
     this->self_swsr_queue = std::make_shared<SWSRDeliveryQueue<Message*>>();
     this->self_swsr_queue->resize(15);
+    this->self_swsr_queue->ready_list_holder = this->ready_list;
+    this->self_swsr_queue->ready_list.store(this->ready_list.get(), std::memory_order_release);
     this->self_swsr_queue->destructor = [queue = this->self_swsr_queue.get()]() {
       queue->pop_some([](Message* m) {
         delete m;
@@ -50,11 +57,107 @@ void ActorBehaviorX::send(const LocalActorHandle& actor, Message* m) {
   if (send_queue == nullptr) {
     this->setup_swsr_connection(actor);
   }
-  send_queue->push(m, [&]() {
-    this->ActorBehavior::send(actor, DefaultCodes::SWSRMsgQueueNotification);
-  }, actor.local_actor_id == this->get_actor_id()
-       ? SWSRDeliveryQueueFullStrategy::Resize
-       : SWSRDeliveryQueueFullStrategy::Blocking);
+  if constexpr (ENABLE_METRICS) {
+    this->metrics->messages_sent.add();
+  }
+  tracer::record_send(this->get_actor_id(), actor.local_actor_id, m);
+  auto notify = [&]() {
+    this->notify_swsr_receiver(actor, *send_queue);
+  };
+  if (actor.local_actor_id == this->get_actor_id()) {
+    send_queue->push(m, notify, SWSRDeliveryQueueFullStrategy::Resize);
+    return;
+  }
+  if (this->executor_driven) {
+    // the executor must not block, so the message is kept if the queue is full,
+    // or if some earlier messages are kept
+    auto keep = [&](PendingSends& pending) {
+      if (num_pending_messages == max_pending_messages) {
+        delete m;
+        throw ZAFException("Actor ", this->get_name(), " keeps more than ", max_pending_messages,
+          " messages for full SWSR queues.");
+      }
+      pending.messages.push_back(m);
+      ++num_pending_messages;
+    };
+    if (num_pending_messages != 0) {
+      auto iter = pending_sends.find(actor.local_actor_id);
+      if (iter != pending_sends.end() && !iter->second.messages.empty()) {
+        keep(iter->second);
+        return;
+      }
+    }
+    if (!send_queue->push(m, notify, SWSRDeliveryQueueFullStrategy::Giveup)) {
+      auto& pending = pending_sends[actor.local_actor_id];
+      pending.receiver = actor;
+      keep(pending);
+      pending.waiting_room = send_queue->wait_for_room();
+      has_flushable_sends |= !pending.waiting_room;
+      if constexpr (ENABLE_METRICS) {
+        this->metrics->swsr_send_stalls.add();
+      }
+    }
+    return;
+  }
+  auto num_stalls = send_queue->get_num_stalls();
+  send_queue->push(m, notify, SWSRDeliveryQueueFullStrategy::Blocking);
+  if constexpr (ENABLE_METRICS) {
+    this->metrics->swsr_send_stalls.add(send_queue->get_num_stalls() - num_stalls);
+  }
+}
+
+void ActorBehaviorX::flush_pending_sends() {
+  has_flushable_sends = false;
+  for (auto& id2pending : pending_sends) {
+    auto& pending = id2pending.second;
+    // an actor that terminates keeps pushing until the receivers make room
+    if (pending.messages.empty() || (pending.waiting_room && this->is_activated())) {
+      continue;
+    }
+    auto& send_queue = *swsr_send_queues.at(id2pending.first);
+    if (!send_queue.is_reading_by_receiver.load(std::memory_order_acquire)) {
+      // the receiver has terminated
+      for (auto m : pending.messages) {
+        delete m;
+      }
+      num_pending_messages -= pending.messages.size();
+      pending.messages.clear();
+      continue;
+    }
+    auto num_pushed = send_queue.push_n(pending.messages.begin(), pending.messages.size(), [&]() {
+      this->notify_swsr_receiver(pending.receiver, send_queue);
+    }, SWSRDeliveryQueueFullStrategy::Giveup);
+    pending.messages.erase(pending.messages.begin(), pending.messages.begin() + num_pushed);
+    num_pending_messages -= num_pushed;
+    if (!pending.messages.empty()) {
+      pending.waiting_room = send_queue.wait_for_room();
+      has_flushable_sends |= !pending.waiting_room;
+    }
+  }
+}
+
+void ActorBehaviorX::on_swsr_queue_room() {
+  auto iter = pending_sends.find(this->get_current_sender_actor().get_actor_id());
+  if (iter != pending_sends.end() && iter->second.waiting_room) {
+    iter->second.waiting_room = false;
+    has_flushable_sends = true;
+  }
+}
+
+void ActorBehaviorX::set_max_pending_messages(size_t max_pending) {
+  this->max_pending_messages = std::max(max_pending, size_t(1));
+}
+
+void ActorBehaviorX::notify_swsr_receiver(const LocalActorHandle& receiver,
+  SWSRDeliveryQueue<Message*>& send_queue) {
+  auto receiver_ready_list = send_queue.ready_list.load(std::memory_order_acquire);
+  if (receiver_ready_list == nullptr) {
+    // the receiver has not registered the queue yet, and puts the queue into its ready list itself
+    this->ActorBehavior::send(receiver, DefaultCodes::SWSRMsgQueueNotification);
+  } else if (receiver_ready_list->push(&send_queue)) {
+    // the receiver has nothing to consume and is woken up by a message
+    this->ActorBehavior::send(receiver, DefaultCodes::SWSRMsgQueueConsumption);
+  }
 }
 
 std::string ActorBehaviorX::get_name() const {
@@ -62,26 +165,58 @@ std::string ActorBehaviorX::get_name() const {
 }
 
 void ActorBehaviorX::register_swsr_queue(std::shared_ptr<SWSRDeliveryQueue<Message*>>& recv_queue) {
-  swsr_recv_queues.emplace(this->get_current_sender_actor().get_actor_id(), std::move(recv_queue));
+  recv_queue->ready_list_holder = this->ready_list;
+  recv_queue->ready_list.store(this->ready_list.get(), std::memory_order_release);
+  auto sender = this->get_current_sender_actor();
+  // wakes up the sender driven by an executor, which waits for room instead of blocking
+  recv_queue->on_room = [this, sender]() {
+    this->ActorBehavior::send(sender, DefaultCodes::SWSRMsgQueueRoom);
+  };
+  swsr_recv_queues.emplace(sender.get_actor_id(), std::move(recv_queue));
+  this->update_swsr_metrics();
 }
 
 void ActorBehaviorX::notify_swsr_queue() {
-  if (active_recv_queues.empty()) {
+  auto sender_id = this->get_current_sender_actor().get_actor_id();
+  if (ready_list->push(swsr_recv_queues.at(sender_id).get()) && !this->executor_driven) {
+    this->continue_swsr_consumption();
+  }
+}
+
+void ActorBehaviorX::continue_swsr_consumption() {
+  this->consume_swsr_recv_queues(ActorBehavior::inner_handlers.get_child_handlers());
+  this->post_swsr_consumption();
+  // consume again after the messages in the mailbox, until there is nothing to consume
+  if (this->is_activated() && (!active_recv_queues.empty() || !ready_list->prepare_wait())) {
     this->ActorBehavior::send(*this, DefaultCodes::SWSRMsgQueueConsumption);
+  } else {
+    this->update_swsr_metrics();
   }
-  auto sender_id = this->get_current_sender_actor().get_actor_id();
-  active_recv_queues.emplace_back(sender_id, swsr_recv_queues.at(sender_id).get());
 }
 
-void ActorBehaviorX::consume_swsr_recv_queues(MessageHandlers& handlers) {
+size_t ActorBehaviorX::consume_swsr_recv_queues(MessageHandlers& handlers, size_t max_n) {
+  // the queues that become non-empty are visited after those that are still active
+  for (auto recv_queue = ready_list->take_all(); recv_queue; recv_queue = recv_queue->next_ready) {
+    active_recv_queues.push_back(recv_queue);
+  }
   Message* old_current_message = this->current_message;
   this->current_message = nullptr;
-  for (unsigned i = 0, n = active_recv_queues.size(); i < n; i++) {
-    bool empty = false;
-    auto recv_queue = active_recv_queues[i].second;
-    recv_queue->pop_some([&](Message* m) {
+  size_t num_consumed = 0;
+  for (size_t i = 0; i < active_recv_queues.size() && this->is_activated();) {
+    if (num_consumed == max_n) {
+      // start from the queues not visited this time in the next call
+      std::rotate(active_recv_queues.begin(), active_recv_queues.begin() + i,
+        active_recv_queues.end());
+      break;
+    }
+    auto recv_queue = active_recv_queues[i];
+    auto max_read = unsigned(std::min<size_t>(recv_queue->max_messages_read, max_n - num_consumed));
+    auto num_read = recv_queue->pop_some([&](Message* m) {
       this->current_message = m;
+      tracer::record_receive(this->get_actor_id(), m);
       try {
+        HandlerTimer timer(this->metrics.get());
+        tracer::HandleScope scope(this->get_actor_id(), m);
         handlers.process(*m);
       } catch (...) {
         std::throw_with_nested(ZAFException(
@@ -95,27 +230,93 @@ void ActorBehaviorX::consume_swsr_recv_queues(MessageHandlers& handlers) {
       if (!this->is_activated()) {
         recv_queue->stop_pop_some();
       }
-    }, [&]() {
-      empty = true;
-    });
-    if (empty) {
-      if (!recv_queue->is_writing_by_sender) {
-        this->swsr_recv_queues.erase(active_recv_queues[i].first);
+    }, max_read);
+    num_consumed += num_read;
+    if (num_read == max_read || !this->is_activated()) {
+      i++;
+      continue;
+    }
+    // The queue is found empty and is not visited until the sender puts it into the ready list
+    // again, unless the sender pushes more before it sees the reset.
+    recv_queue->inc_read_progress();
+    // loaded before `empty`, such that a terminated sender has no push after the check
+    bool sender_done = !recv_queue->is_writing_by_sender.load(std::memory_order_acquire);
+    bool empty = recv_queue->empty();
+    if (!empty && recv_queue->keep_read_progress()) {
+      i++;
+      continue;
+    }
+    active_recv_queues[i] = active_recv_queues.back();
+    active_recv_queues.pop_back();
+    if (empty && sender_done) {
+      // the sender has terminated
+      for (auto iter = swsr_recv_queues.begin(); iter != swsr_recv_queues.end(); ++iter) {
+        if (iter->second.get() == recv_queue) {
+          swsr_recv_queues.erase(iter);
+          break;
+        }
       }
-      active_recv_queues[i] = active_recv_queues.back();
-      active_recv_queues.pop_back();
-      i--;
-      n--;
     }
   }
   this->current_message = old_current_message;
+  return num_consumed;
 }
 
 void ActorBehaviorX::post_swsr_consumption() {}
 
+size_t ActorBehaviorX::get_swsr_reserved_bytes() const {
+  size_t bytes = 0;
+  for (auto& id2queue : swsr_recv_queues) {
+    bytes += id2queue.second->reserved_bytes();
+  }
+  return bytes;
+}
+
+void ActorBehaviorX::update_swsr_metrics() {
+  if constexpr (ENABLE_METRICS) {
+    this->metrics->swsr_reserved_bytes.set(this->get_swsr_reserved_bytes());
+  }
+}
+
+bool ActorBehaviorX::has_side_messages() const {
+  // an actor that terminates still pushes the messages kept for full queues before it is deleted,
+  // otherwise the kept messages waiting for room are pushed after SWSRMsgQueueRoom arrives
+  return (num_pending_messages != 0 && (has_flushable_sends || !this->is_activated())) ||
+    (this->is_activated() && (!active_recv_queues.empty() || !ready_list->empty()));
+}
+
+size_t ActorBehaviorX::receive_side_messages(MessageHandlers& handlers, size_t max_n) {
+  if (num_pending_messages != 0 && (has_flushable_sends || !this->is_activated())) {
+    flush_pending_sends();
+  }
+  if (!this->is_activated() || (active_recv_queues.empty() && ready_list->empty())) {
+    return 0;
+  }
+  auto num_consumed = consume_swsr_recv_queues(handlers, max_n);
+  this->post_swsr_consumption();
+  if (active_recv_queues.empty()) {
+    // the senders wake up the actor by message for the queues that become non-empty afterwards
+    ready_list->prepare_wait();
+    this->update_swsr_metrics();
+  }
+  return num_consumed;
+}
+
 ActorBehaviorX::~ActorBehaviorX() {
+  // the messages that are never pushed as the receivers do not make room for them
+  for (auto& id2pending : pending_sends) {
+    for (auto m : id2pending.second.messages) {
+      delete m;
+    }
+  }
+  pending_sends.clear();
   for (auto& id2queue : swsr_send_queues) {
-    id2queue.second->is_writing_by_sender = false;
+    id2queue.second->is_writing_by_sender.store(false, std::memory_order_release);
+  }
+  for (auto& id2queue : swsr_recv_queues) {
+    if (id2queue.second != self_swsr_queue) {
+      id2queue.second->stop_reading();
+    }
   }
   swsr_send_queues.clear();
   swsr_recv_queues.clear();
@@ -131,7 +332,7 @@ void ActorBehaviorX::setup_swsr_connection(const Actor& x) {
       this->setup_swsr_connection(r);
     },
     [&](const RemoteActorHandle& r) {
-      this->setup_swsr_connection(r.net_sender_info->net_sender);
+      this->setup_swsr_connection(r.net_sender_info->net_sender_of(r.remote_actor));
     }
   });
 }
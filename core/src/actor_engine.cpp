@@ -1,3 +1,9 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+
 #include "zaf/actor_engine.hpp"
 #include "zaf/zaf_exception.hpp"
 
@@ -7,8 +13,62 @@ namespace zaf {
 Actor ActorEngine::spawn(ActorBehavior* new_actor) {
   new_actor->initialize_actor(forwarder->get_actor_system(), *this);
   this->inc_num_alive_actors();
-  forwarder->send(executors[next_executor++ % num_executors], Executor::NewActor, new_actor);
-  return Actor{new_actor->get_local_actor_handle()};
+  // the actor may terminate and be deleted by an executor before `spawn` returns
+  Actor actor{new_actor->get_local_actor_handle()};
+  if (scheduling == Scheduling::WorkStealing) {
+    add_runnable(new Runnable(*this, new_actor, next_executor++ % num_executors));
+  } else {
+    forwarder->send(executors[next_executor++ % num_executors], Executor::NewActor, new_actor);
+  }
+  return actor;
+}
+
+Actor ActorEngine::spawn_in_fiber(ActorBehavior* new_actor, std::function<void()> body) {
+  if (scheduling != Scheduling::WorkStealing) {
+    delete new_actor;
+    throw ZAFException("Actors spawned with a callable are only supported under WorkStealing scheduling.");
+  }
+  if (new_actor->is_blocking()) {
+    auto name = new_actor->get_name();
+    delete new_actor;
+    throw ZAFException("Attempt to run blocking actor ", name, " in a fiber.");
+  }
+  if (new_actor->get_local_actor_handle().use_swsr_msg_delivery) {
+    // an ActorBehaviorX in a fiber would block the executor when it pushes to a full SWSR queue
+    auto name = new_actor->get_name();
+    delete new_actor;
+    throw ZAFException("Attempt to run ActorBehaviorX ", name, " in a fiber.");
+  }
+  new_actor->initialize_actor(forwarder->get_actor_system(), *this);
+  this->inc_num_alive_actors();
+  Actor actor{new_actor->get_local_actor_handle()};
+  auto runnable = new Runnable(*this, new_actor, next_executor++ % num_executors);
+  runnable->fiber = std::make_unique<Fiber>([body = std::move(body)]() {
+    try {
+      body();
+    } catch (const std::exception& e) {
+      std::cerr << "Exception caught when running an actor at "
+        << __PRETTY_FUNCTION__ << std::endl;
+      print_exception(e);
+    } catch (...) {
+      std::cerr << "Unknown exception caught when running an actor at "
+        << __PRETTY_FUNCTION__ << std::endl;
+    }
+  }, fiber_stack_size);
+  runnable->in_fiber = true;
+  new_actor->set_mailbox_waiter(runnable);
+  add_runnable(runnable);
+  return actor;
+}
+
+void ActorEngine::add_runnable(Runnable* runnable) {
+  runnable->actor->get_mailbox().set_listener(std::unique_ptr<MailboxListener>(runnable));
+  {
+    std::lock_guard<std::mutex> _(runnables_mutex);
+    runnables.insert(runnable);
+  }
+  // the runnable is created as Scheduled, the first run starts the actor
+  schedule(runnable, runnable->eid);
 }
 
 void ActorEngine::init_scoped_actor(ActorBehavior& new_actor) {
@@ -23,16 +83,35 @@ void ActorEngine::set_load_rebalance_period(size_t period) {
   this->load_rebalance_period = period;
 }
 
-ActorEngine::ActorEngine(ActorSystem& actor_system, size_t num_executors) {
-  initialize(actor_system, num_executors);
+void ActorEngine::set_max_messages_per_run(size_t max_messages) {
+  this->max_messages_per_run = std::max(max_messages, size_t(1));
+}
+
+void ActorEngine::set_fiber_stack_size(size_t stack_size) {
+  this->fiber_stack_size = stack_size;
+}
+
+ActorEngine::ActorEngine(ActorSystem& actor_system, size_t num_executors,
+  Scheduling scheduling) {
+  initialize(actor_system, num_executors, scheduling);
 }
 
-void ActorEngine::initialize(ActorSystem& actor_system, size_t num_executors) {
+void ActorEngine::initialize(ActorSystem& actor_system, size_t num_executors,
+  Scheduling scheduling) {
   if (this->num_executors != 0) {
     throw ZAFException("Attempt to initialize an active ActorEngine.");
   }
+  this->scheduling = scheduling;
   this->num_executors = num_executors;
   this->forwarder = actor_system.create_scoped_actor();
+  if (scheduling == Scheduling::WorkStealing) {
+    this->run_queues.clear();
+    for (size_t i = 0; i < num_executors; i++) {
+      this->run_queues.emplace_back(std::make_unique<RunQueue>());
+    }
+  }
+  this->stop_requested = false;
+  this->num_running_executors = num_executors;
   this->executors.resize(num_executors);
   for (size_t i = 0; i < num_executors; i++) {
     this->executors[i] = actor_system.spawn<Executor>(*this, i);
@@ -50,9 +129,7 @@ void ActorEngine::initialize(ActorSystem& actor_system, size_t num_executors) {
 }
 
 void ActorEngine::terminate() {
-  for (auto& e : executors) {
-    forwarder->send(e, Executor::Termination);
-  }
+  stop_executors();
   await_all_actors_done();
   this->forwarder = nullptr;
   executors.clear();
@@ -63,16 +140,225 @@ ActorSystem& ActorEngine::get_actor_system() {
   return forwarder->get_actor_system();
 }
 
+size_t ActorEngine::get_num_executors() const {
+  return num_executors;
+}
+
 ActorEngine::~ActorEngine() {
   await_all_actors_done();
-  for (auto& e : executors) {
-    forwarder->send(e, Executor::Termination);
-  }
+  stop_executors();
   this->forwarder = nullptr;
   executors.clear();
   num_executors = 0;
 }
 
+void ActorEngine::stop_executors() {
+  if (executors.empty()) {
+    return;
+  }
+  if (scheduling == Scheduling::Polling) {
+    for (auto& e : executors) {
+      forwarder->send(e, Executor::Termination);
+    }
+  }
+  {
+    std::unique_lock<std::mutex> lock(executors_mutex);
+    stop_requested = true;
+    idle_cv.notify_all();
+    // executors refer to the engine until they exit
+    executors_done_cv.wait(lock, [&]() { return num_running_executors == 0; });
+  }
+  if (scheduling == Scheduling::Polling) {
+    return;
+  }
+  // stop the actors that are still alive
+  DefaultHashSet<Runnable*> remaining;
+  {
+    std::lock_guard<std::mutex> _(runnables_mutex);
+    std::swap(remaining, runnables);
+  }
+  for (auto& q : run_queues) {
+    std::lock_guard<std::mutex> _(q->mutex);
+    q->runnables.clear();
+  }
+  for (auto r : remaining) {
+    retire(r);
+  }
+}
+
+ActorEngine::Runnable::Runnable(ActorEngine& engine, ActorBehavior* actor, size_t eid):
+  engine(engine),
+  actor(actor),
+  eid(eid) {
+}
+
+bool ActorEngine::Runnable::on_mailbox_signaled() {
+  auto s = state.load(std::memory_order_acquire);
+  while (true) {
+    switch (s) {
+      case Idle: {
+        if (state.compare_exchange_weak(s, Scheduled, std::memory_order_acq_rel)) {
+          engine.schedule(this, eid);
+          return true;
+        }
+        break;
+      }
+      case Running: {
+        if (state.compare_exchange_weak(s, RunningNotified, std::memory_order_acq_rel)) {
+          // also signal the mailbox in case the actor is blocked in a nested receive,
+          // which does not happen in a fiber as the fiber waits by suspending
+          return in_fiber;
+        }
+        break;
+      }
+      case RunningNotified: {
+        return false;
+      }
+      default: { // Scheduled or Dead
+        return true;
+      }
+    }
+  }
+}
+
+void ActorEngine::Runnable::wait(long timeout) {
+  if (timeout > 0) {
+    engine.add_timer(this, std::chrono::steady_clock::now() + std::chrono::milliseconds{timeout});
+  }
+  // the executor makes the runnable Idle or schedules it again after the fiber suspends
+  fiber->suspend();
+}
+
+void ActorEngine::schedule(Runnable* runnable, size_t eid) {
+  {
+    auto& q = *run_queues[eid];
+    std::lock_guard<std::mutex> _(q.mutex);
+    // the runnables are retired by `stop_executors` once stop is requested
+    if (stop_requested.load(std::memory_order_relaxed)) {
+      return;
+    }
+    q.runnables.push_back(runnable);
+  }
+  // pairs with the increment in `park_executor`
+  if (num_idle_executors.load(std::memory_order_seq_cst) != 0) {
+    std::lock_guard<std::mutex> _(executors_mutex);
+    idle_cv.notify_one();
+  }
+}
+
+ActorEngine::Runnable* ActorEngine::next_runnable(size_t eid) {
+  { // take from the front of its own queue
+    auto& q = *run_queues[eid];
+    std::lock_guard<std::mutex> _(q.mutex);
+    if (!q.runnables.empty()) {
+      auto r = q.runnables.front();
+      q.runnables.pop_front();
+      return r;
+    }
+  }
+  // steal from the back of the queues of other executors
+  for (size_t i = 1; i < num_executors; i++) {
+    auto& q = *run_queues[(eid + i) % num_executors];
+    std::lock_guard<std::mutex> _(q.mutex);
+    if (!q.runnables.empty()) {
+      auto r = q.runnables.back();
+      q.runnables.pop_back();
+      return r;
+    }
+  }
+  return nullptr;
+}
+
+bool ActorEngine::has_runnables() {
+  for (auto& q : run_queues) {
+    std::lock_guard<std::mutex> _(q->mutex);
+    if (!q->runnables.empty()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ActorEngine::park_executor() {
+  std::unique_lock<std::mutex> lock(executors_mutex);
+  // must increase before checking the queues and the timers,
+  // pairs with the loads in `schedule` and `add_timer`
+  num_idle_executors.fetch_add(1, std::memory_order_seq_cst);
+  if (!stop_requested && !has_runnables()) {
+    auto deadline = next_timer_deadline.load(std::memory_order_seq_cst);
+    if (deadline == std::numeric_limits<TimePoint::rep>::max()) {
+      idle_cv.wait(lock);
+    } else {
+      idle_cv.wait_until(lock, TimePoint{TimePoint::duration{deadline}});
+    }
+  }
+  num_idle_executors.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void ActorEngine::add_timer(Runnable* runnable, TimePoint deadline) {
+  {
+    std::lock_guard<std::mutex> _(timers_mutex);
+    if (runnable->has_timer) {
+      if (runnable->timer->first <= deadline) {
+        return;
+      }
+      timers.erase(runnable->timer);
+    }
+    runnable->timer = timers.emplace(deadline, runnable);
+    runnable->has_timer = true;
+    if (runnable->timer != timers.begin()) {
+      return;
+    }
+    // must be seq_cst, pairs with the increment in `park_executor`
+    next_timer_deadline.store(deadline.time_since_epoch().count(), std::memory_order_seq_cst);
+  }
+  // wake up an idle executor to wait for the new earliest deadline
+  if (num_idle_executors.load(std::memory_order_seq_cst) != 0) {
+    std::lock_guard<std::mutex> _(executors_mutex);
+    idle_cv.notify_one();
+  }
+}
+
+void ActorEngine::remove_timer(Runnable* runnable) {
+  std::lock_guard<std::mutex> _(timers_mutex);
+  if (runnable->has_timer) {
+    timers.erase(runnable->timer);
+    runnable->has_timer = false;
+  }
+}
+
+void ActorEngine::fire_timers() {
+  std::lock_guard<std::mutex> _(timers_mutex);
+  auto now = std::chrono::steady_clock::now();
+  while (!timers.empty() && timers.begin()->first <= now) {
+    auto runnable = timers.begin()->second;
+    runnable->has_timer = false;
+    timers.erase(timers.begin());
+    // the runnable is not deleted before its timer is removed under the lock
+    runnable->on_mailbox_signaled();
+  }
+  next_timer_deadline.store(timers.empty()
+    ? std::numeric_limits<TimePoint::rep>::max()
+    : timers.begin()->first.time_since_epoch().count(), std::memory_order_relaxed);
+}
+
+void ActorEngine::retire(Runnable* runnable) {
+  auto actor = runnable->actor;
+  runnable->state.store(Runnable::Dead, std::memory_order_release);
+  remove_timer(runnable);
+  runnable->handlers = MessageHandlers{};
+  runnable->actor = nullptr;
+  if (runnable->fiber) {
+    // an unfinished fiber is dropped without unwinding its stack
+    runnable->fiber = nullptr;
+  } else {
+    actor->stop();
+  }
+  dec_num_alive_actors();
+  // the runnable is owned by the mailbox of the actor and may be deleted together with the actor
+  delete actor;
+}
+
 // this function is invoked by executor[0]
 void ActorEngine::Executor::load_rebalance() {
   auto load_info_index = engine.current_load_info_index;
@@ -110,13 +396,24 @@ ActorEngine::Executor::Executor(ActorEngine& engine, size_t eid):
   eid(eid) {
 }
 
+bool ActorEngine::Executor::is_blocking() const {
+  return true;
+}
+
 MessageHandlers ActorEngine::Executor::behavior() {
   return {
     NewActor - [=](ActorBehavior* new_actor) {
+      new_actor->set_executor_driven();
       new_actor->activate();
       new_actor->start();
-      if (new_actor->is_activated()) {
+      // an actor that terminates in `start` may still have messages to send
+      if (new_actor->is_activated() || new_actor->has_side_messages()) {
         listen_to_actor(new_actor, new_actor->behavior());
+      } else {
+        // the actor terminates in `start`
+        new_actor->stop();
+        engine.dec_num_alive_actors();
+        delete new_actor;
       }
     },
     Rebalance - [=](const Actor& peer) {
@@ -147,29 +444,65 @@ MessageHandlers ActorEngine::Executor::behavior() {
 void ActorEngine::Executor::listen_to_actor(ActorBehavior* new_actor, MessageHandlers&& handler) {
   actors.push_back(new_actor);
   handlers.emplace_back(std::move(handler));
-  poll_items.emplace_back(zmq::pollitem_t{
-    new_actor->get_recv_socket().handle(), 0, ZMQ_POLLIN, 0
-  });
+  poll_items.emplace_back(new_actor->get_mailbox().get_poll_item());
   ++num_poll_items;
 }
 
+void ActorEngine::Executor::initialize_actor(ActorSystem& sys, ActorGroup& group) {
+  this->ActorBehavior::initialize_actor(sys, group);
+  // registered before the executor starts, so that its metrics are listed once it is spawned
+  if constexpr (ENABLE_METRICS) {
+    executor_metrics.name = to_string("ZAF/E", this->get_actor_id());
+    executor_metrics.eid = eid;
+    executor_metrics.last_lap = std::chrono::steady_clock::now();
+    sys.get_metrics_registry().add(&executor_metrics);
+  }
+}
+
 void ActorEngine::Executor::launch() {
   thread::set_name(to_string("ZAF/E", this->get_actor_id()));
+  if constexpr (ENABLE_METRICS) {
+    executor_metrics.last_lap = std::chrono::steady_clock::now();
+  }
+  if (engine.scheduling == Scheduling::WorkStealing) {
+    launch_work_stealing();
+    return;
+  }
   listen_to_actor(this, this->behavior());
   this->activate();
+  // whether some actor has messages not in its mailbox to process, e.g., in its SWSR queues,
+  // in which case the executor polls the mailboxes without blocking
+  bool has_side_messages = false;
   while (true) {
-    // block until receive a message
+    // block until receive a message, unless there are side messages to process
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
-    int npoll = zmq::poll(poll_items);
+    int npoll = zmq::poll(poll_items, has_side_messages ? 0l : -1l);
 #pragma GCC diagnostic pop
-    if (npoll == 0) {
+    if constexpr (ENABLE_METRICS) {
+      executor_metrics.lap(executor_metrics.idle_ns);
+    }
+    if (npoll == 0 && !has_side_messages) {
       continue;
     }
+    if constexpr (ENABLE_METRICS) {
+      executor_metrics.wakeups.add();
+    }
+    has_side_messages = false;
     for (size_t i = 0; i < num_poll_items; i++) {
-      if (poll_items[i].revents & ZMQ_POLLIN) {
+      // actors transferred to this executor are checked as well
+      if ((poll_items[i].revents & ZMQ_POLLIN) || actors[i]->has_side_messages()) {
+        if constexpr (ENABLE_METRICS) {
+          executor_metrics.runs.add();
+        }
         try {
-          actors[i]->receive_once(handlers[i]);
+          if ((poll_items[i].revents & ZMQ_POLLIN) && actors[i]->is_activated()) {
+            // non-blocking because the mailbox may be signaled without any message to read
+            actors[i]->receive_batch(handlers[i], engine.max_messages_per_run, long(0));
+          }
+          if (actors[i]->has_side_messages()) {
+            actors[i]->receive_side_messages(handlers[i], engine.max_messages_per_run);
+          }
         } catch (const std::exception& e) {
           std::cerr << "Exception caught when running an actor at " << __PRETTY_FUNCTION__ << std::endl;
           print_exception(e);
@@ -179,7 +512,7 @@ void ActorEngine::Executor::launch() {
           actors[i]->deactivate();
         }
 
-        if (!actors[i]->is_activated() && i != 0) {
+        if (!actors[i]->is_activated() && !actors[i]->has_side_messages() && i != 0) {
           actors[i]->stop();
           engine.dec_num_alive_actors();
           delete actors[i];
@@ -192,9 +525,15 @@ void ActorEngine::Executor::launch() {
           poll_items.pop_back();
           num_poll_items--;
           i--;
+        } else if (actors[i]->has_side_messages()) {
+          has_side_messages = true;
         }
       }
     }
+    if constexpr (ENABLE_METRICS) {
+      executor_metrics.lap(executor_metrics.busy_ns);
+      executor_metrics.num_actors.set(num_poll_items - 1);
+    }
     if (!this->is_activated()) {
       break;
     }
@@ -220,5 +559,114 @@ void ActorEngine::Executor::launch() {
   poll_items.clear();
   handlers.clear();
   num_poll_items = 0;
+  exit();
+}
+
+void ActorEngine::Executor::launch_work_stealing() {
+  this->activate();
+  while (!engine.stop_requested.load(std::memory_order_relaxed)) {
+    auto deadline = engine.next_timer_deadline.load(std::memory_order_relaxed);
+    if (deadline != std::numeric_limits<TimePoint::rep>::max() &&
+        deadline <= std::chrono::steady_clock::now().time_since_epoch().count()) {
+      engine.fire_timers();
+    }
+    if (auto runnable = engine.next_runnable(eid)) {
+      run(runnable);
+      if constexpr (ENABLE_METRICS) {
+        executor_metrics.runs.add();
+        executor_metrics.lap(executor_metrics.busy_ns);
+      }
+    } else {
+      if constexpr (ENABLE_METRICS) {
+        executor_metrics.lap(executor_metrics.busy_ns);
+      }
+      engine.park_executor();
+      if constexpr (ENABLE_METRICS) {
+        executor_metrics.lap(executor_metrics.idle_ns);
+        executor_metrics.wakeups.add();
+      }
+    }
+  }
+  this->deactivate();
+  exit();
+}
+
+void ActorEngine::Executor::exit() {
+  if constexpr (ENABLE_METRICS) {
+    this->get_actor_system().get_metrics_registry().remove(&executor_metrics);
+  }
+  std::lock_guard<std::mutex> _(engine.executors_mutex);
+  if (--engine.num_running_executors == 0) {
+    engine.executors_done_cv.notify_all();
+  }
+}
+
+void ActorEngine::Executor::run(Runnable* runnable) {
+  runnable->state.store(Runnable::Running, std::memory_order_release);
+  runnable->eid = eid;
+  auto actor = runnable->actor;
+  auto& mailbox = actor->get_mailbox();
+  size_t num_runs = 0;
+  try {
+    if (runnable->fiber) {
+      // run the callable until it waits for messages or returns
+      runnable->fiber->resume();
+    } else {
+      if (!runnable->started) {
+        runnable->started = true;
+        actor->set_executor_driven();
+        actor->activate();
+        actor->start();
+        if (actor->is_activated()) {
+          runnable->handlers = actor->behavior();
+        }
+      }
+      // check before receiving to avoid polling the mailbox when it is empty,
+      // unless there are delayed messages to flush
+      auto next_delayed = actor->get_next_delayed_message_time();
+      if (actor->is_activated() && (!mailbox.empty() ||
+          (next_delayed && *next_delayed <= std::chrono::steady_clock::now()))) {
+        num_runs = actor->receive_batch(runnable->handlers, engine.max_messages_per_run, long(0));
+      }
+      if (actor->has_side_messages()) {
+        num_runs += actor->receive_side_messages(runnable->handlers, engine.max_messages_per_run);
+      }
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "Exception caught when running an actor at " << __PRETTY_FUNCTION__ << std::endl;
+    print_exception(e);
+    actor->deactivate();
+  } catch (...) {
+    std::cerr << "Unknown exception caught when running an actor at " << __PRETTY_FUNCTION__ << std::endl;
+    actor->deactivate();
+  }
+  // an actor in a fiber terminates when its callable returns
+  if (runnable->fiber ? runnable->fiber->is_done()
+      : !actor->is_activated() && !actor->has_side_messages()) {
+    {
+      std::lock_guard<std::mutex> _(engine.runnables_mutex);
+      engine.runnables.erase(runnable);
+    }
+    engine.retire(runnable);
+    return;
+  }
+  if (auto next_delayed = actor->get_next_delayed_message_time()) {
+    engine.add_timer(runnable, *next_delayed);
+  }
+  // the actor is not signaled for its side messages, e.g., those in its SWSR queues
+  if (num_runs >= engine.max_messages_per_run || (!runnable->fiber && actor->has_side_messages())) {
+    // give other actors a chance to run
+    runnable->state.store(Runnable::Scheduled, std::memory_order_release);
+    engine.schedule(runnable, eid);
+    return;
+  }
+  // let writers notify the runnable again, and the mailbox signals if new messages arrive in the meantime
+  mailbox.prepare_wait();
+  int running = Runnable::Running;
+  if (!runnable->state.compare_exchange_strong(running, Runnable::Idle, std::memory_order_acq_rel)) {
+    // RunningNotified
+    runnable->state.store(Runnable::Scheduled, std::memory_order_release);
+    engine.schedule(runnable, eid);
+  }
 }
 } // namespace zaf
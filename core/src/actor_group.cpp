@@ -18,10 +18,8 @@ void ActorGroup::await_all_actors_done() {
 }
 
 void ActorGroup::await_alive_actors_done() {
-  if (num_alive_actors.load(std::memory_order_relaxed) ==
-      num_detached_actors.load(std::memory_order_relaxed)) {
-    return;
-  }
+  // Always lock so that the function returns only after the last actor
+  // has released the mutex in `dec_num_alive_actors`.
   std::unique_lock<std::mutex> lock(await_actors_done_mtx);
   alive_actors_done_cv.wait(lock, [&]() {
     return num_alive_actors.load(std::memory_order_relaxed) ==
@@ -42,13 +40,14 @@ void ActorGroup::inc_num_detached_actors() {
 }
 
 void ActorGroup::dec_num_alive_actors() {
+  // Decrease within the lock, otherwise the ActorGroup may be destroyed by
+  // the waiter before the mutex is locked here.
+  std::lock_guard<std::mutex> _(await_actors_done_mtx);
   auto num_alive = num_alive_actors.fetch_sub(1, std::memory_order_relaxed) - 1;
   if (num_alive == num_detached_actors.load(std::memory_order_relaxed)) {
-    std::lock_guard<std::mutex> _(await_actors_done_mtx);
     this->alive_actors_done_cv.notify_one();
   }
   if (num_alive == 0) {
-    std::lock_guard<std::mutex> _(await_actors_done_mtx);
     this->all_actors_done_cv.notify_one();
   }
 }
@@ -57,6 +56,10 @@ void ActorGroup::dec_num_detached_actors() {
   num_detached_actors.fetch_sub(1, std::memory_order_relaxed);
 }
 
+size_t ActorGroup::get_num_alive_actors() const {
+  return num_alive_actors.load(std::memory_order_relaxed);
+}
+
 void ActorGroup::add_terminator(std::function<void(ScopedActor<ActorBehavior>&)> t) {
   terminator_mutex.lock();
   terminators.push_back(t);
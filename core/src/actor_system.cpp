@@ -1,9 +1,19 @@
+#include <algorithm>
+#include <thread>
+
 #include "zaf/actor_behavior.hpp"
+#include "zaf/actor_engine.hpp"
 #include "zaf/actor_system.hpp"
+#include "zaf/mailbox.hpp"
 #include "zaf/scoped_actor.hpp"
 
 namespace zaf {
+ActorSystem::ActorSystem() = default;
+
 Actor ActorSystem::spawn(ActorBehavior* new_actor) {
+  if (!new_actor->is_blocking()) {
+    return get_scheduler().spawn(new_actor);
+  }
   new_actor->initialize_actor(*this, *this);
   std::thread([new_actor]() mutable {
     try {
@@ -21,6 +31,50 @@ Actor ActorSystem::spawn(ActorBehavior* new_actor) {
   return Actor{new_actor->get_local_actor_handle()};
 }
 
+ActorEngine& ActorSystem::get_scheduler() {
+  std::lock_guard<std::mutex> _(scheduler_mutex);
+  if (!scheduler) {
+    auto n = num_scheduler_executors != 0 ? num_scheduler_executors
+      : std::max(size_t(std::thread::hardware_concurrency()), size_t(1));
+    scheduler = std::make_unique<ActorEngine>(*this, n, ActorEngine::Scheduling::WorkStealing);
+    // the executors and the forwarder of the scheduler are detached
+    for (size_t i = 0; i <= n; i++) {
+      this->inc_num_detached_actors();
+    }
+    this->add_terminator([this](auto&) {
+      this->stop_scheduler();
+    });
+  }
+  return *scheduler;
+}
+
+void ActorSystem::stop_scheduler() {
+  std::unique_ptr<ActorEngine> s;
+  {
+    std::lock_guard<std::mutex> _(scheduler_mutex);
+    if (!scheduler) {
+      return;
+    }
+    if (scheduler->get_num_alive_actors() != 0) {
+      // some detached actors are still run by the scheduler, check again after they are done
+      this->add_terminator([this](auto&) {
+        this->stop_scheduler();
+      });
+      return;
+    }
+    s = std::move(scheduler);
+  }
+  for (size_t i = 0, n = s->get_num_executors(); i <= n; i++) {
+    this->dec_num_detached_actors();
+  }
+  s->terminate();
+}
+
+void ActorSystem::set_num_scheduler_executors(size_t num_executors) {
+  std::lock_guard<std::mutex> _(scheduler_mutex);
+  num_scheduler_executors = num_executors;
+}
+
 void ActorSystem::init_scoped_actor(ActorBehavior& new_actor) {
   new_actor.initialize_actor(*this, *this);
 }
@@ -29,12 +83,49 @@ zmq::context_t& ActorSystem::get_zmq_context() {
   return zmq_context;
 }
 
+void ActorSystem::register_mailbox(ActorIdType id, const std::shared_ptr<Mailbox>& mailbox) {
+  std::lock_guard<std::mutex> _(mailboxes_mutex);
+  mailboxes[id] = mailbox;
+}
+
+void ActorSystem::deregister_mailbox(ActorIdType id, const std::shared_ptr<Mailbox>& mailbox) {
+  std::lock_guard<std::mutex> _(mailboxes_mutex);
+  auto iter = mailboxes.find(id);
+  // the id may have been reused by another actor
+  if (iter != mailboxes.end() && iter->second == mailbox) {
+    mailboxes.erase(iter);
+  }
+}
+
+std::shared_ptr<Mailbox> ActorSystem::lookup_mailbox(ActorIdType id) {
+  std::lock_guard<std::mutex> _(mailboxes_mutex);
+  auto iter = mailboxes.find(id);
+  return iter == mailboxes.end() ? nullptr : iter->second;
+}
+
 ActorIdType ActorSystem::get_next_available_actor_id() {
   return next_available_actor_id.fetch_add(1, std::memory_order_relaxed) % MaxActorId;
 }
 
+MetricsSnapshot ActorSystem::snapshot_metrics() const {
+  return metrics_registry.snapshot();
+}
+
+void ActorSystem::dump_metrics(const std::string& path, std::chrono::milliseconds period) {
+  metrics_registry.start_dump(path, period);
+}
+
+void ActorSystem::stop_dumping_metrics() {
+  metrics_registry.stop_dump();
+}
+
+MetricsRegistry& ActorSystem::get_metrics_registry() {
+  return metrics_registry;
+}
+
 ActorSystem::~ActorSystem() {
   this->await_all_actors_done();
+  metrics_registry.stop_dump();
   zmq_context.close();
 }
 
@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include "zaf/compression.hpp"
+#include "zaf/macros.hpp"
+#include "zaf/zaf_exception.hpp"
+
+#if ENABLE_LZ4
+#include "lz4.h"
+#endif
+
+namespace zaf {
+namespace compression {
+bool is_supported(Compression codec) {
+  switch (codec) {
+    case Compression::None:
+      return true;
+    case Compression::LZ4:
+      return ENABLE_LZ4;
+  }
+  return false;
+}
+
+size_t max_compressed_size(Compression codec, size_t size) {
+  switch (codec) {
+    case Compression::None:
+      return size;
+    case Compression::LZ4:
+#if ENABLE_LZ4
+      if (size <= size_t(LZ4_MAX_INPUT_SIZE)) {
+        return LZ4_compressBound(int(size));
+      }
+#endif
+      return 0;
+  }
+  return 0;
+}
+
+size_t compress(Compression codec, const char* src, size_t size, char* dst, size_t capacity) {
+  switch (codec) {
+    case Compression::None:
+      if (size > capacity) {
+        return 0;
+      }
+      std::memcpy(dst, src, size);
+      return size;
+    case Compression::LZ4:
+#if ENABLE_LZ4
+      if (size > size_t(LZ4_MAX_INPUT_SIZE)) {
+        return 0;
+      }
+      // LZ4 returns 0 (or a negative value for invalid arguments) if it fails,
+      // e.g., the output does not fit into `capacity`
+      if (int ret = LZ4_compress_default(src, dst, int(size), int(std::min(capacity, size_t(INT_MAX))));
+          ret > 0) {
+        return size_t(ret);
+      }
+      return 0;
+#else
+      throw ZAFException("Attempt to compress bytes with LZ4 but ZAF is built without LZ4");
+#endif
+  }
+  throw ZAFException("Unknown compression codec: ", int(codec));
+}
+
+void decompress(Compression codec, const char* src, size_t size, char* dst, size_t raw_size) {
+  switch (codec) {
+    case Compression::None:
+      if (size != raw_size) {
+        throw ZAFException("Expect ", raw_size, " uncompressed bytes but receive ", size, " bytes");
+      }
+      std::memcpy(dst, src, size);
+      return;
+    case Compression::LZ4:
+#if ENABLE_LZ4
+      if (size > size_t(INT_MAX) || raw_size > size_t(INT_MAX) ||
+          LZ4_decompress_safe(src, dst, int(size), int(raw_size)) != int(raw_size)) {
+        throw ZAFException("Failed to decompress ", size, " bytes into ", raw_size, " bytes with LZ4");
+      }
+      return;
+#else
+      throw ZAFException("Attempt to decompress bytes with LZ4 but ZAF is built without LZ4");
+#endif
+  }
+  throw ZAFException("Unknown compression codec: ", int(codec));
+}
+} // namespace compression
+} // namespace zaf
@@ -17,6 +17,10 @@ DelayedMessage::DelayedMessage(const Actor& r, MessageBytes&& m):
   message(std::move(m)) {
 }
 
+DelayedMessage::DelayedMessage(RequestDeadline d):
+  message(d) {
+}
+
 DelayedMessage::DelayedMessage(DelayedMessage&& m):
   receiver(std::move(m.receiver)) {
   std::visit(overloaded {
@@ -26,6 +30,9 @@ DelayedMessage::DelayedMessage(DelayedMessage&& m):
     },
     [&](MessageBytes& bytes) {
       this->message = std::move(bytes);
+    },
+    [&](RequestDeadline& d) {
+      this->message = d;
     }
   }, m.message);
 }
@@ -39,6 +46,9 @@ DelayedMessage& DelayedMessage::operator=(DelayedMessage&& m) {
     },
     [&](MessageBytes& bytes) {
       this->message = std::move(bytes);
+    },
+    [&](RequestDeadline& d) {
+      this->message = d;
     }
   }, m.message);
   return *this;
@@ -0,0 +1,79 @@
+#include <cerrno>
+#include <functional>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "zaf/fiber.hpp"
+#include "zaf/zaf_exception.hpp"
+
+namespace zaf {
+namespace {
+thread_local Fiber* current_fiber = nullptr;
+} // namespace
+
+Fiber::Fiber(std::function<void()> body, size_t stack_size):
+  body(std::move(body)) {
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  const size_t rounded_stack_size = (stack_size + page_size - 1) / page_size * page_size;
+  mapping_size = rounded_stack_size + page_size;
+  mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED) {
+    mapping = nullptr;
+    throw ZAFException("Failed to map the stack of a Fiber. Error: ", errno);
+  }
+  // the stack grows downwards, an overflow hits the guard page
+  if (mprotect(mapping, page_size, PROT_NONE) == -1) {
+    munmap(mapping, mapping_size);
+    mapping = nullptr;
+    throw ZAFException("Failed to protect the guard page of a Fiber. Error: ", errno);
+  }
+  if (getcontext(&context) == -1) {
+    munmap(mapping, mapping_size);
+    mapping = nullptr;
+    throw ZAFException("Failed to get the context for a Fiber. Error: ", errno);
+  }
+  context.uc_stack.ss_sp = static_cast<char*>(mapping) + page_size;
+  context.uc_stack.ss_size = rounded_stack_size;
+  // return to the latest resumer when `entry` returns
+  context.uc_link = &caller;
+  makecontext(&context, &Fiber::entry, 0);
+}
+
+void Fiber::entry() {
+  // read once before the body, which may be resumed by other threads
+  auto self = current_fiber;
+  self->body();
+  self->done = true;
+}
+
+void Fiber::resume() {
+  if (current_fiber) {
+    throw ZAFException("Attempt to resume a Fiber inside another Fiber.");
+  }
+  if (done) {
+    throw ZAFException("Attempt to resume a finished Fiber.");
+  }
+  current_fiber = this;
+  swapcontext(&caller, &context);
+  current_fiber = nullptr;
+}
+
+void Fiber::suspend() {
+  swapcontext(&context, &caller);
+}
+
+bool Fiber::is_done() const {
+  return done;
+}
+
+Fiber* Fiber::current() {
+  return current_fiber;
+}
+
+Fiber::~Fiber() {
+  if (mapping) {
+    munmap(mapping, mapping_size);
+  }
+}
+} // namespace zaf
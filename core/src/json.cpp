@@ -0,0 +1,19 @@
+#include "zaf/json.hpp"
+
+namespace zaf {
+namespace json {
+void write_string(std::ostream& out, const std::string& str) {
+  out << '"';
+  for (auto c : str) {
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      out << ' ';
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+}
+} // namespace json
+} // namespace zaf
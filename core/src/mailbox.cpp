@@ -0,0 +1,195 @@
+#include <cerrno>
+#include <cstdint>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+#include "zaf/mailbox.hpp"
+#include "zaf/message.hpp"
+#include "zaf/zaf_exception.hpp"
+
+#include "zmq.hpp"
+
+namespace zaf {
+Mailbox::Mailbox():
+  head(&stub),
+  tail(&stub) {
+#ifdef __linux__
+  read_fd = write_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (read_fd == -1) {
+    throw ZAFException("Failed to create eventfd for Mailbox. Error: ", errno);
+  }
+#else
+  int fds[2];
+  if (pipe(fds) == -1) {
+    throw ZAFException("Failed to create pipe for Mailbox. Error: ", errno);
+  }
+  for (auto fd : fds) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+  }
+  read_fd = fds[0];
+  write_fd = fds[1];
+#endif
+}
+
+void Mailbox::push(Message* m) {
+  MailboxNode* node = m;
+  node->next_in_mailbox.store(nullptr, std::memory_order_relaxed);
+  if constexpr (ENABLE_METRICS) {
+    // counted before the message can be popped
+    num_pushed.fetch_add(1, std::memory_order_relaxed);
+  }
+  auto prev = head.exchange(node, std::memory_order_acq_rel);
+  prev->next_in_mailbox.store(node, std::memory_order_release);
+  // must be seq_cst, pairs with the exchange in `prepare_wait`
+  if (!notified.exchange(true, std::memory_order_seq_cst)) {
+    signal();
+  }
+}
+
+Message* Mailbox::try_pop() {
+  auto m = take();
+  if constexpr (ENABLE_METRICS) {
+    if (m) {
+      num_popped.store(num_popped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+  }
+  return m;
+}
+
+Message* Mailbox::take() {
+  auto t = tail;
+  auto next = t->next_in_mailbox.load(std::memory_order_acquire);
+  if (t == &stub) {
+    if (next == nullptr) {
+      return nullptr;
+    }
+    tail = t = next;
+    next = next->next_in_mailbox.load(std::memory_order_acquire);
+  }
+  if (next) {
+    tail = next;
+    return static_cast<Message*>(t);
+  }
+  if (t != head.load(std::memory_order_acquire)) {
+    // a writer is in the middle of `push`, the message will be ready soon
+    return nullptr;
+  }
+  // `t` is the last message, put the stub back so that `t` can be taken away
+  stub.next_in_mailbox.store(nullptr, std::memory_order_relaxed);
+  auto prev = head.exchange(&stub, std::memory_order_acq_rel);
+  prev->next_in_mailbox.store(&stub, std::memory_order_release);
+  next = t->next_in_mailbox.load(std::memory_order_acquire);
+  if (next) {
+    tail = next;
+    return static_cast<Message*>(t);
+  }
+  return nullptr;
+}
+
+bool Mailbox::empty() const {
+  // `tail` is either the stub or the next message to read
+  return tail == &stub &&
+    stub.next_in_mailbox.load(std::memory_order_acquire) == nullptr;
+}
+
+size_t Mailbox::approx_size() const {
+  auto popped = num_popped.load(std::memory_order_relaxed);
+  auto pushed = num_pushed.load(std::memory_order_relaxed);
+  // the counters are loaded without synchronization and may be seen out of order
+  return pushed > popped ? pushed - popped : 0;
+}
+
+bool Mailbox::prepare_wait() {
+  notified.exchange(false, std::memory_order_seq_cst);
+  clear_signal();
+  if (empty()) {
+    // Any writer that pushes after this point will see `notified` is false and signal
+    return true;
+  }
+  // Some writers pushed before `notified` is reset and thus did not signal.
+  // The signal may also have been cleared by `clear_signal` above.
+  // Restore the signal so that a poller of the mailbox keeps being woken up.
+  notified.store(true, std::memory_order_seq_cst);
+  signal();
+  return false;
+}
+
+zmq::pollitem_t Mailbox::get_poll_item() const {
+  return zmq::pollitem_t{nullptr, read_fd, ZMQ_POLLIN, 0};
+}
+
+void Mailbox::set_listener(std::unique_ptr<MailboxListener> l) {
+  if (listener.load(std::memory_order_relaxed)) {
+    throw ZAFException("Attempt to set the listener of a Mailbox twice.");
+  }
+  listener.store(l.release(), std::memory_order_release);
+}
+
+MailboxListener* Mailbox::get_listener() const {
+  return listener.load(std::memory_order_acquire);
+}
+
+void Mailbox::close() {
+  closed.store(true, std::memory_order_release);
+}
+
+bool Mailbox::is_closed() const {
+  return closed.load(std::memory_order_acquire);
+}
+
+void Mailbox::signal() {
+  if (auto l = listener.load(std::memory_order_acquire); l && l->on_mailbox_signaled()) {
+    return;
+  }
+#ifdef __linux__
+  uint64_t one = 1;
+  while (write(write_fd, &one, sizeof(one)) == -1 && errno == EINTR);
+#else
+  char one = 1;
+  // EAGAIN means the pipe is full, which is still readable
+  while (write(write_fd, &one, sizeof(one)) == -1 && errno == EINTR);
+#endif
+  // set after writing the fd, otherwise the reader may skip reading the fd
+  // after the flag is set but before the fd is written, and then the fd stays readable
+  // without the flag being set.
+  fd_signaled.store(true, std::memory_order_release);
+}
+
+void Mailbox::clear_signal() {
+  if (!fd_signaled.exchange(false, std::memory_order_acq_rel)) {
+    return;
+  }
+#ifdef __linux__
+  uint64_t count;
+  while (read(read_fd, &count, sizeof(count)) == -1 && errno == EINTR);
+#else
+  char buf[64];
+  while (true) {
+    auto n = read(read_fd, buf, sizeof(buf));
+    if (n > 0 || (n == -1 && errno == EINTR)) {
+      continue;
+    }
+    break;
+  }
+#endif
+}
+
+Mailbox::~Mailbox() {
+  while (!empty()) {
+    if (auto m = try_pop()) {
+      delete m;
+    }
+  }
+  delete listener.load(std::memory_order_acquire);
+  ::close(read_fd);
+  if (write_fd != read_fd) {
+    ::close(write_fd);
+  }
+}
+} // namespace zaf
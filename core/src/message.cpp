@@ -1,5 +1,6 @@
 #include "zaf/actor.hpp"
 #include "zaf/message.hpp"
+#include "zaf/message_pool.hpp"
 
 namespace zaf {
 Message::Message(const Actor& sender):
@@ -9,4 +10,21 @@ Message::Message(const Actor& sender):
 const Actor& Message::get_sender() const {
   return sender_actor;
 }
+
+void* Message::operator new(size_t size) {
+  return MessagePool::allocate(size);
+}
+
+void Message::operator delete(void* ptr, size_t size) {
+  MessagePool::deallocate(ptr, size);
+}
+
+// over-aligned messages are not pooled
+void* Message::operator new(size_t size, std::align_val_t align) {
+  return ::operator new(size, align);
+}
+
+void Message::operator delete(void* ptr, size_t size, std::align_val_t align) {
+  ::operator delete(ptr, size, align);
+}
 } // namespace zaf
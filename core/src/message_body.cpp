@@ -2,6 +2,7 @@
 
 #include "zaf/code.hpp"
 #include "zaf/message_body.hpp"
+#include "zaf/message_pool.hpp"
 #include "zaf/serializer.hpp"
 
 #include "zmq.hpp"
@@ -15,8 +16,26 @@ size_t MessageBody::get_code() const {
   return code;
 }
 
-MemoryMessageBody::MemoryMessageBody(Code code):
-  MessageBody(code) {
+void* MessageBody::operator new(size_t size) {
+  return MessagePool::allocate(size);
+}
+
+void MessageBody::operator delete(void* ptr, size_t size) {
+  MessagePool::deallocate(ptr, size);
+}
+
+// over-aligned message bodies are not pooled
+void* MessageBody::operator new(size_t size, std::align_val_t align) {
+  return ::operator new(size, align);
+}
+
+void MessageBody::operator delete(void* ptr, size_t size, std::align_val_t align) {
+  ::operator delete(ptr, size, align);
+}
+
+MemoryMessageBody::MemoryMessageBody(Code code, const void* content_type_tag):
+  MessageBody(code),
+  content_type_tag(content_type_tag) {
 }
 
 bool MemoryMessageBody::is_serialized() const {
@@ -40,7 +59,7 @@ TypedSerializedMessageBody<std::vector<char>>::TypedSerializedMessageBody(
 }
 
 Deserializer TypedSerializedMessageBody<std::vector<char>>::make_deserializer() const {
-  return {&content_bytes.front() + offset};
+  return {content_bytes.data() + offset, content_bytes.size() - offset};
 }
 
 size_t TypedSerializedMessageBody<std::vector<char>>::get_type_hash_code() const {
@@ -67,7 +86,7 @@ TypedSerializedMessageBody<zmq::message_t>::TypedSerializedMessageBody(
 }
 
 Deserializer TypedSerializedMessageBody<zmq::message_t>::make_deserializer() const {
-  return {content_bytes.data<char>() + offset};
+  return {content_bytes.data<char>() + offset, content_bytes.size() - offset};
 }
 
 size_t TypedSerializedMessageBody<zmq::message_t>::get_type_hash_code() const {
@@ -85,6 +104,32 @@ void TypedSerializedMessageBody<zmq::message_t>::serialize_content(Serializer& s
   s.write_bytes(content_bytes.data<char>() + offset, content_bytes.size() - offset);
 }
 
+TypedSerializedMessageBody<BatchSlice>::TypedSerializedMessageBody(
+  Code code, size_t types_hash, BatchSlice&& slice):
+  SerializedMessageBody(code),
+  slice(std::move(slice)),
+  types_hash(types_hash) {
+}
+
+Deserializer TypedSerializedMessageBody<BatchSlice>::make_deserializer() const {
+  return {slice.batch->data<char>() + slice.offset, slice.size};
+}
+
+size_t TypedSerializedMessageBody<BatchSlice>::get_type_hash_code() const {
+  return types_hash;
+}
+
+void TypedSerializedMessageBody<BatchSlice>::serialize(Serializer& s) {
+  s.write(get_code())
+   .write(types_hash)
+   .write(static_cast<unsigned>(slice.size))
+   .write_bytes(slice.batch->data<char>() + slice.offset, slice.size);
+}
+
+void TypedSerializedMessageBody<BatchSlice>::serialize_content(Serializer& s) {
+  s.write_bytes(slice.batch->data<char>() + slice.offset, slice.size);
+}
+
 void serialize(Serializer& s, MessageBody* body) {
   s.write(body->get_code())
    .write(body->get_type_hash_code());
@@ -1,44 +1,173 @@
+#include <atomic>
+
 #include "zaf/message_handlers.hpp"
 
 namespace zaf {
+namespace {
+// codes smaller than max(MinDenseCodes, DenseCodesPerHandler * #handlers) are indexed by the dense array
+constexpr size_t MinDenseCodes = 64;
+constexpr size_t DenseCodesPerHandler = 4;
+// the sparse codes are hashed if there are more than MaxSortedSparseCodes of them
+constexpr size_t MaxSortedSparseCodes = 8;
+
+std::atomic<uint64_t> next_handlers_version{1};
+
+inline uint64_t new_handlers_version() {
+  return next_handlers_version.fetch_add(1, std::memory_order_relaxed);
+}
+} // namespace
+
+void MessageHandlers::DispatchTable::build(
+  const std::vector<std::pair<size_t, MessageHandler*>>& handlers,
+  MessageHandler* default_handler) {
+  dense.clear();
+  sparse.clear();
+  auto dense_limit = std::max(MinDenseCodes, DenseCodesPerHandler * handlers.size());
+  for (auto& h : handlers) {
+    if (h.first < dense_limit) {
+      // the handlers are sorted, the last small code decides the size of the array
+      dense.resize(h.first + 1, nullptr);
+      dense[h.first] = h.second;
+    } else {
+      sparse.push_back(h);
+    }
+  }
+  sparse_hashed = sparse.size() > MaxSortedSparseCodes;
+  if (sparse_hashed) {
+    // keep the load factor at most 1/2
+    unsigned log_capacity = 1;
+    while ((size_t(1) << log_capacity) < sparse.size() * 2) {
+      ++log_capacity;
+    }
+    sparse_shift = 64 - log_capacity;
+    std::vector<std::pair<size_t, MessageHandler*>> slots(size_t(1) << log_capacity);
+    for (auto& h : sparse) {
+      auto i = hash(h.first);
+      while (slots[i].second) {
+        i = (i + 1) & (slots.size() - 1);
+      }
+      slots[i] = h;
+    }
+    sparse = std::move(slots);
+  }
+  this->default_handler = default_handler;
+}
+
 MessageHandlers::MessageHandlers(MessageHandlers&& other):
   handlers(std::move(other.handlers)),
   child(other.child),
-  default_handler(std::move(other.default_handler)) {
+  default_handler(std::move(other.default_handler)),
+  version(other.version),
+  table(std::move(other.table)),
+  merged_table(std::move(other.merged_table)),
+  merged_child(other.merged_child),
+  merged_child_version(other.merged_child_version),
+  merged_version(other.merged_version) {
   other.child = nullptr;
+  other.rebuild_table();
 }
 
 MessageHandlers& MessageHandlers::operator=(MessageHandlers&& other) {
   this->handlers = std::move(other.handlers);
   this->default_handler = std::move(other.default_handler);
   this->child = other.child;
+  this->version = other.version;
+  this->table = std::move(other.table);
+  this->merged_table = std::move(other.merged_table);
+  this->merged_child = other.merged_child;
+  this->merged_child_version = other.merged_child_version;
+  this->merged_version = other.merged_version;
   other.child = nullptr;
+  other.rebuild_table();
   return *this;
 }
 
+bool MessageHandlers::set_handler(size_t code, std::unique_ptr<MessageHandler>&& handler,
+  bool replace) {
+  auto iter = std::lower_bound(handlers.begin(), handlers.end(), code,
+    [](const std::pair<size_t, std::unique_ptr<MessageHandler>>& h, size_t code) {
+      return h.first < code;
+    });
+  if (iter != handlers.end() && iter->first == code) {
+    if (!replace) {
+      return false;
+    }
+    iter->second = std::move(handler);
+  } else {
+    handlers.emplace(iter, code, std::move(handler));
+  }
+  return true;
+}
+
+void MessageHandlers::rebuild_table() {
+  std::vector<std::pair<size_t, MessageHandler*>> raw_handlers;
+  raw_handlers.reserve(handlers.size());
+  for (auto& h : handlers) {
+    raw_handlers.emplace_back(h.first, h.second.get());
+  }
+  table.build(raw_handlers, default_handler.get());
+  version = new_handlers_version();
+}
+
+const MessageHandlers::DispatchTable* MessageHandlers::get_dispatch_table() {
+  if (!child) {
+    return &table;
+  }
+  if (child->child) {
+    return nullptr;
+  }
+  if (merged_child != child || merged_child_version != child->version ||
+      merged_version != version) {
+    // the handlers of this take precedence over those of the child,
+    // while the default handler of the child takes precedence over that of this.
+    std::vector<std::pair<size_t, MessageHandler*>> raw_handlers;
+    raw_handlers.reserve(handlers.size() + child->handlers.size());
+    auto i = handlers.begin();
+    auto j = child->handlers.begin();
+    while (i != handlers.end() || j != child->handlers.end()) {
+      if (j == child->handlers.end() || (i != handlers.end() && i->first <= j->first)) {
+        if (j != child->handlers.end() && i->first == j->first) {
+          ++j;
+        }
+        raw_handlers.emplace_back(i->first, i->second.get());
+        ++i;
+      } else {
+        raw_handlers.emplace_back(j->first, j->second.get());
+        ++j;
+      }
+    }
+    merged_table.build(raw_handlers, child->default_handler ?
+      child->default_handler.get() : default_handler.get());
+    merged_child = child;
+    merged_child_version = child->version;
+    merged_version = version;
+  }
+  return &merged_table;
+}
+
 bool MessageHandlers::try_process_body(MessageBody& body) {
-  auto iter = handlers.find(body.get_code());
-  if (iter != handlers.end()) {
-    iter->second->process_body(body);
+  auto t = get_dispatch_table();
+  if (auto h = (t ? t : &table)->find(body.get_code())) {
+    h->process_body(body);
     return true;
   }
-  if (this->child && this->child->try_process_body(body)) {
+  if (!t && this->child->try_process_body(body)) {
     return true;
   }
   return false;
 }
 
 bool MessageHandlers::try_process(Message& m) {
-  auto iter = handlers.find(m.get_body().get_code());
-  if (iter != handlers.end()) {
-    iter->second->process_body(m.get_body());
+  auto t = get_dispatch_table();
+  if (auto h = (t ? t : &table)->find(m.get_body().get_code())) {
+    h->process_body(m.get_body());
     return true;
   }
-  if (this->child && this->child->try_process(m)) {
+  if (!t && this->child->try_process(m)) {
     return true;
   }
-  if (default_handler) {
-    default_handler->process(m);
+  if (auto h = (t ? t : &table)->default_handler) {
+    h->process(m);
     return true;
   }
   return false;
@@ -61,7 +190,13 @@ void MessageHandlers::process(Message& m) {
   }
 }
 
-void MessageHandlers::add_handlers() {}
+void MessageHandlers::add_handlers() {
+  rebuild_table();
+}
+
+void MessageHandlers::update_handlers() {
+  rebuild_table();
+}
 
 void MessageHandlers::add_child_handlers(MessageHandlers& child) {
   this->child = &child;
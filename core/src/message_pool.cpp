@@ -0,0 +1,304 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "zaf/macros.hpp"
+#include "zaf/message_pool.hpp"
+
+namespace zaf {
+namespace {
+// the header before each pooled block, keeps the memory after it aligned
+constexpr size_t HeaderSize = alignof(std::max_align_t);
+// the sizes of blocks, including the header
+constexpr size_t ClassSizes[] = {64, 96, 128, 192, 256, 384, 512, 768, 1024};
+constexpr size_t NumClasses = sizeof(ClassSizes) / sizeof(ClassSizes[0]);
+// the max number of free blocks kept for each size class
+constexpr size_t MaxFreeBlocks = 4096;
+// the number of blocks freed by other threads before they are returned to the owner
+constexpr size_t ReturnBatchSize = 32;
+// the number of owners that a thread can batch blocks for at the same time
+constexpr size_t NumPendingReturns = 4;
+
+struct ThreadPool;
+
+struct BlockHeader {
+  ThreadPool* owner; // nullptr if the block is not owned by any pool
+  size_t size_class;
+};
+static_assert(sizeof(BlockHeader) <= HeaderSize);
+
+// a free block reuses the memory after the header
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+inline size_t size_class_of(size_t size) {
+  size += HeaderSize;
+  size_t c = 0;
+  while (c < NumClasses && ClassSizes[c] < size) {
+    ++c;
+  }
+  return c;
+}
+
+inline BlockHeader* header_of(void* ptr) {
+  return reinterpret_cast<BlockHeader*>(static_cast<char*>(ptr) - HeaderSize);
+}
+
+inline void* new_block(size_t c, ThreadPool* owner) {
+  auto header = static_cast<BlockHeader*>(::operator new(ClassSizes[c]));
+  header->owner = owner;
+  header->size_class = c;
+  return reinterpret_cast<char*>(header) + HeaderSize;
+}
+
+inline void delete_block(void* ptr) {
+  ::operator delete(header_of(ptr));
+}
+
+// only the owner thread updates the counters, other threads read them
+inline void inc(std::atomic<size_t>& counter) {
+  counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+struct ThreadPool {
+  struct PendingReturn {
+    ThreadPool* owner = nullptr;
+    FreeBlock* head = nullptr;
+    FreeBlock* tail = nullptr;
+    size_t size = 0;
+  };
+
+  FreeBlock* free_lists[NumClasses] = {};
+  size_t num_free_blocks[NumClasses] = {};
+  // blocks of this pool that are freed by other threads
+  std::atomic<FreeBlock*> returned{nullptr};
+  // blocks of other pools that are freed by this thread
+  PendingReturn pending_returns[NumPendingReturns];
+
+  std::atomic<size_t> num_allocations{0};
+  std::atomic<size_t> num_reuses{0};
+  std::atomic<size_t> num_large_allocations{0};
+  std::atomic<size_t> num_deallocations{0};
+  std::atomic<size_t> num_remote_deallocations{0};
+  std::atomic<size_t> num_returned_batches{0};
+
+  void* allocate(size_t c) {
+    inc(num_allocations);
+    if (!free_lists[c]) {
+      take_back_returned();
+    }
+    if (auto b = free_lists[c]) {
+      free_lists[c] = b->next;
+      --num_free_blocks[c];
+      inc(num_reuses);
+      return b;
+    }
+    return new_block(c, this);
+  }
+
+  void deallocate(void* ptr) {
+    inc(num_deallocations);
+    auto owner = header_of(ptr)->owner;
+    if (owner == this) {
+      free_locally(static_cast<FreeBlock*>(ptr));
+    } else if (owner == nullptr) {
+      delete_block(ptr);
+    } else {
+      inc(num_remote_deallocations);
+      return_later(owner, static_cast<FreeBlock*>(ptr));
+    }
+  }
+
+  void free_locally(FreeBlock* b) {
+    auto c = header_of(b)->size_class;
+    if (num_free_blocks[c] == MaxFreeBlocks) {
+      delete_block(b);
+      return;
+    }
+    b->next = free_lists[c];
+    free_lists[c] = b;
+    ++num_free_blocks[c];
+  }
+
+  void take_back_returned() {
+    auto b = returned.exchange(nullptr, std::memory_order_acquire);
+    while (b) {
+      auto next = b->next;
+      free_locally(b);
+      b = next;
+    }
+  }
+
+  void return_later(ThreadPool* owner, FreeBlock* b) {
+    auto& p = pending_returns[
+      (reinterpret_cast<std::uintptr_t>(owner) / sizeof(ThreadPool)) % NumPendingReturns];
+    if (p.owner != owner) {
+      flush(p);
+      p.owner = owner;
+    }
+    b->next = p.head;
+    p.head = b;
+    if (!p.tail) {
+      p.tail = b;
+    }
+    if (++p.size == ReturnBatchSize) {
+      flush(p);
+    }
+  }
+
+  void flush(PendingReturn& p) {
+    if (p.head) {
+      auto& r = p.owner->returned;
+      p.tail->next = r.load(std::memory_order_relaxed);
+      while (!r.compare_exchange_weak(p.tail->next, p.head,
+        std::memory_order_release, std::memory_order_relaxed));
+      inc(num_returned_batches);
+    }
+    p = PendingReturn{};
+  }
+
+  void flush_all() {
+    for (auto& p : pending_returns) {
+      flush(p);
+    }
+  }
+};
+
+// Pools are never deleted because blocks may be returned to them at any time.
+// The pool of an exited thread is adopted by a later thread.
+struct PoolRegistry {
+  std::mutex mutex;
+  std::vector<ThreadPool*> pools;
+  std::vector<ThreadPool*> orphans;
+
+  ThreadPool* acquire() {
+    std::lock_guard<std::mutex> _(mutex);
+    if (!orphans.empty()) {
+      auto pool = orphans.back();
+      orphans.pop_back();
+      return pool;
+    }
+    pools.push_back(new ThreadPool());
+    return pools.back();
+  }
+
+  void release(ThreadPool* pool) {
+    pool->flush_all();
+    std::lock_guard<std::mutex> _(mutex);
+    orphans.push_back(pool);
+  }
+};
+
+PoolRegistry& registry() {
+  // never destroyed as threads may exit after the static objects are destroyed
+  static auto r = new PoolRegistry();
+  return *r;
+}
+
+struct LocalPool {
+  ThreadPool* pool = nullptr;
+  bool destroyed = false;
+
+  // return nullptr if the thread is exiting
+  ThreadPool* get() {
+    if (!pool && !destroyed) {
+      pool = registry().acquire();
+    }
+    return pool;
+  }
+
+  ~LocalPool() {
+    destroyed = true;
+    if (pool) {
+      registry().release(pool);
+      pool = nullptr;
+    }
+  }
+};
+
+thread_local LocalPool local_pool;
+
+void add_stats(MessagePool::Stats& stats, const ThreadPool& pool) {
+  stats.num_allocations += pool.num_allocations.load(std::memory_order_relaxed);
+  stats.num_reuses += pool.num_reuses.load(std::memory_order_relaxed);
+  stats.num_large_allocations += pool.num_large_allocations.load(std::memory_order_relaxed);
+  stats.num_deallocations += pool.num_deallocations.load(std::memory_order_relaxed);
+  stats.num_remote_deallocations += pool.num_remote_deallocations.load(std::memory_order_relaxed);
+  stats.num_returned_batches += pool.num_returned_batches.load(std::memory_order_relaxed);
+}
+} // namespace
+
+void* MessagePool::allocate(size_t size) {
+#if ENABLE_MESSAGE_POOL
+  auto c = size_class_of(size);
+  if (c == NumClasses) {
+    if (auto pool = local_pool.get()) {
+      inc(pool->num_allocations);
+      inc(pool->num_large_allocations);
+    }
+    return ::operator new(size);
+  }
+  if (auto pool = local_pool.get()) {
+    return pool->allocate(c);
+  }
+  return new_block(c, nullptr);
+#else
+  return ::operator new(size);
+#endif
+}
+
+void MessagePool::deallocate(void* ptr, size_t size) {
+#if ENABLE_MESSAGE_POOL
+  if (!ptr) {
+    return;
+  }
+  if (size_class_of(size) == NumClasses) {
+    if (auto pool = local_pool.get()) {
+      inc(pool->num_deallocations);
+    }
+    ::operator delete(ptr);
+    return;
+  }
+  if (auto pool = local_pool.get()) {
+    pool->deallocate(ptr);
+    return;
+  }
+  // the thread is exiting, free the block directly
+  delete_block(ptr);
+#else
+  ::operator delete(ptr, size);
+#endif
+}
+
+void MessagePool::flush_returns() {
+#if ENABLE_MESSAGE_POOL
+  if (auto pool = local_pool.get()) {
+    pool->flush_all();
+  }
+#endif
+}
+
+MessagePool::Stats MessagePool::get_stats() {
+  Stats stats;
+  auto& r = registry();
+  std::lock_guard<std::mutex> _(r.mutex);
+  for (auto pool : r.pools) {
+    add_stats(stats, *pool);
+  }
+  return stats;
+}
+
+MessagePool::Stats MessagePool::get_thread_stats() {
+  Stats stats;
+#if ENABLE_MESSAGE_POOL
+  if (auto pool = local_pool.get()) {
+    add_stats(stats, *pool);
+  }
+#endif
+  return stats;
+}
+} // namespace zaf
@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+#include "zaf/json.hpp"
+#include "zaf/mailbox.hpp"
+#include "zaf/metrics.hpp"
+#include "zaf/zaf_exception.hpp"
+
+namespace zaf {
+double LatencyHistogram::Stats::mean_ns() const {
+  return count == 0 ? 0 : double(sum_ns) / count;
+}
+
+uint64_t LatencyHistogram::Stats::percentile_ns(double p) const {
+  if (count == 0) {
+    return 0;
+  }
+  // the rank of the percentile, starting from 1
+  auto rank = std::max(uint64_t(1), uint64_t(std::min(p, 100.0) / 100 * count + 0.5));
+  uint64_t n = 0;
+  for (size_t i = 0; i < NumBuckets; i++) {
+    n += buckets[i];
+    if (n >= rank) {
+      return i == 0 ? 0 : (i == NumBuckets - 1 ? ~uint64_t(0) : (uint64_t(1) << i) - 1);
+    }
+  }
+  return ~uint64_t(0);
+}
+
+LatencyHistogram::Stats LatencyHistogram::get_stats() const {
+  Stats stats;
+  for (size_t i = 0; i < NumBuckets; i++) {
+    stats.buckets[i] = buckets[i].get();
+    stats.count += stats.buckets[i];
+  }
+  stats.sum_ns = sum_ns.get();
+  return stats;
+}
+
+ActorMetrics::Stats ActorMetrics::get_stats() const {
+  Stats stats;
+  stats.actor_id = actor_id;
+  stats.name = name;
+  stats.messages_received = messages_received.get();
+  stats.messages_sent = messages_sent.get();
+  stats.bytes_sent = bytes_sent.get();
+  stats.swsr_send_stalls = swsr_send_stalls.get();
+  stats.swsr_reserved_bytes = swsr_reserved_bytes.get();
+  stats.mailbox_depth = mailbox ? mailbox->approx_size() : 0;
+  stats.handler_ns = handler_ns.get_stats();
+  return stats;
+}
+
+ExecutorMetrics::Stats ExecutorMetrics::get_stats() const {
+  Stats stats;
+  stats.name = name;
+  stats.eid = eid;
+  stats.busy_ns = busy_ns.get();
+  stats.idle_ns = idle_ns.get();
+  stats.wakeups = wakeups.get();
+  stats.runs = runs.get();
+  stats.num_actors = num_actors.get();
+  return stats;
+}
+
+NetLinkMetrics::Stats NetLinkMetrics::get_stats() const {
+  Stats stats;
+  stats.local_url = local_url;
+  stats.peer_url = peer_url;
+  stats.lane = lane;
+  stats.is_sender = is_sender;
+  stats.batches = batches.get();
+  stats.messages = messages.get();
+  stats.raw_bytes = raw_bytes.get();
+  stats.wire_bytes = wire_bytes.get();
+  for (unsigned i = 0; i < NumFlushReasons; i++) {
+    stats.flushes[i] = flushes[i].get();
+  }
+  return stats;
+}
+
+void MetricsSnapshot::write_json(std::ostream& out) const {
+  out << "{\"time_ms\":" << time_ms << ",\"actors\":[";
+  for (size_t i = 0; i < actors.size(); i++) {
+    auto& a = actors[i];
+    out << (i == 0 ? "" : ",") << "{\"id\":" << a.actor_id << ",\"name\":";
+    json::write_string(out, a.name);
+    out << ",\"messages_received\":" << a.messages_received
+      << ",\"messages_sent\":" << a.messages_sent
+      << ",\"bytes_sent\":" << a.bytes_sent
+      << ",\"swsr_send_stalls\":" << a.swsr_send_stalls
+      << ",\"swsr_reserved_bytes\":" << a.swsr_reserved_bytes
+      << ",\"mailbox_depth\":" << a.mailbox_depth
+      << ",\"handler_samples\":" << a.handler_ns.count
+      << ",\"handler_mean_ns\":" << uint64_t(a.handler_ns.mean_ns())
+      << ",\"handler_p50_ns\":" << a.handler_ns.percentile_ns(50)
+      << ",\"handler_p99_ns\":" << a.handler_ns.percentile_ns(99) << '}';
+  }
+  out << "],\"executors\":[";
+  for (size_t i = 0; i < executors.size(); i++) {
+    auto& e = executors[i];
+    out << (i == 0 ? "" : ",") << "{\"name\":";
+    json::write_string(out, e.name);
+    auto total_ns = e.busy_ns + e.idle_ns;
+    out << ",\"eid\":" << e.eid
+      << ",\"busy_ns\":" << e.busy_ns
+      << ",\"idle_ns\":" << e.idle_ns
+      << ",\"utilization\":" << (total_ns == 0 ? 0 : double(e.busy_ns) / total_ns)
+      << ",\"wakeups\":" << e.wakeups
+      << ",\"runs\":" << e.runs
+      << ",\"num_actors\":" << e.num_actors << '}';
+  }
+  out << "],\"net_links\":[";
+  for (size_t i = 0; i < net_links.size(); i++) {
+    auto& l = net_links[i];
+    out << (i == 0 ? "" : ",") << "{\"local\":";
+    json::write_string(out, l.local_url);
+    out << ",\"peer\":";
+    json::write_string(out, l.peer_url);
+    out << ",\"lane\":" << l.lane
+      << ",\"direction\":" << (l.is_sender ? "\"send\"" : "\"receive\"")
+      << ",\"batches\":" << l.batches
+      << ",\"messages\":" << l.messages
+      << ",\"raw_bytes\":" << l.raw_bytes
+      << ",\"wire_bytes\":" << l.wire_bytes;
+    if (l.is_sender) {
+      out << ",\"flushes\":{\"size\":" << l.flushes[NetLinkMetrics::Size]
+        << ",\"count\":" << l.flushes[NetLinkMetrics::Count]
+        << ",\"linger\":" << l.flushes[NetLinkMetrics::Linger]
+        << ",\"termination\":" << l.flushes[NetLinkMetrics::Termination] << '}';
+    }
+    out << '}';
+  }
+  out << "],\"message_pool\":{\"allocations\":" << message_pool.num_allocations
+    << ",\"reuses\":" << message_pool.num_reuses
+    << ",\"large_allocations\":" << message_pool.num_large_allocations
+    << ",\"deallocations\":" << message_pool.num_deallocations
+    << ",\"remote_deallocations\":" << message_pool.num_remote_deallocations
+    << ",\"returned_batches\":" << message_pool.num_returned_batches << "}}";
+}
+
+void MetricsRegistry::add(const ActorMetrics* metrics) {
+  std::lock_guard<std::mutex> _(mutex);
+  actors.insert(metrics);
+}
+
+void MetricsRegistry::remove(const ActorMetrics* metrics) {
+  std::lock_guard<std::mutex> _(mutex);
+  actors.erase(metrics);
+}
+
+void MetricsRegistry::add(const ExecutorMetrics* metrics) {
+  std::lock_guard<std::mutex> _(mutex);
+  executors.insert(metrics);
+}
+
+void MetricsRegistry::remove(const ExecutorMetrics* metrics) {
+  std::lock_guard<std::mutex> _(mutex);
+  executors.erase(metrics);
+}
+
+void MetricsRegistry::add(const NetLinkMetrics* metrics) {
+  std::lock_guard<std::mutex> _(mutex);
+  net_links.insert(metrics);
+}
+
+void MetricsRegistry::remove(const NetLinkMetrics* metrics) {
+  std::lock_guard<std::mutex> _(mutex);
+  net_links.erase(metrics);
+}
+
+MetricsSnapshot MetricsRegistry::snapshot() const {
+  MetricsSnapshot snapshot;
+  snapshot.time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+  {
+    std::lock_guard<std::mutex> _(mutex);
+    snapshot.actors.reserve(actors.size());
+    for (auto m : actors) {
+      snapshot.actors.emplace_back(m->get_stats());
+    }
+    snapshot.executors.reserve(executors.size());
+    for (auto m : executors) {
+      snapshot.executors.emplace_back(m->get_stats());
+    }
+    snapshot.net_links.reserve(net_links.size());
+    for (auto m : net_links) {
+      snapshot.net_links.emplace_back(m->get_stats());
+    }
+  }
+  std::sort(snapshot.actors.begin(), snapshot.actors.end(), [](auto& a, auto& b) {
+    return a.actor_id < b.actor_id;
+  });
+  std::sort(snapshot.executors.begin(), snapshot.executors.end(), [](auto& a, auto& b) {
+    return a.name < b.name;
+  });
+  std::sort(snapshot.net_links.begin(), snapshot.net_links.end(), [](auto& a, auto& b) {
+    return std::tie(a.peer_url, a.is_sender, a.lane) < std::tie(b.peer_url, b.is_sender, b.lane);
+  });
+  snapshot.message_pool = MessagePool::get_stats();
+  return snapshot;
+}
+
+void MetricsRegistry::start_dump(const std::string& path, std::chrono::milliseconds period) {
+  stop_dump();
+  std::ofstream out(path, std::ios::app);
+  if (!out) {
+    throw ZAFException("Failed to open file ", path, " to dump metrics.");
+  }
+  dump_stopped = false;
+  dump_thread = std::thread([this, out = std::move(out), period]() mutable {
+    std::unique_lock<std::mutex> lock(dump_mutex);
+    while (true) {
+      bool stopped = dump_cv.wait_for(lock, period, [&]() { return dump_stopped; });
+      this->snapshot().write_json(out);
+      out << std::endl;
+      if (stopped) {
+        break;
+      }
+    }
+  });
+}
+
+void MetricsRegistry::stop_dump() {
+  if (!dump_thread.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> _(dump_mutex);
+    dump_stopped = true;
+  }
+  dump_cv.notify_all();
+  dump_thread.join();
+}
+
+MetricsRegistry::~MetricsRegistry() {
+  stop_dump();
+}
+} // namespace zaf
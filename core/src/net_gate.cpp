@@ -1,11 +1,22 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
 #include "zaf/net_gate.hpp"
 #include "zaf/receive_guard.hpp"
 #include "zaf/thread_utils.hpp"
 
 namespace zaf {
-NetGate::Receiver::Receiver(const std::string bind_host, const NetSenderInfo& net_sender_info):
+NetGate::Receiver::Receiver(const std::string bind_host, const NetSenderInfo& net_sender_info,
+  unsigned lane, size_t max_batch_bytes):
   bind_host(bind_host),
-  net_sender_info(net_sender_info) {
+  net_sender_info(net_sender_info),
+  max_batch_bytes(max_batch_bytes) {
+  link_metrics.local_url = net_sender_info.local_net_gate_url;
+  link_metrics.peer_url = net_sender_info.remote_net_gate_url;
+  link_metrics.lane = lane;
+  link_metrics.is_sender = false;
 }
 
 MessageHandlers NetGate::Receiver::behavior() {
@@ -29,12 +40,22 @@ void NetGate::Receiver::receive_once_from_net() {
   receive_guard([&]() {
     if (!net_recv_socket.recv(message)) {
       throw ZAFException(
-        "Failed to receive message (number of messages) as expected at ",
+        "Failed to receive message (batch header) as expected at ",
         __PRETTY_FUNCTION__
       );
     }
   });
-  unsigned num_messages = *message.data<unsigned>();
+  if (message.size() != BatchHeader::NumSerializedBytes) {
+    throw ZAFException("Expect the batch header (", BatchHeader::NumSerializedBytes,
+      " bytes) but receive ", message.size(), " bytes at ", __PRETTY_FUNCTION__);
+  }
+  BatchHeader header;
+  Deserializer(message.data<char>(), message.size())
+    .read(header.num_messages, header.compression, header.num_raw_bytes);
+  if (header.num_raw_bytes > max_batch_bytes) {
+    throw ZAFException("Receive a batch of ", header.num_raw_bytes, " bytes, more than the max of ",
+      max_batch_bytes, " bytes at ", __PRETTY_FUNCTION__);
+  }
   receive_guard([&]() {
     if (!net_recv_socket.recv(message)) {
       throw ZAFException(
@@ -43,20 +64,41 @@ void NetGate::Receiver::receive_once_from_net() {
       );
     }
   });
-  Deserializer s(message.data<char>());
-  for (unsigned i = 0; i < num_messages; i++) {
+  if constexpr (ENABLE_METRICS) {
+    link_metrics.batches.add();
+    link_metrics.messages.add(header.num_messages);
+    link_metrics.raw_bytes.add(header.num_raw_bytes);
+    link_metrics.wire_bytes.add(BatchHeader::NumSerializedBytes + message.size());
+  }
+  if (tracer::is_enabled()) {
+    tracer::record(TraceEventType::NetReceive, this->get_actor_id(), 0,
+      header.num_messages, header.num_raw_bytes);
+  }
+  if (header.compression != Compression::None) {
+    zmq::message_t raw_bytes{header.num_raw_bytes};
+    compression::decompress(header.compression, message.data<char>(), message.size(),
+      raw_bytes.data<char>(), header.num_raw_bytes);
+    message = std::move(raw_bytes);
+  } else if (message.size() != header.num_raw_bytes) {
+    throw ZAFException("Expect ", header.num_raw_bytes, " bytes in the batch but receive ",
+      message.size(), " bytes at ", __PRETTY_FUNCTION__);
+  }
+  // the messages slice into the batch instead of copying their bytes
+  std::shared_ptr<const zmq::message_t> batch = std::make_shared<zmq::message_t>(std::move(message));
+  auto batch_begin = batch->data<char>();
+  Deserializer s(batch_begin, batch->size());
+  for (unsigned i = 0; i < header.num_messages; i++) {
     auto send_actor = deserialize<LocalActorHandle>(s);
     auto recv_actor = deserialize<LocalActorHandle>(s);
     auto message_code = deserialize<Code>(s);
     auto types_hash = deserialize<size_t>(s);
     auto num_bytes = deserialize<unsigned>(s);
-    auto bytes = std::vector<char>(num_bytes);
-    s.read_bytes(&bytes.front(), num_bytes);
-    auto msg = new TypedMessage<TypedSerializedMessageBody<std::vector<char>>>(
+    auto view = s.read_view(num_bytes);
+    auto msg = new TypedMessage<TypedSerializedMessageBody<BatchSlice>>(
       Actor{RemoteActorHandle{net_sender_info, send_actor}},
       message_code,
       types_hash,
-      std::move(bytes)
+      BatchSlice{batch, size_t(view - batch_begin), num_bytes}
     );
     this->send(recv_actor, msg);
   }
@@ -66,7 +108,7 @@ void NetGate::Receiver::launch() {
   thread::set_name(to_string("ZAF/NGR", this->get_actor_id()));
   std::vector<zmq::pollitem_t> poll_items{
     {net_recv_socket.handle(), 0, ZMQ_POLLIN, 0},
-    {this->get_recv_socket().handle(), 0, ZMQ_POLLIN, 0}
+    this->get_mailbox().get_poll_item()
   };
   auto msg_handlers = behavior();
   this->activate();
@@ -83,7 +125,7 @@ void NetGate::Receiver::launch() {
       this->receive_once_from_net();
     }
     if (poll_items[1].revents & ZMQ_POLLIN) {
-      this->receive_once(msg_handlers);
+      this->receive_once(msg_handlers, long(0));
     }
   }
 }
@@ -91,20 +133,39 @@ void NetGate::Receiver::launch() {
 void NetGate::Receiver::initialize_recv_socket() {
   this->ActorBehaviorX::initialize_recv_socket();
   net_recv_socket = zmq::socket_t(this->get_actor_system().get_zmq_context(), zmq::socket_type::pull);
+  // a compressed bytes frame is smaller than its raw bytes, zmq disconnects peers sending larger frames
+  net_recv_socket.set(zmq::sockopt::maxmsgsize, int64_t(max_batch_bytes));
   // Bind to any available port
   net_recv_socket.bind(to_string("tcp://", bind_host, ":*"));
+  if constexpr (ENABLE_METRICS) {
+    this->get_actor_system().get_metrics_registry().add(&link_metrics);
+  }
 }
 
 void NetGate::Receiver::terminate_recv_socket() {
+  if constexpr (ENABLE_METRICS) {
+    this->get_actor_system().get_metrics_registry().remove(&link_metrics);
+  }
   this->ActorBehaviorX::terminate_recv_socket();
   // same url as the one when binding
   net_recv_socket.unbind(to_string("tcp://", bind_host, ":*"));
   net_recv_socket.close();
 }
 
+NetGate::Sender::Sender(const Options& options, const std::string& local_url,
+  const std::string& peer_url, unsigned lane):
+  flush_policy(options.flush_policy),
+  min_compression_bytes(options.min_compression_bytes) {
+  link_metrics.local_url = local_url;
+  link_metrics.peer_url = peer_url;
+  link_metrics.lane = lane;
+  link_metrics.is_sender = true;
+}
+
 MessageHandlers NetGate::Sender::behavior() {
   return {
-    NetGate::DataConnReq - [&](const std::string& host, int port) {
+    NetGate::DataConnReq - [&](const std::string& host, int port, Compression compression) {
+      this->compression = compression;
       this->connected_url = to_string("tcp://", host, ':', port);
       try {
         net_send_socket.connect(connected_url);
@@ -126,12 +187,16 @@ MessageHandlers NetGate::Sender::behavior() {
         // The termination message may go faster than the message sent by the last alive actor.
         this->delayed_send(std::chrono::milliseconds{1}, *this, NetGate::Termination);
       } else {
+        this->flush_byte_buffer(NetLinkMetrics::Termination);
         this->get_actor_system().dec_num_detached_actors();
         this->deactivate();
       }
     },
     NetGate::FlushBuffer - [&]() {
-      this->flush_byte_buffer();
+      // may come after the batch it was sent for has been flushed
+      if (this->is_linger_expired()) {
+        this->flush_byte_buffer(NetLinkMetrics::Linger);
+      }
     },
     DefaultCodes::ForwardMessage - [&](MessageBytes& bytes) {
       forward_any_message = true;
@@ -144,41 +209,129 @@ MessageHandlers NetGate::Sender::behavior() {
   };
 }
 
-void NetGate::Sender::push_to_buffer(MessageBytes& bytes) {
-  // A simple bufferring. Bytes will be sent in `post_swsr_consumption`.
-  byte_buffer.insert(byte_buffer.end(), bytes.header.begin(), bytes.header.end());
-  byte_buffer.insert(byte_buffer.end(), bytes.content.begin(), bytes.content.end());
+void NetGate::Sender::push_to_buffer(MessageBytes& m) {
+  // Bytes are sent when the batch is full, or in `post_swsr_consumption` or
+  // upon `FlushBuffer` once the linger expires.
+  if (byte_buffer.empty() && byte_buffer.capacity() < m.bytes.size()) {
+    // take the bytes of a large message as the buffer instead of copying them
+    byte_buffer.swap(m.bytes);
+  } else {
+    byte_buffer.insert(byte_buffer.end(), m.bytes.begin(), m.bytes.end());
+  }
   if (num_buffered_messages++ == 0) {
-    this->ActorBehavior::send(*this, FlushBuffer);
+    if (flush_policy.max_linger.count() == 0) {
+      this->ActorBehavior::send(*this, FlushBuffer);
+    } else {
+      first_buffered_time = std::chrono::steady_clock::now();
+      this->delayed_send(flush_policy.max_linger, *this, FlushBuffer);
+    }
+  }
+  if (byte_buffer.size() >= flush_policy.max_bytes) {
+    this->flush_byte_buffer(NetLinkMetrics::Size);
+  } else if (num_buffered_messages >= flush_policy.max_messages) {
+    this->flush_byte_buffer(NetLinkMetrics::Count);
   }
 }
 
-void NetGate::Sender::flush_byte_buffer() {
-  if (num_buffered_messages != 0) {
-    zmq::const_buffer num{&num_buffered_messages, sizeof(num_buffered_messages)};
-    net_send_socket.send(num, zmq::send_flags::sndmore);
-    zmq::const_buffer bytes{&byte_buffer.front(), byte_buffer.size()};
-    net_send_socket.send(bytes, zmq::send_flags::none);
+void NetGate::Sender::flush_byte_buffer(NetLinkMetrics::FlushReason reason) {
+  if (num_buffered_messages == 0) {
+    return;
+  }
+  BatchHeader header{num_buffered_messages, Compression::None, byte_buffer.size()};
+  num_buffered_messages = 0;
+  auto num_compressed_bytes = send_compressed_buffer(header);
+  if constexpr (ENABLE_METRICS) {
+    link_metrics.batches.add();
+    link_metrics.messages.add(header.num_messages);
+    link_metrics.raw_bytes.add(header.num_raw_bytes);
+    link_metrics.wire_bytes.add(BatchHeader::NumSerializedBytes +
+      (num_compressed_bytes == 0 ? header.num_raw_bytes : num_compressed_bytes));
+    link_metrics.flushes[reason].add();
+  }
+  if (tracer::is_enabled()) {
+    tracer::record(TraceEventType::NetSend, this->get_actor_id(), 0,
+      header.num_messages, header.num_raw_bytes);
+  }
+  if (num_compressed_bytes != 0) {
+    // the buffer is kept for the next batch
     byte_buffer.clear();
-    num_buffered_messages = 0;
+    return;
+  }
+  send_batch_header(header);
+  // zmq takes the buffer without copying and frees it once the bytes are sent
+  auto capacity = byte_buffer.capacity();
+  auto buffer = new std::vector<char>(std::move(byte_buffer));
+  zmq::message_t bytes{buffer->data(), buffer->size(), [](void*, void* hint) {
+    delete static_cast<std::vector<char>*>(hint);
+  }, buffer};
+  net_send_socket.send(bytes, zmq::send_flags::none);
+  byte_buffer = std::vector<char>();
+  byte_buffer.reserve(std::min(capacity, flush_policy.max_bytes));
+}
+
+size_t NetGate::Sender::send_compressed_buffer(BatchHeader& header) {
+  if (compression == Compression::None || byte_buffer.size() < min_compression_bytes) {
+    return 0;
+  }
+  auto max_size = compression::max_compressed_size(compression, byte_buffer.size());
+  if (compression_buffer.size() < max_size) {
+    compression_buffer.resize(max_size);
   }
+  auto size = compression::compress(compression, byte_buffer.data(), byte_buffer.size(),
+    compression_buffer.data(), max_size);
+  if (size == 0 || size >= byte_buffer.size()) {
+    // not compressible
+    return 0;
+  }
+  header.compression = compression;
+  send_batch_header(header);
+  net_send_socket.send(zmq::const_buffer{compression_buffer.data(), size}, zmq::send_flags::none);
+  return size;
+}
+
+void NetGate::Sender::send_batch_header(const BatchHeader& header) {
+  header_bytes.clear();
+  Serializer(header_bytes).write(header.num_messages, header.compression, header.num_raw_bytes);
+  net_send_socket.send(zmq::const_buffer{header_bytes.data(), header_bytes.size()},
+    zmq::send_flags::sndmore);
+}
+
+bool NetGate::Receiver::is_blocking() const {
+  return true;
+}
+
+bool NetGate::Sender::is_linger_expired() const {
+  return flush_policy.max_linger.count() == 0 ||
+    std::chrono::steady_clock::now() - first_buffered_time >= flush_policy.max_linger;
 }
 
 void NetGate::Sender::post_swsr_consumption() {
-  this->flush_byte_buffer();
+  if (this->is_linger_expired()) {
+    this->flush_byte_buffer(NetLinkMetrics::Linger);
+  }
 }
 
 std::string NetGate::Sender::get_name() const {
   return to_string("ZAF/NGS", this->get_actor_id());
 }
 
+bool NetGate::Sender::is_blocking() const {
+  return true;
+}
+
 void NetGate::Sender::initialize_send_socket() {
   this->ActorBehaviorX::initialize_send_socket();
   net_send_socket = zmq::socket_t(this->get_actor_system().get_zmq_context(), zmq::socket_type::push);
   net_send_socket.set(zmq::sockopt::sndhwm, 0);
+  if constexpr (ENABLE_METRICS) {
+    this->get_actor_system().get_metrics_registry().add(&link_metrics);
+  }
 }
 
 void NetGate::Sender::terminate_send_socket() {
+  if constexpr (ENABLE_METRICS) {
+    this->get_actor_system().get_metrics_registry().remove(&link_metrics);
+  }
   if (!connected_url.empty()) {
     net_send_socket.disconnect(connected_url);
   }
@@ -186,10 +339,11 @@ void NetGate::Sender::terminate_send_socket() {
   this->ActorBehaviorX::terminate_send_socket();
 }
 
-NetGate::NetGateActor::NetGateActor(const std::string& host, int port):
+NetGate::NetGateActor::NetGateActor(const std::string& host, int port, const Options& options):
   bind_host(host),
   bind_port(port),
-  bind_url(to_string(bind_host, ':', bind_port)) {
+  bind_url(to_string(bind_host, ':', bind_port)),
+  options(options) {
 }
 
 MessageHandlers NetGate::NetGateActor::behavior() {
@@ -204,21 +358,32 @@ MessageHandlers NetGate::NetGateActor::behavior() {
       int bind_port = std::stoi(endpoint.substr(pos + 1, endpoint.size() - pos - 1));
       this->reply(NetGateBindPortRep, bind_port);
     },
-    NetGate::DataConnReq - [&](const std::string& connect_host, int connect_port) {
+    NetGate::DataConnReq - [&](const std::string& connect_host, const std::vector<int>& connect_ports,
+      const std::vector<Compression>& decompressible) {
       std::string net_gate_url{
         current_net_gate_routing_id.data<char>(),
         current_net_gate_routing_id.size() - 2
       };
-      auto& s = [&]() -> auto& {
+      auto& senders = [&]() -> auto& {
         try {
-          return net_gate_connections.at(net_gate_url).sender;
+          return net_gate_connections.at(net_gate_url).senders;
         } catch (...) {
           std::throw_with_nested(ZAFException(
             "Non-connected net gate requests a data connection: ", net_gate_url
           ));
         }
       }();
-      this->send(s, NetGate::DataConnReq, connect_host, connect_port);
+      if (connect_ports.empty()) {
+        throw ZAFException("Net gate ", net_gate_url, " requests a data connection without ports");
+      }
+      // compress batches only if the peer can decompress them
+      auto compression = std::find(decompressible.begin(), decompressible.end(), options.compression)
+        == decompressible.end() ? Compression::None : options.compression;
+      // the peer may use a different number of lanes, its Receivers are shared in turn
+      for (size_t i = 0; i < senders.size(); i++) {
+        this->send(senders[i], NetGate::DataConnReq, connect_host,
+          connect_ports[i % connect_ports.size()], compression);
+      }
     },
     NetGate::ActorRegistration - [&](const std::string& name, const Actor& actor) {
       actor.visit(overloaded {
@@ -295,8 +460,12 @@ MessageHandlers NetGate::NetGateActor::behavior() {
     },
     NetGate::Termination - [&]() {
       for (auto& i : net_gate_connections) {
-        this->send(i.second.sender, NetGate::Termination);
-        this->send(i.second.receiver, NetGate::Termination);
+        for (auto& s : i.second.senders) {
+          this->send(s, NetGate::Termination);
+        }
+        for (auto& r : i.second.receivers) {
+          this->send(r, NetGate::Termination);
+        }
       }
       this->get_actor_system().dec_num_detached_actors();
       this->deactivate();
@@ -330,7 +499,7 @@ void NetGate::NetGateActor::receive_once_from_net_gate(MessageHandlers& handlers
       throw ZAFException("Receive empty message from ", current_net_gate_routing_id);
     }
   });
-  Deserializer s(msg_bytes.data<char>());
+  Deserializer s(msg_bytes.data<char>(), msg_bytes.size());
   auto msg_code = deserialize<size_t>(s);
   // not reading msg_type here because it only receives Message::Type::Normal messages
   auto types_hash = deserialize<size_t>(s);
@@ -375,22 +544,42 @@ bool NetGate::NetGateActor::establish_connection(const std::string& url) {
   // 1. Connect to this new peer
   net_send_socket.connect("tcp://" + url);
   this->ping_net_gate(url);
-  // 2. Create send and recv sockets for this peer
+  // 2. Create send and recv sockets of each lane for this peer
   auto& actor_sys = this->get_actor_system();
-  conn.sender = actor_sys.spawn<Sender>();
-  actor_sys.inc_num_detached_actors();
-  conn.net_sender_info = NetSenderInfo {
-    static_cast<LocalActorHandle&>(conn.sender), bind_url, url
-  };
-  conn.receiver = actor_sys.spawn<Receiver>(bind_host, conn.net_sender_info);
-  actor_sys.inc_num_detached_actors();
-  // 3. Ask the receiver which port it binds
-  auto& r = iter_ins.first->second.receiver;
-  this->request(r, NetGate::BindPortReq).on_reply({
-    NetGate::BindPortRep - [&](int port) {
-      this->send_to_net_gate(url, NetGate::DataConnReq, this->bind_host, port);
+  for (unsigned i = 0; i < options.num_lanes; i++) {
+    conn.senders.push_back(actor_sys.spawn<Sender>(options, bind_url, url, i));
+    actor_sys.inc_num_detached_actors();
+    conn.net_sender_info.lanes.push_back(static_cast<LocalActorHandle&>(conn.senders.back()));
+  }
+  conn.net_sender_info.net_sender = conn.net_sender_info.lanes.front();
+  conn.net_sender_info.local_net_gate_url = bind_url;
+  conn.net_sender_info.remote_net_gate_url = url;
+  for (unsigned i = 0; i < options.num_lanes; i++) {
+    conn.receivers.push_back(actor_sys.spawn<Receiver>(bind_host, conn.net_sender_info, i,
+      options.max_batch_bytes));
+    actor_sys.inc_num_detached_actors();
+  }
+  // 3. Ask the receivers which ports they bind
+  std::vector<int> ports;
+  for (auto& r : conn.receivers) {
+    this->request(r, NetGate::BindPortReq).on_reply({
+      NetGate::BindPortRep - [&](int port) {
+        ports.push_back(port);
+      }
+    });
+  }
+  // 4. Tell the peer the ports and the codecs that the receivers can decompress
+  std::vector<Compression> decompressible;
+  for (auto c : {Compression::None, Compression::LZ4}) {
+    if (compression::is_supported(c)) {
+      decompressible.push_back(c);
     }
-  });
+  }
+  this->send_to_net_gate(url, NetGate::DataConnReq, this->bind_host, ports, decompressible);
+  return true;
+}
+
+bool NetGate::NetGateActor::is_blocking() const {
   return true;
 }
 
@@ -404,7 +593,7 @@ void NetGate::NetGateActor::launch() {
   }
   std::vector<zmq::pollitem_t> poll_items {
     {net_recv_socket.handle(), 0, ZMQ_POLLIN, 0},
-    {this->get_recv_socket().handle(), 0, ZMQ_POLLIN, 0}
+    this->get_mailbox().get_poll_item()
   };
   auto msg_handlers = behavior();
   this->activate();
@@ -427,7 +616,7 @@ void NetGate::NetGateActor::launch() {
       this->receive_once_from_net_gate(msg_handlers);
     }
     if (poll_items[1].revents & ZMQ_POLLIN) {
-      this->receive_once(msg_handlers);
+      this->receive_once(msg_handlers, long(0));
     }
   }
 }
@@ -494,14 +683,49 @@ NetGate::NetGate(ActorSystem& actor_sys, const std::string& bind_host, int port)
   initialize(actor_sys, bind_host, port);
 }
 
+NetGate::NetGate(ActorSystem& actor_sys, const std::string& bind_host, int port,
+  const Options& options) {
+  initialize(actor_sys, bind_host, port, options);
+}
+
+NetGate::NetGate(ActorSystem& actor_sys, const std::string& bind_host, int port,
+  const FlushPolicy& flush_policy, unsigned num_lanes) {
+  initialize(actor_sys, bind_host, port, flush_policy, num_lanes);
+}
+
 void NetGate::initialize(ActorSystem& actor_sys, const std::string& bind_host, int bind_port) {
+  initialize(actor_sys, bind_host, bind_port, Options{});
+}
+
+void NetGate::initialize(ActorSystem& actor_sys, const std::string& bind_host, int bind_port,
+  const FlushPolicy& flush_policy, unsigned num_lanes) {
+  Options options;
+  options.flush_policy = flush_policy;
+  options.num_lanes = num_lanes;
+  initialize(actor_sys, bind_host, bind_port, options);
+}
+
+void NetGate::initialize(ActorSystem& actor_sys, const std::string& bind_host, int bind_port,
+  const Options& options) {
   if (this->actor_sys) {
     throw ZAFException("Attempt to initialize an already initialized NetGate");
   }
+  if (options.num_lanes == 0) {
+    throw ZAFException("A NetGate requires at least one lane");
+  }
+  if (options.max_batch_bytes < options.flush_policy.max_bytes) {
+    throw ZAFException("The max batch bytes (", options.max_batch_bytes,
+      ") of a NetGate is less than the max bytes of its flush policy (",
+      options.flush_policy.max_bytes, ")");
+  }
+  if (!compression::is_supported(options.compression)) {
+    throw ZAFException("NetGate is configured with a compression codec that is not built: ",
+      int(options.compression));
+  }
   this->actor_sys = &actor_sys;
   // host and port are stored inside NetGateActor
   // because the NetGate object may be destroyed before NetGateActor
-  net_gate_actor = actor_sys.spawn<NetGateActor>(bind_host, bind_port);
+  net_gate_actor = actor_sys.spawn<NetGateActor>(bind_host, bind_port, options);
 }
 
 void NetGate::terminate() {
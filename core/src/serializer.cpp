@@ -27,6 +27,10 @@ Serializer& Serializer::write() {
   return *this;
 }
 
+void Serializer::reserve(size_t n) {
+  bytes.reserve(bytes.size() + n);
+}
+
 void Serializer::move_write_ptr_to(size_t ptr) {
   if (ptr > bytes.size()) {
     throw ZAFException("Invalid write pointer: ", ptr,
@@ -47,12 +51,19 @@ size_t Serializer::size() const {
   return bytes.size();
 }
 
-Deserializer::Deserializer(const char* off):
-  offset(off) {
+Deserializer::Deserializer(const char* begin, size_t size):
+  offset(begin),
+  end(begin + size) {
 }
 
 Deserializer::Deserializer(const std::vector<char>& bytes):
-  offset(&bytes.front()) {
+  offset(bytes.data()),
+  end(bytes.data() + bytes.size()) {
+}
+
+void Deserializer::throw_out_of_range(size_t n) const {
+  throw ZAFException("Attempt to read ", n, " bytes while only ", remaining(),
+    " bytes are left in Deserializer.");
 }
 
 Deserializer& Deserializer::read() {
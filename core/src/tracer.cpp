@@ -0,0 +1,278 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "zaf/json.hpp"
+#include "zaf/thread_utils.hpp"
+#include "zaf/tracer.hpp"
+#include "zaf/zaf_exception.hpp"
+
+namespace zaf {
+namespace tracer {
+namespace impl {
+std::atomic<bool> enabled{false};
+} // namespace impl
+
+namespace {
+inline uint64_t steady_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline uint64_t timestamp() {
+#if defined(__x86_64__) || defined(__i386__)
+  // assume an invariant TSC that is synchronized across cores
+  return __rdtsc();
+#else
+  return steady_ns();
+#endif
+}
+
+// the ring buffer of the events recorded by one thread
+struct ThreadBuffer {
+  std::unique_ptr<TraceEvent[]> events{new TraceEvent[EventsPerThread]};
+  // only updated by the owner thread
+  std::atomic<uint64_t> num_recorded{0};
+  // the events before it are dropped by `clear`
+  std::atomic<uint64_t> num_cleared{0};
+};
+
+// Buffers are never deleted because their events are exported after their threads exit.
+// The buffer of an exited thread is adopted by a later thread.
+struct BufferRegistry {
+  std::mutex mutex;
+  std::vector<ThreadBuffer*> buffers;
+  std::vector<ThreadBuffer*> orphans;
+  // tid -> the name of the thread when it records its first event
+  std::vector<std::string> thread_names;
+  // a pair of the timestamp and the steady clock (in ns) taken when the tracer is first enabled
+  uint64_t start_timestamp = 0;
+  uint64_t start_ns = 0;
+
+  ThreadBuffer* acquire(uint32_t& tid) {
+    std::string name;
+    try {
+      name = thread::get_name();
+    } catch (...) {
+      // keep the name empty
+    }
+    std::lock_guard<std::mutex> _(mutex);
+    tid = thread_names.size();
+    thread_names.emplace_back(std::move(name));
+    if (!orphans.empty()) {
+      auto buffer = orphans.back();
+      orphans.pop_back();
+      return buffer;
+    }
+    buffers.push_back(new ThreadBuffer());
+    return buffers.back();
+  }
+
+  void release(ThreadBuffer* buffer) {
+    std::lock_guard<std::mutex> _(mutex);
+    orphans.push_back(buffer);
+  }
+};
+
+BufferRegistry& registry() {
+  // never destroyed as threads may exit after the static objects are destroyed
+  static auto r = new BufferRegistry();
+  return *r;
+}
+
+struct LocalBuffer {
+  ThreadBuffer* buffer = nullptr;
+  uint32_t tid = 0;
+  bool destroyed = false;
+
+  // return nullptr if the thread is exiting
+  ThreadBuffer* get() {
+    if (!buffer && !destroyed) {
+      buffer = registry().acquire(tid);
+    }
+    return buffer;
+  }
+
+  ~LocalBuffer() {
+    destroyed = true;
+    if (buffer) {
+      registry().release(buffer);
+      buffer = nullptr;
+    }
+  }
+};
+
+thread_local LocalBuffer local_buffer;
+} // namespace
+
+void enable() {
+  if constexpr (ENABLE_TRACING) {
+    auto& r = registry();
+    {
+      std::lock_guard<std::mutex> _(r.mutex);
+      if (r.start_ns == 0) {
+        r.start_timestamp = timestamp();
+        r.start_ns = steady_ns();
+      }
+    }
+    impl::enabled.store(true, std::memory_order_relaxed);
+  } else {
+    throw ZAFException("Attempt to enable the tracer but ZAF is built without ENABLE_TRACING");
+  }
+}
+
+void disable() {
+  impl::enabled.store(false, std::memory_order_relaxed);
+}
+
+void record(TraceEventType type, ActorIdType actor, ActorIdType peer, size_t code, uint64_t id) {
+  auto buffer = local_buffer.get();
+  if (!buffer) {
+    return;
+  }
+  auto n = buffer->num_recorded.load(std::memory_order_relaxed);
+  buffer->events[n % EventsPerThread] = TraceEvent{
+    timestamp(), id, code, actor, peer, local_buffer.tid, type
+  };
+  buffer->num_recorded.store(n + 1, std::memory_order_release);
+}
+
+void clear() {
+  auto& r = registry();
+  std::lock_guard<std::mutex> _(r.mutex);
+  for (auto b : r.buffers) {
+    b->num_cleared.store(b->num_recorded.load(std::memory_order_acquire), std::memory_order_relaxed);
+  }
+}
+
+void write_chrome_trace(std::ostream& out) {
+  auto& r = registry();
+  std::vector<TraceEvent> events;
+  std::vector<std::string> thread_names;
+  uint64_t start_timestamp, start_ns;
+  {
+    std::lock_guard<std::mutex> _(r.mutex);
+    for (auto b : r.buffers) {
+      auto end = b->num_recorded.load(std::memory_order_acquire);
+      auto begin = std::max(b->num_cleared.load(std::memory_order_relaxed),
+        end > EventsPerThread ? end - EventsPerThread : 0);
+      auto offset = events.size();
+      for (auto i = begin; i < end; i++) {
+        events.push_back(b->events[i % EventsPerThread]);
+      }
+      // drop the events that may be overwritten while being copied, including the one
+      // that the next record overwrites
+      auto new_end = b->num_recorded.load(std::memory_order_acquire);
+      if (new_end >= begin + EventsPerThread) {
+        auto num_dropped = std::min(new_end - EventsPerThread + 1 - begin, end - begin);
+        events.erase(events.begin() + offset, events.begin() + offset + num_dropped);
+      }
+    }
+    thread_names = r.thread_names;
+    start_timestamp = r.start_timestamp;
+    start_ns = r.start_ns;
+  }
+  // the number of timestamp ticks per microsecond
+  double ticks_per_us = 1000;
+#if defined(__x86_64__) || defined(__i386__)
+  if (start_ns != 0) {
+    // measure for at least 10ms to get a stable ratio
+    auto min_end_ns = start_ns + 10000000;
+    while (steady_ns() < min_end_ns) {
+      std::this_thread::yield();
+    }
+    auto end_timestamp = timestamp();
+    auto end_ns = steady_ns();
+    ticks_per_us = double(end_timestamp - start_timestamp) / (end_ns - start_ns) * 1000;
+  }
+#endif
+  auto ts = [&](const TraceEvent& e) {
+    return double(int64_t(e.timestamp - start_timestamp)) / ticks_per_us;
+  };
+
+  auto flags = out.flags();
+  auto precision = out.precision();
+  // timestamps in microseconds with nanosecond precision
+  out << std::fixed << std::setprecision(3);
+  out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool first = true;
+  auto begin_event = [&](const char* ph, const TraceEvent& e) -> std::ostream& {
+    out << (first ? "" : ",") << "\n{\"ph\":\"" << ph << "\",\"pid\":1,\"tid\":" << e.tid
+      << ",\"ts\":" << ts(e) << ",\"cat\":\"zaf\"";
+    first = false;
+    return out;
+  };
+  for (uint32_t tid = 0; tid < thread_names.size(); tid++) {
+    out << (first ? "" : ",") << "\n{\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+      << ",\"name\":\"thread_name\",\"args\":{\"name\":";
+    json::write_string(out, thread_names[tid].empty() ? to_string("thread ", tid) : thread_names[tid]);
+    out << "}}";
+    first = false;
+  }
+  auto hex = [&](uint64_t x) -> std::ostream& {
+    return out << "\"0x" << std::hex << x << std::dec << '"';
+  };
+  for (auto& e : events) {
+    switch (e.type) {
+      case TraceEventType::Send: {
+        begin_event("i", e) << ",\"s\":\"t\",\"name\":\"send\",\"args\":{\"from\":"
+          << e.actor << ",\"to\":" << e.peer << ",\"code\":";
+        hex(e.code) << "}}";
+        begin_event("s", e) << ",\"name\":\"message\",\"id\":";
+        hex(e.id) << '}';
+        break;
+      }
+      case TraceEventType::Receive: {
+        begin_event("i", e) << ",\"s\":\"t\",\"name\":\"receive\",\"args\":{\"actor\":"
+          << e.actor << ",\"from\":" << e.peer << ",\"code\":";
+        hex(e.code) << "}}";
+        break;
+      }
+      case TraceEventType::HandleBegin: {
+        begin_event("B", e) << ",\"name\":";
+        hex(e.code) << ",\"args\":{\"actor\":" << e.actor
+          << ",\"from\":" << e.peer << "}}";
+        // the flow from the send ends at the handling of the message
+        begin_event("f", e) << ",\"bp\":\"e\",\"name\":\"message\",\"id\":";
+        hex(e.id) << '}';
+        break;
+      }
+      case TraceEventType::HandleEnd: {
+        begin_event("E", e) << '}';
+        break;
+      }
+      case TraceEventType::NetSend:
+      case TraceEventType::NetReceive: {
+        begin_event("i", e) << ",\"s\":\"t\",\"name\":\""
+          << (e.type == TraceEventType::NetSend ? "net send" : "net receive")
+          << "\",\"args\":{\"actor\":" << e.actor << ",\"messages\":" << e.code
+          << ",\"bytes\":" << e.id << "}}";
+        break;
+      }
+    }
+  }
+  out << "\n]}\n";
+  out.flags(flags);
+  out.precision(precision);
+}
+
+void write_chrome_trace(const std::string& path) {
+  std::ofstream out(path);
+  if (!out) {
+    throw ZAFException("Failed to open file ", path, " to write the trace.");
+  }
+  write_chrome_trace(out);
+}
+} // namespace tracer
+} // namespace zaf
@@ -5,6 +5,7 @@
 #include <functional>
 #include <string>
 #include <variant>
+#include <vector>
 
 #include "macros.hpp"
 
@@ -28,12 +29,18 @@ struct LocalActorHandle {
 };
 
 struct NetSenderInfo {
-  // the net sender
+  // the net sender, i.e., the one of the first lane
   LocalActorHandle net_sender;
   // the url of the local net gate that creates the net sender
   std::string local_net_gate_url;
   // the url of the remote net gate that creates the net receiver who receives the messages of this net sender
   std::string remote_net_gate_url;
+  // the net senders of all the lanes to the remote net gate, empty if there is only `net_sender`
+  std::vector<LocalActorHandle> lanes;
+
+  // the net sender that carries the messages to `remote_actor`.
+  // Messages to the same remote actor always go through the same lane and thus keep their order.
+  const LocalActorHandle& net_sender_of(const LocalActorHandle& remote_actor) const;
 
   friend std::ostream& operator<<(std::ostream&, const NetSenderInfo&);
 };
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 
@@ -9,9 +13,13 @@
 #include "count_pointer.hpp"
 #include "delayed_message.hpp"
 #include "macros.hpp"
+#include "mailbox.hpp"
 #include "make_message.hpp"
 #include "message_handlers.hpp"
+#include "metrics.hpp"
 #include "receive_guard.hpp"
+#include "timer_wheel.hpp"
+#include "tracer.hpp"
 #include "zaf_exception.hpp"
 
 #include "zmq.hpp"
@@ -75,6 +83,13 @@ public:
   void receive(MessageHandlers&& handlers);
   void receive(MessageHandlers& handlers);
 
+  // to process at most `max_n` incoming messages with message handlers
+  // the first message is received as `receive_once` with `timeout`, and then the messages
+  // that are ready in the mailbox are processed without polling
+  // return the number of processed messages
+  size_t receive_batch(MessageHandlers&& handlers, size_t max_n, long timeout = -1);
+  size_t receive_batch(MessageHandlers& handlers, size_t max_n, long timeout = -1);
+
   template<typename Callback,
     std::enable_if_t<std::is_invocable_v<Callback, Message*>>* = nullptr>
   inline void receive(Callback&& callback) {
@@ -91,6 +106,10 @@ public:
     std::enable_if_t<std::is_invocable_v<Callback, Message*>>* = nullptr>
   bool receive_once(Callback&& callback, long timeout = -1);
 
+  template<typename Callback,
+    std::enable_if_t<std::is_invocable_v<Callback, Message*>>* = nullptr>
+  size_t receive_batch(Callback&& callback, size_t max_n, long timeout = -1);
+
   // the API is similar with receive_once
   // the difference is that inner_receive_once does not handle delayed messages
   // in case there are multiple recv_polls, receive once from each of the recv_polls that have messages
@@ -98,17 +117,21 @@ public:
     std::enable_if_t<std::is_invocable_v<Callback, Message*>>* = nullptr>
   bool inner_receive_once(Callback&& callback, long timeout = -1);
 
+  // return the handle to cancel the message before it is sent
   template<typename Rep, typename Period, typename ... ArgT>
-  void delayed_send(const std::chrono::duration<Rep, Period>& delay, ActorBehavior& receiver,
+  TimerHandle delayed_send(const std::chrono::duration<Rep, Period>& delay, ActorBehavior& receiver,
     Code code, ArgT&& ... args) {
-    this->delayed_send(delay, Actor{receiver.get_local_actor_handle()},
+    return this->delayed_send(delay, Actor{receiver.get_local_actor_handle()},
       code, std::forward<ArgT>(args) ...);
   }
 
   template<typename Rep, typename Period, typename ... ArgT>
-  void delayed_send(const std::chrono::duration<Rep, Period>& delay, const Actor& receiver,
+  TimerHandle delayed_send(const std::chrono::duration<Rep, Period>& delay, const Actor& receiver,
     Code code, ArgT&& ... args);
 
+  // drop a message given to `delayed_send`, return false if it has been sent
+  bool cancel_delayed_send(const TimerHandle& handle);
+
   ActorSystem& get_actor_system();
   ActorGroup& get_actor_group();
   Actor get_self_actor();
@@ -124,22 +147,44 @@ public:
 
   virtual std::string get_name() const;
 
+  // Whether the actor may block its thread, e.g., it overrides `launch`, polls extra zmq sockets
+  // or waits on something other than its mailbox. ActorSystem runs a blocking actor on a
+  // dedicated thread and other actors on its shared scheduler. Default: false.
+  virtual bool is_blocking() const;
+
+  // Set by the executors of ActorEngine that run the actor by its behavior. Such an actor must not
+  // block the executor, and leaves the messages that do not arrive by its mailbox, e.g., those in
+  // the SWSR queues of ActorBehaviorX, to `receive_side_messages`.
+  void set_executor_driven();
+  bool is_executor_driven() const;
+
+  // Whether the actor has messages other than those in its mailbox to process, in which case
+  // an executor runs the actor again without its mailbox being signaled. Default: false.
+  virtual bool has_side_messages() const;
+  // process at most `max_n` messages other than those in the mailbox, return the number processed
+  virtual size_t receive_side_messages(MessageHandlers& handlers, size_t max_n);
+
   /**
    * To be used by ZAF
    **/
   virtual void initialize_actor(ActorSystem& sys, ActorGroup& group);
   virtual void terminate_actor();
 
-  void initialize_routing_id_buffer();
+  void initialize_mailbox();
+  void terminate_mailbox();
 
-  virtual void initialize_recv_socket();
-  virtual void terminate_recv_socket();
+  // for subclasses that own extra zmq sockets, e.g., NetGate
+  virtual void initialize_recv_socket() {}
+  virtual void terminate_recv_socket() {}
 
-  virtual void initialize_send_socket();
+  virtual void initialize_send_socket() {}
   virtual void terminate_send_socket();
 
-  zmq::socket_t& get_recv_socket();
-  zmq::socket_t& get_send_socket();
+  Mailbox& get_mailbox();
+
+  // If set, receiving waits for the mailbox with the waiter instead of polling the mailbox,
+  // unless the actor polls extra zmq sockets. The waiter is not owned by the actor.
+  void set_mailbox_waiter(MailboxWaiter* waiter);
 
   // allow operator to register zmq::socket such that these sockets are polled together
   // call the function if the socket has incoming msgs
@@ -150,6 +195,9 @@ public:
 
   virtual void launch();
 
+  // the time point at which the earliest delayed message is due, or nullopt if there is none
+  std::optional<TimePoint> get_next_delayed_message_time() const;
+
   virtual ~ActorBehavior();
 
   ActorIdType get_actor_id() const;
@@ -157,39 +205,47 @@ public:
   virtual LocalActorHandle get_local_actor_handle() const;
 
 protected:
-  void connect(ActorIdType peer);
-  void disconnect(ActorIdType peer);
+  void process_message(MessageHandlers& handlers, Message* m);
+
+  // take a message that is ready without polling, return nullptr if there is none
+  Message* try_take_ready_message();
 
   std::optional<std::chrono::milliseconds> remaining_time_to_next_delayed_message() const;
   void flush_delayed_messages();
 
   void process_recv_poll_reqs();
 
-  // time to send -> delayed message
-  DefaultSortedMultiMap<TimePoint, DelayedMessage> delayed_messages;
-
-  std::string routing_id_buffer;
-  const std::string& get_routing_id(ActorIdType id, bool send_or_recv);
+  // the delayed messages by the time to send them, including the deadlines of the requests
+  TimerWheel<DelayedMessage> delayed_messages;
 
-  DefaultHashSet<ActorIdType> connected_receivers;
+  // receiver actor id -> the mailbox of the receiver
+  DefaultHashMap<ActorIdType, std::shared_ptr<Mailbox>> connected_receivers;
   bool activated = false;
   Message* current_message = nullptr;
 
   ActorIdType actor_id{~0u};
-  zmq::socket_t send_socket, recv_socket;
+  std::shared_ptr<Mailbox> mailbox;
+  MailboxWaiter* mailbox_waiter = nullptr;
+  bool executor_driven = false;
   ActorGroup* actor_group_ptr = nullptr;
   ActorSystem* actor_system_ptr = nullptr;
 
+  // recv_poll_items[0] is the poll item of the mailbox
   std::vector<zmq::pollitem_t> recv_poll_items;
   std::vector<std::function<void()>> recv_poll_callbacks;
   std::vector<std::tuple<bool, zmq::socket_t*, std::function<void()>>> recv_poll_reqs;
 
   MessageHandlers inner_handlers{}; // default: empty handlers
 
+  // nullptr if ZAF is built without ENABLE_METRICS
+  std::unique_ptr<ActorMetrics> metrics;
+
 public:
   class RequestHandler {
   private:
     ActorBehavior* self = nullptr;
+    // the actor that sends the request, kept after `then` so that the request can be cancelled
+    ActorBehavior* owner = nullptr;
     unsigned request_id;
 
   public:
@@ -201,8 +257,32 @@ public:
     RequestHandler& operator=(const RequestHandler&) = delete;
     RequestHandler& operator=(RequestHandler&&);
 
+    // wait for the response and process it with `handlers` in a nested receive,
+    // other messages received in the meantime are processed after the response
     void on_reply(MessageHandlers&& handlers);
     void on_reply(MessageHandlers& handlers);
+    // Same as above, but stop waiting if the response does not arrive within `timeout`.
+    // Return false on timeout, and the late response is dropped.
+    bool on_reply(MessageHandlers&& handlers, std::chrono::milliseconds timeout);
+    bool on_reply(MessageHandlers& handlers, std::chrono::milliseconds timeout);
+
+    // Process the response with `handlers` when it arrives without waiting for it,
+    // i.e., the actor keeps processing other messages in the meantime.
+    // If the response has arrived already, it is processed before `then` returns.
+    void then(MessageHandlers&& handlers);
+    // Same as above, but invoke `on_timeout` instead if the response does not arrive
+    // within `timeout`, and the late response is dropped.
+    void then(MessageHandlers&& handlers, std::chrono::milliseconds timeout,
+      std::function<void()> on_timeout);
+
+    // Give up the request, the response is dropped if it arrives later.
+    // Can be called after `then`. Return false if the request has finished or timed out.
+    bool cancel();
+
+    unsigned get_request_id() const;
+
+  private:
+    bool wait_for_reply(MessageHandlers& handlers);
   };
 
   template<typename Receiver, typename ... ArgT>
@@ -217,10 +297,30 @@ public:
 
   void store_response(unsigned req_id, std::unique_ptr<MessageBody>& response);
 
+  // same as RequestHandler::cancel, for requests whose handlers are gone, e.g., after `then`
+  bool cancel_request(unsigned req_id);
+
 protected:
   unsigned waiting_for_response = 0;
   unsigned request_id = 0;
-  DefaultHashMap<unsigned, std::unique_ptr<MessageBody>> unfinished_requests;
+  struct UnfinishedRequest {
+    // the response that arrives before it is processed by `on_reply`
+    std::unique_ptr<MessageBody> response;
+    // the handlers of the response registered by `then`
+    std::unique_ptr<MessageHandlers> continuation;
+    std::function<void()> on_timeout;
+    // the deadline of the request in `delayed_messages`
+    TimerHandle deadline;
+    // whether `on_reply` is waiting for the response in a nested receive
+    bool waited = false;
+    bool timed_out = false;
+  };
+  DefaultHashMap<unsigned, UnfinishedRequest> unfinished_requests;
+
+  void set_request_deadline(unsigned req_id, std::chrono::milliseconds timeout);
+  // called when the deadline of the request is due
+  void expire_request(unsigned req_id);
+  void erase_unfinished_request(DefaultHashMap<unsigned, UnfinishedRequest>::iterator iter);
   std::deque<Message*> pending_messages;
 };
 } // namespace zaf
@@ -26,7 +26,10 @@ void ActorBehavior::send(const Actor& receiver, Code code, ArgT&& ... args) {
       if constexpr (traits::all_serializable<ArgT ...>::value) {
         auto bytes = MessageBytes::make(this->get_local_actor_handle(),
           r.remote_actor, code, std::forward<ArgT>(args) ...);
-        this->send(r.net_sender_info->net_sender,
+        if constexpr (ENABLE_METRICS) {
+          metrics->bytes_sent.add(bytes.bytes.size());
+        }
+        this->send(r.net_sender_info->net_sender_of(r.remote_actor),
           DefaultCodes::ForwardMessage, std::move(bytes));
       } else {
         throw ZAFException("Attempt to serialize non-serializable message data: ",
@@ -43,6 +46,10 @@ template<typename Callback,
   std::enable_if_t<std::is_invocable_v<Callback, Message*>>*>
 bool ActorBehavior::receive_once(Callback&& callback, long timeout) {
   timeout = std::max(timeout, long(-1));
+  // a delayed request deadline or its timeout callback may deactivate the actor
+  auto deactivated = [activated = this->is_activated(), this]() {
+    return activated && !this->is_activated();
+  };
   switch (timeout) {
     case -1: { // block until receiving a message
       while (true) {
@@ -51,7 +58,8 @@ bool ActorBehavior::receive_once(Callback&& callback, long timeout) {
           auto t = std::max(static_cast<long>(delayed_timeout->count()), long(0));
           auto ret = inner_receive_once(std::forward<Callback>(callback), t);
           this->flush_delayed_messages();
-          if (ret) { // return until a message is received
+          // return until a message is received or the actor is deactivated
+          if (ret || deactivated()) {
             return ret;
           }
         } else {
@@ -77,10 +85,12 @@ bool ActorBehavior::receive_once(Callback&& callback, long timeout) {
             timeout);
           auto ret = inner_receive_once(std::forward<Callback>(callback), t);
           this->flush_delayed_messages();
-          if (ret) { // return because one message is received
+          // return because one message is received or the actor is deactivated
+          if (ret || deactivated()) {
             return ret;
           }
-          timeout = (e - std::chrono::steady_clock::now()).count();
+          timeout = std::chrono::duration_cast<std::chrono::milliseconds>(
+            e - std::chrono::steady_clock::now()).count();
           if (timeout <= 0) { // return because receive timeout is reached
             return ret;
           }
@@ -93,51 +103,99 @@ bool ActorBehavior::receive_once(Callback&& callback, long timeout) {
   }
 }
 
+template<typename Callback,
+  std::enable_if_t<std::is_invocable_v<Callback, Message*>>*>
+size_t ActorBehavior::receive_batch(Callback&& callback, size_t max_n, long timeout) {
+  if (max_n == 0 || !this->receive_once(callback, timeout)) {
+    return 0;
+  }
+  size_t n = 1;
+  // the handlers may deactivate the actor or wait for a response
+  while (n < max_n && this->is_activated()) {
+    auto m = this->try_take_ready_message();
+    if (!m) {
+      break;
+    }
+    tracer::record_receive(this->actor_id, m);
+    try {
+      callback(m);
+    } catch (...) {
+      std::throw_with_nested(ZAFException(
+        "Exception caught in ", __PRETTY_FUNCTION__, " in actor ", this->actor_id
+      ));
+    }
+    ++n;
+  }
+  if (n > 1) {
+    this->flush_delayed_messages();
+  }
+  return n;
+}
+
 template<typename Callback,
   std::enable_if_t<std::is_invocable_v<Callback, Message*>>*>
 bool ActorBehavior::inner_receive_once(Callback&& callback, long timeout) {
   if (!waiting_for_response && !pending_messages.empty()) {
+    tracer::record_receive(this->actor_id, pending_messages.front());
     callback(pending_messages.front());
     pending_messages.pop_front();
     return true;
   }
   process_recv_poll_reqs();
   try {
-    // if failed to receive or receive nothing, return
-    if (int npoll = 0; !try_receive_guard([&]() {
+    // fast path: take a message from the mailbox without polling
+    // if there is no extra socket to be polled together
+    if (recv_poll_items.size() == 1) {
+      if (auto m = mailbox->try_pop()) {
+        tracer::record_receive(this->actor_id, m);
+        callback(m);
+        return true;
+      }
+    }
+    auto e = std::chrono::steady_clock::now() + std::chrono::milliseconds{std::max(timeout, long(0))};
+    while (true) {
+      // do not wait in poll if the mailbox gets new messages in the meantime
+      auto poll_timeout = mailbox->prepare_wait() ? timeout : 0;
+      // if failed to receive or receive nothing, return
+      if (int npoll = 0; !try_receive_guard([&]() {
+        if (mailbox_waiter && recv_poll_items.size() == 1) {
+          if (poll_timeout != 0) {
+            mailbox_waiter->wait(poll_timeout);
+          }
+          return;
+        }
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
-      npoll = zmq::poll(&recv_poll_items.front(), recv_poll_items.size(), timeout);
+        npoll = zmq::poll(&recv_poll_items.front(), recv_poll_items.size(), poll_timeout);
 #pragma GCC diagnostic pop
-    }) || npoll == 0) {
-      return false;
-    }
-    if (recv_poll_items[0].revents & ZMQ_POLLIN) {
-      zmq::message_t sender_routing_id;
-      receive_guard([&]() {
-        // receive current sender routing id
-        if (!recv_socket.recv(sender_routing_id)) {
-          throw ZAFException(
-            "Expect to receive a message but actually received nothing.");
+      })) {
+        return false;
+      }
+      bool received = false;
+      // the mailbox may be signaled before a writer completes its push,
+      // in such case nothing is received and we poll again
+      if (auto m = mailbox->try_pop()) {
+        tracer::record_receive(this->actor_id, m);
+        callback(m);
+        received = true;
+      }
+      for (int i = 1, n = recv_poll_items.size(); i < n; i++) {
+        if (recv_poll_items[i].revents & ZMQ_POLLIN) {
+          recv_poll_callbacks[i]();
+          received = true;
         }
-      });
-      zmq::message_t message_ptr;
-      receive_guard([&]() {
-        if (!recv_socket.recv(message_ptr)) {
-          throw ZAFException(
-            "Failed to receive a message after having received an routing id at ",
-            __PRETTY_FUNCTION__
-          );
+      }
+      if (received || timeout == 0) {
+        return received;
+      }
+      if (timeout > 0) {
+        timeout = std::chrono::duration_cast<std::chrono::milliseconds>(
+          e - std::chrono::steady_clock::now()).count();
+        if (timeout <= 0) {
+          return false;
         }
-        callback(*reinterpret_cast<Message**>(message_ptr.data()));
-      });
-    }
-    for (int i = 1, n = recv_poll_items.size(); i < n; i++) {
-      if (recv_poll_items[i].revents & ZMQ_POLLIN) {
-        recv_poll_callbacks[i]();
       }
     }
-    return true;
   } catch (...) {
     std::throw_with_nested(ZAFException(
       "Exception caught in ", __PRETTY_FUNCTION__, " in actor ", this->actor_id
@@ -146,31 +204,34 @@ bool ActorBehavior::inner_receive_once(Callback&& callback, long timeout) {
 }
 
 template<typename Rep, typename Period, typename ... ArgT>
-void ActorBehavior::delayed_send(const std::chrono::duration<Rep, Period>& delay,
+TimerHandle ActorBehavior::delayed_send(const std::chrono::duration<Rep, Period>& delay,
   const Actor& receiver, Code code, ArgT&& ... args) {
   if (!receiver) {
-    return;
+    return {};
   }
   auto now = std::chrono::steady_clock::now();
   auto send_time = now + delay;
+  TimerHandle handle;
   receiver.visit(overloaded{
     [&](const LocalActorHandle&) {
       auto m = new_message(Actor{this->get_local_actor_handle()},
         code, std::forward<ArgT>(args)...);
-      delayed_messages.emplace(send_time, DelayedMessage(receiver, m));
+      handle = delayed_messages.add(send_time, DelayedMessage(receiver, m));
     },
     [&](const RemoteActorHandle& r) {
       if constexpr (traits::all_serializable<ArgT ...>::value) {
-        delayed_messages.emplace(send_time, DelayedMessage(
-          receiver,
-          MessageBytes::make(this->get_local_actor_handle(),
-            r.remote_actor, code, std::forward<ArgT>(args) ...)
-        ));
+        auto bytes = MessageBytes::make(this->get_local_actor_handle(),
+          r.remote_actor, code, std::forward<ArgT>(args) ...);
+        if constexpr (ENABLE_METRICS) {
+          metrics->bytes_sent.add(bytes.bytes.size());
+        }
+        handle = delayed_messages.add(send_time, DelayedMessage(receiver, std::move(bytes)));
       } else {
         throw ZAFException("Attempt to serialize non-serializable data: ",
           traits::NonSerializableAnalyzer<ArgT ...>::to_string());
       }
     }
   });
+  return handle;
 }
 } // namespace zaf
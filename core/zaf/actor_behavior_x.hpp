@@ -1,5 +1,7 @@
 #pragma once
 
+#include <deque>
+#include <limits>
 #include <utility>
 #include <vector>
 
@@ -8,7 +10,19 @@
 #include "swsr_delivery_queue.hpp"
 
 namespace zaf {
-// TODO(zzxx): support running ActorBehaviorX using ActorEngine
+/**
+ * An actor that sends messages to other ActorBehaviorX actors by SWSR queues instead of mailboxes.
+ * 1. A sender puts its queue into the SWSRReadyList of the receiver when the queue becomes
+ *    non-empty, so the receiver only visits the queues that have messages. The receiver is woken
+ *    up by a SWSRMsgQueueConsumption message only if it has nothing to consume.
+ * 2. On a dedicated thread, the actor keeps consuming by sending SWSRMsgQueueConsumption to itself
+ *    until there is nothing to consume, and a sender blocks when the queue is full.
+ * 3. On the executors of ActorEngine, the executors consume the SWSR queues by
+ *    `receive_side_messages`. A sender never blocks the executor, and keeps the messages that do
+ *    not fit in a full queue, at most `max_pending_messages` of them. The executor does not run the
+ *    sender for the kept messages until the receiver makes room and wakes up the sender by a
+ *    SWSRMsgQueueRoom message.
+ **/
 class ActorBehaviorX : public ActorBehavior {
 public:
   ActorBehaviorX();
@@ -55,7 +69,10 @@ public:
         if constexpr (traits::all_serializable<ArgT ...>::value) {
           auto bytes = MessageBytes::make(this->get_local_actor_handle(),
             r.remote_actor, code, std::forward<ArgT>(args) ...);
-          this->send(r.net_sender_info->net_sender,
+          if constexpr (ENABLE_METRICS) {
+            this->metrics->bytes_sent.add(bytes.bytes.size());
+          }
+          this->send(r.net_sender_info->net_sender_of(r.remote_actor),
             DefaultCodes::ForwardMessage, std::move(bytes));
         } else {
           throw ZAFException("Attempt to serialize non-serializable message data: ",
@@ -81,10 +98,26 @@ public:
 
   void notify_swsr_queue();
 
-  void consume_swsr_recv_queues(MessageHandlers& handlers);
+  // called when the receiver that sends the current message makes room for the kept messages
+  void on_swsr_queue_room();
+
+  // the max number of messages kept for full queues when driven by an executor, beyond which
+  // `send` throws
+  void set_max_pending_messages(size_t max_pending);
+
+  // process at most `max_n` messages in the SWSR queues, return the number processed
+  size_t consume_swsr_recv_queues(MessageHandlers& handlers,
+    size_t max_n = std::numeric_limits<size_t>::max());
+
+  bool has_side_messages() const override;
+
+  size_t receive_side_messages(MessageHandlers& handlers, size_t max_n) override;
 
   virtual void post_swsr_consumption();
 
+  // the bytes reserved by the SWSR queues that this actor receives from, including the self queue
+  size_t get_swsr_reserved_bytes() const;
+
   void setup_swsr_connection(const Actor&);
 
   void setup_swsr_connection(const LocalActorHandle&);
@@ -92,6 +125,18 @@ public:
   ~ActorBehaviorX();
 
 private:
+  // push the messages kept for full queues, in order
+  void flush_pending_sends();
+
+  // put the queue into the ready list of the receiver when the queue becomes non-empty
+  void notify_swsr_receiver(const LocalActorHandle& receiver, SWSRDeliveryQueue<Message*>& send_queue);
+
+  // consume the queues when not driven by an executor
+  void continue_swsr_consumption();
+
+  // update the metric of the SWSR queue memory, called when the actor has nothing to consume
+  void update_swsr_metrics();
+
   // Note(zzxx): Receiver may terminates before sender, we should use std::shared_ptr
   //   so that sender will destroy the queue if it is the case.
   // SWSRDeliveryQueue is created by sender, then delivered to and destroyed by the receiver
@@ -99,9 +144,25 @@ private:
   DefaultHashMap<ActorIdType, std::shared_ptr<SWSRDeliveryQueue<Message*>>> swsr_send_queues;
   // Sender actor id -> message queue
   DefaultHashMap<ActorIdType, std::shared_ptr<SWSRDeliveryQueue<Message*>>> swsr_recv_queues;
+  // the queues that the senders find non-empty, taken into `active_recv_queues` for consumption
+  std::shared_ptr<SWSRReadyList<SWSRDeliveryQueue<Message*>>> ready_list;
   // pointers in `active_recv_queues` points to the queues in `swsr_recv_queues`
-  std::vector<std::pair<ActorIdType, SWSRDeliveryQueue<Message*>*>> active_recv_queues;
+  std::vector<SWSRDeliveryQueue<Message*>*> active_recv_queues;
   // Make it as a shared_ptr so that it can be managed as like other queues
   std::shared_ptr<SWSRDeliveryQueue<Message*>> self_swsr_queue;
+  // Only used when driven by an executor. Receiver actor id -> the messages that are sent after
+  // the queue becomes full, which are pushed before any later message to keep the order.
+  // The entries are kept after they are flushed.
+  struct PendingSends {
+    LocalActorHandle receiver;
+    std::deque<Message*> messages;
+    // whether the receiver sends SWSRMsgQueueRoom once it makes room
+    bool waiting_room = false;
+  };
+  DefaultHashMap<ActorIdType, PendingSends> pending_sends;
+  size_t num_pending_messages = 0;
+  size_t max_pending_messages = 1 << 20;
+  // whether some kept messages are not waiting for SWSRMsgQueueRoom
+  bool has_flushable_sends = false;
 };
 } // namespace zaf
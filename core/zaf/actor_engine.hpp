@@ -1,6 +1,15 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <exception>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <vector>
 
@@ -8,31 +17,138 @@
 #include "actor_behavior.hpp"
 #include "actor_group.hpp"
 #include "actor_system.hpp"
+#include "fiber.hpp"
+#include "mailbox.hpp"
+#include "macros.hpp"
+#include "metrics.hpp"
 #include "scoped_actor.hpp"
 
 namespace zaf {
 class ActorEngine : public ActorGroup {
 public:
+  /**
+   * How the executors decide which actors to run.
+   *
+   * Polling: each actor is pinned to one executor, which polls the mailboxes of all its actors.
+   *   Actors are moved among executors only by load rebalance, see `set_load_rebalance_period`.
+   *   Actors can poll extra zmq sockets, see `ActorBehavior::add_recv_poll`.
+   * WorkStealing: an actor is pushed into the queue of an executor once its mailbox has new
+   *   messages, and an idle executor steals actors from the queues of other executors.
+   *   Actors are run by readiness and only the mailbox of an actor is listened to.
+   *   An actor with delayed messages is also run when its earliest delayed message is due.
+   *   Actors spawned with a callable are run in fibers, see `spawn(Callable&&)`.
+   **/
+  enum class Scheduling {
+    Polling,
+    WorkStealing
+  };
+
   ActorEngine() = default;
 
-  ActorEngine(ActorSystem& actor_system, size_t num_executors);
+  ActorEngine(ActorSystem& actor_system, size_t num_executors,
+    Scheduling scheduling = Scheduling::Polling);
 
-  void initialize(ActorSystem& actor_system, size_t num_executors);
+  void initialize(ActorSystem& actor_system, size_t num_executors,
+    Scheduling scheduling = Scheduling::Polling);
 
   using ActorGroup::spawn;
   Actor spawn(ActorBehavior* new_actor) override;
   void init_scoped_actor(ActorBehavior&) override;
 
+  // Run the callable in a fiber. A receive that blocks, including the one nested in
+  // `RequestHandler::on_reply`, suspends the fiber instead of the executor that runs it,
+  // unless the actor polls extra zmq sockets. Only supported under WorkStealing scheduling,
+  // and not for ActorBehaviorX, whose sends may block.
+  template<typename Callable,
+    typename Signature = traits::is_callable<Callable>,
+    std::enable_if_t<Signature::value>* = nullptr,
+    std::enable_if_t<Signature::args_t::size == 1>* = nullptr,
+    typename ActorType = typename Signature::args_t::template decay_arg_t<0>,
+    std::enable_if_t<std::is_base_of_v<ActorBehavior, ActorType>>* = nullptr>
+  Actor spawn(Callable&& callable) {
+    auto new_actor = new ActorType();
+    return spawn_in_fiber(new_actor, [run = std::forward<Callable>(callable), new_actor]() mutable {
+      run(*new_actor);
+    });
+  }
+
+  // the stack size of the fibers created afterwards
+  void set_fiber_stack_size(size_t stack_size);
+
   void set_load_diff_ratio(double ratio);
   void set_load_rebalance_period(size_t period);
+  // the max number of messages an actor processes in a batch before
+  // the executor switches to another actor
+  void set_max_messages_per_run(size_t max_messages);
 
   void terminate();
 
   ActorSystem& get_actor_system();
+  size_t get_num_executors() const;
 
   ~ActorEngine();
 
 private:
+  using TimePoint = std::chrono::steady_clock::time_point;
+  class Runnable;
+  // std::multimap as the runnables keep their iterators, which btree maps do not keep valid
+  using TimerMap = std::multimap<TimePoint, Runnable*>;
+
+  // An actor under WorkStealing scheduling.
+  // It is the listener of the mailbox of the actor and thus owned by the mailbox.
+  // It is also the waiter of the mailbox if the actor runs in a fiber.
+  class Runnable : public MailboxListener, public MailboxWaiter {
+  public:
+    enum State : int {
+      Idle,            // not in any queue and not running
+      Scheduled,       // in the queue of an executor
+      Running,         // being run by an executor
+      RunningNotified, // being run by an executor, and to be scheduled again after the run
+      Dead             // the actor has terminated
+    };
+
+    Runnable(ActorEngine& engine, ActorBehavior* actor, size_t eid);
+
+    bool on_mailbox_signaled() override;
+
+    // suspend the fiber until the runnable is scheduled again
+    void wait(long timeout) override;
+
+    ActorEngine& engine;
+    ActorBehavior* actor;
+    MessageHandlers handlers;
+    std::atomic<int> state{Scheduled};
+    size_t eid; // the executor that runs the actor most recently
+    bool started = false;
+    // the fiber that runs the callable of the actor, nullptr if the actor runs by its behavior
+    std::unique_ptr<Fiber> fiber;
+    // whether the actor runs in a fiber, unchanged after the runnable is created
+    bool in_fiber = false;
+    // the entry in `engine.timers` if `has_timer`, guarded by `engine.timers_mutex`
+    bool has_timer = false;
+    TimerMap::iterator timer;
+  };
+
+  struct RunQueue {
+    std::mutex mutex;
+    std::deque<Runnable*> runnables;
+  };
+
+  Actor spawn_in_fiber(ActorBehavior* new_actor, std::function<void()> body);
+  // start to schedule the runnable of a newly spawned actor
+  void add_runnable(Runnable* runnable);
+  void schedule(Runnable* runnable, size_t eid);
+  Runnable* next_runnable(size_t eid);
+  bool has_runnables();
+  void park_executor();
+  void retire(Runnable* runnable);
+  // run the runnable again at `deadline` unless it already has an earlier timer
+  void add_timer(Runnable* runnable, TimePoint deadline);
+  void remove_timer(Runnable* runnable);
+  // notify the runnables whose timers are due
+  void fire_timers();
+  void stop_executors();
+
   class Executor : public ActorBehavior {
   public:
     inline const static Code NewActor{0};
@@ -44,6 +160,10 @@ private:
 
     MessageHandlers behavior() override;
 
+    bool is_blocking() const override;
+
+    void initialize_actor(ActorSystem& sys, ActorGroup& group) override;
+
     void listen_to_actor(ActorBehavior* new_actor, MessageHandlers&& handler);
 
     void launch() override;
@@ -51,14 +171,22 @@ private:
     void load_rebalance();
 
   private:
+    void launch_work_stealing();
+    void exit();
+    void run(Runnable* runnable);
+
     ActorEngine& engine;
     std::vector<ActorBehavior*> actors;       // actors[0] will be `this`
-    std::vector<MessageHandlers> handlers;    // handlers[0] will be `this->behave()`
+    // handlers[0] will be `this->behave()`
+    // a deque so that the handlers being used are not moved when handlers of new actors are added
+    std::deque<MessageHandlers> handlers;
     std::vector<zmq::pollitem_t> poll_items;  // poll_items[0] will be the poll item of this
     size_t num_poll_items = 0;
     const size_t eid;
+    ExecutorMetrics executor_metrics;
   };
 
+  Scheduling scheduling = Scheduling::Polling;
   size_t num_executors = 0, next_executor = 0;
   std::vector<Actor> executors;
   ScopedActor<ActorBehavior> forwarder;
@@ -74,5 +202,26 @@ private:
   // larger period = longer time for a rebalance
   // smaller period = previous ActorTransfer may not take effect when a new ActorTransfer is issued.
   size_t load_rebalance_period = 0; // 0 means no load rebalance
+
+  size_t max_messages_per_run = 64;
+  size_t fiber_stack_size = Fiber::DefaultStackSize;
+
+  // for work stealing
+  std::vector<std::unique_ptr<RunQueue>> run_queues;
+  DefaultHashSet<Runnable*> runnables;
+  std::mutex runnables_mutex;
+  std::atomic<size_t> num_idle_executors{0};
+  std::condition_variable idle_cv;
+  // the runnables that have delayed messages, ordered by when the earliest one is due
+  TimerMap timers;
+  std::mutex timers_mutex;
+  // the earliest deadline in `timers` in ticks of the steady clock, max if there is no timer
+  std::atomic<TimePoint::rep> next_timer_deadline{std::numeric_limits<TimePoint::rep>::max()};
+
+  // for stopping executors
+  std::mutex executors_mutex;
+  std::condition_variable executors_done_cv;
+  size_t num_running_executors = 0;
+  std::atomic<bool> stop_requested{false};
 };
 } // namespace zaf
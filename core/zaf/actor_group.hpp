@@ -19,6 +19,7 @@ public:
   void dec_num_alive_actors();
   void inc_num_detached_actors();
   void dec_num_detached_actors();
+  size_t get_num_alive_actors() const;
 
   template<typename ActorClass, typename ... ArgT>
   Actor spawn(ArgT&& ... args) {
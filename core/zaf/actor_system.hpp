@@ -1,6 +1,9 @@
 #pragma once
 
+#include <chrono>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <type_traits>
@@ -9,15 +12,27 @@
 #include "actor.hpp"
 #include "actor_behavior.hpp"
 #include "actor_group.hpp"
+#include "mailbox.hpp"
+#include "metrics.hpp"
 #include "scoped_actor.hpp"
 #include "thread_utils.hpp"
 
 #include "zmq.hpp"
 
 namespace zaf {
+class ActorEngine;
+
+/**
+ * 1. Actors that are not blocking (see `ActorBehavior::is_blocking`) are run by the default
+ *    scheduler, i.e., an ActorEngine under WorkStealing scheduling with one executor per core,
+ *    so that an idle actor costs its memory but not a thread.
+ * 2. Blocking actors and actors spawned with a callable are run on dedicated threads.
+ * 3. The scheduler is started by the first spawn of a non-blocking actor and stopped
+ *    once all the actors are done, see `await_all_actors_done`.
+ **/
 class ActorSystem : public ActorGroup {
 public:
-  ActorSystem() = default;
+  ActorSystem();
 
   ActorSystem(const ActorSystem&) = delete;
   ActorSystem& operator=(const ActorSystem&) = delete;
@@ -32,6 +47,7 @@ public:
   using ActorGroup::spawn;
   Actor spawn(ActorBehavior* new_actor) override;
 
+  // the callable runs on a dedicated thread as it drives the actor by itself
   template<typename Callable,
     typename Signature = traits::is_callable<Callable>,
     std::enable_if_t<Signature::value>* = nullptr,
@@ -60,14 +76,35 @@ public:
 
   zmq::context_t& get_zmq_context();
 
+  // the registry of the mailboxes of the local actors
+  void register_mailbox(ActorIdType id, const std::shared_ptr<Mailbox>& mailbox);
+  void deregister_mailbox(ActorIdType id, const std::shared_ptr<Mailbox>& mailbox);
+  std::shared_ptr<Mailbox> lookup_mailbox(ActorIdType id);
+
   ActorIdType get_next_available_actor_id();
 
+  // the metrics of the alive actors, executors and NetGate links in this ActorSystem
+  MetricsSnapshot snapshot_metrics() const;
+  // append a snapshot of the metrics to the file at `path` as a line of JSON every `period`
+  // until `stop_dumping_metrics` is called or the ActorSystem is destroyed
+  void dump_metrics(const std::string& path, std::chrono::milliseconds period);
+  void stop_dumping_metrics();
+  MetricsRegistry& get_metrics_registry();
+
+  // the number of executors of the default scheduler, 0 (default) means one per core
+  // take effect when the scheduler is started next time
+  void set_num_scheduler_executors(size_t num_executors);
+
   void set_identifier(const std::string&);
   const std::string& get_identifier() const;
 
   ~ActorSystem();
 
 private:
+  ActorEngine& get_scheduler();
+  // invoked as a terminator, i.e., when all the actors but the detached ones are done
+  void stop_scheduler();
+
   std::atomic<size_t> num_alive_actors{0};
   std::condition_variable all_actors_done_cv;
   std::mutex all_actors_done_mutex;
@@ -79,5 +116,15 @@ private:
   std::string identifier = "zaf";
 
   zmq::context_t zmq_context;
+
+  // actor id -> mailbox, looked up once per pair of sender and receiver
+  DefaultHashMap<ActorIdType, std::shared_ptr<Mailbox>> mailboxes;
+  std::mutex mailboxes_mutex;
+
+  MetricsRegistry metrics_registry;
+
+  std::unique_ptr<ActorEngine> scheduler;
+  size_t num_scheduler_executors = 0;
+  std::mutex scheduler_mutex;
 };
 } // namespace zaf
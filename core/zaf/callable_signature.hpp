@@ -1,9 +1,11 @@
 #pragma once
 
 #include <cstddef>
+#include <tuple>
 #include <type_traits>
 
 #include "hash.hpp"
+#include "views.hpp"
 
 namespace zaf {
 template<size_t N, typename Arg, typename ... ArgT>
@@ -20,8 +22,9 @@ template<typename ... ArgT>
 struct ArgumentsSignature {
   inline constexpr static size_t size = sizeof ... (ArgT);
 
+  // a view argument has the hash code of the viewed type, see views.hpp
   inline constexpr static size_t hash_code() {
-    return hash_combine(typeid(ArgT).hash_code() ...);
+    return hash_combine(typeid(traits::content_type_t<ArgT>).hash_code() ...);
   }
 
   template<size_t N>
@@ -29,6 +32,17 @@ struct ArgumentsSignature {
 
   template<size_t N>
   using decay_arg_t = std::decay_t<arg_t<N>>;
+
+  // the type of the N-th element in the messages accepted by the arguments
+  template<size_t N>
+  using content_arg_t = traits::content_type_t<arg_t<N>>;
+
+  // the content tuple of the messages that exactly match the arguments
+  using content_tuple_t = std::tuple<traits::content_type_t<ArgT> ...>;
+
+  // whether the content tuple can be instantiated
+  inline constexpr static bool content_tuple_instantiable =
+    (!std::is_abstract_v<traits::content_type_t<ArgT>> && ...);
 };
 
 template<>
@@ -38,6 +52,10 @@ struct ArgumentsSignature<> {
   inline constexpr static size_t hash_code() {
     return hash_combine();
   }
+
+  using content_tuple_t = std::tuple<>;
+
+  inline constexpr static bool content_tuple_instantiable = true;
 };
 
 template<typename RetType, typename ... ArgT>
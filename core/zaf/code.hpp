@@ -25,5 +25,6 @@ struct DefaultCodes {
   inline constexpr static Code Request                  {ZAFCodeBase + 6};
   inline constexpr static Code Response                 {ZAFCodeBase + 7};
   inline constexpr static Code DefaultMessageHandler    {ZAFCodeBase + 8};
+  inline constexpr static Code SWSRMsgQueueRoom         {ZAFCodeBase + 9};
 };
 } // namespace zaf
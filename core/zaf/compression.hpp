@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace zaf {
+// The codecs that NetGate can compress batches with.
+// LZ4 is available only if ZAF is built with ENABLE_LZ4.
+enum class Compression : uint8_t {
+  None = 0,
+  LZ4 = 1
+};
+
+namespace compression {
+// whether the codec is available in this build
+bool is_supported(Compression codec);
+
+// the max number of bytes that compressing `size` bytes may produce
+size_t max_compressed_size(Compression codec, size_t size);
+
+// compress `size` bytes from `src` into `dst` that has `capacity` bytes
+// return the number of compressed bytes, or 0 if the bytes cannot be compressed into `capacity` bytes
+size_t compress(Compression codec, const char* src, size_t size, char* dst, size_t capacity);
+
+// decompress `size` bytes from `src` into `dst`, which are expected to be `raw_size` bytes
+// throw ZAFException if the bytes are corrupt
+void decompress(Compression codec, const char* src, size_t size, char* dst, size_t raw_size);
+} // namespace compression
+} // namespace zaf
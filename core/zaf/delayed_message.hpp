@@ -7,15 +7,23 @@
 #include "message_bytes.hpp"
 
 namespace zaf {
+// The deadline of a request sent by the actor that owns the delayed messages.
+// No message is created for it, the actor expires the request when the deadline is due.
+struct RequestDeadline {
+  unsigned request_id;
+};
+
 struct DelayedMessage {
   Actor receiver;
   std::variant<
     Message*,
-    MessageBytes
+    MessageBytes,
+    RequestDeadline
   > message;
 
   DelayedMessage(const Actor& r, Message* m);
   DelayedMessage(const Actor& r, MessageBytes&& m);
+  DelayedMessage(RequestDeadline d);
   DelayedMessage(const DelayedMessage&) = delete;
   DelayedMessage(DelayedMessage&&);
   DelayedMessage& operator=(const DelayedMessage&) = delete;
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+#include <ucontext.h>
+
+namespace zaf {
+/**
+ * A stackful coroutine based on ucontext.
+ *
+ * 1. `resume` runs the fiber on the calling thread until the fiber calls `suspend` or its
+ *    body returns. A suspended fiber can be resumed by another thread later.
+ * 2. The stack is mapped with a guard page at its bottom, and only the touched pages of
+ *    the stack take physical memory.
+ * 3. The body must not throw. Code in the fiber must not keep the address of a
+ *    thread_local variable across `suspend` as the fiber may be resumed by another thread.
+ **/
+class Fiber {
+public:
+  static constexpr size_t DefaultStackSize = 256 * 1024;
+
+  Fiber(std::function<void()> body, size_t stack_size = DefaultStackSize);
+  Fiber(const Fiber&) = delete;
+  Fiber& operator=(const Fiber&) = delete;
+
+  // run the fiber until it suspends or finishes, must not be called by a fiber
+  void resume();
+
+  // return to the thread that resumes the fiber, must be called by the fiber itself
+  void suspend();
+
+  bool is_done() const;
+
+  // the fiber that is running on the calling thread, or nullptr if there is none
+  static Fiber* current();
+
+  // a fiber destroyed before it finishes does not unwind its stack
+  ~Fiber();
+
+private:
+  static void entry();
+
+  std::function<void()> body;
+  ucontext_t context;
+  ucontext_t caller;
+  // the guard page followed by the stack
+  void* mapping = nullptr;
+  size_t mapping_size = 0;
+  bool done = false;
+};
+} // namespace zaf
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+
+namespace zaf {
+// helpers for the JSON written by the metrics and the tracer
+namespace json {
+// write `str` as a quoted JSON string, control characters are replaced by spaces
+void write_string(std::ostream& out, const std::string& str);
+} // namespace json
+} // namespace zaf
@@ -23,6 +23,50 @@ inline constexpr size_t MaxActorId = []() {
   return max_id;
 }();
 
+#ifndef ENABLE_MESSAGE_POOL
+  #define ENABLE_MESSAGE_POOL 0
+#endif
+#if ZAF_PRINT_MACROS
+  #if ENABLE_MESSAGE_POOL
+    #pragma message("Allocate messages from MessagePool")
+  #else
+    #pragma message("Allocate messages from the global allocator")
+  #endif
+#endif
+
+#ifndef ENABLE_LZ4
+  #define ENABLE_LZ4 0
+#endif
+#if ZAF_PRINT_MACROS
+  #if ENABLE_LZ4
+    #pragma message("NetGate can compress batches with LZ4")
+  #else
+    #pragma message("NetGate cannot compress batches")
+  #endif
+#endif
+
+#ifndef ENABLE_METRICS
+  #define ENABLE_METRICS 0
+#endif
+#if ZAF_PRINT_MACROS
+  #if ENABLE_METRICS
+    #pragma message("Collect the metrics of actors, executors and NetGate links")
+  #else
+    #pragma message("Do not collect metrics")
+  #endif
+#endif
+
+#ifndef ENABLE_TRACING
+  #define ENABLE_TRACING 0
+#endif
+#if ZAF_PRINT_MACROS
+  #if ENABLE_TRACING
+    #pragma message("Message events can be traced")
+  #else
+    #pragma message("Message events cannot be traced")
+  #endif
+#endif
+
 #ifndef ENABLE_PHMAP
   #define ENABLE_PHMAP 0
   #if ZAF_PRINT_MACROS
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "macros.hpp"
+
+#include "zmq.hpp"
+
+namespace zaf {
+class Message;
+
+// The intrusive link used by Mailbox, every Message carries one.
+// A message can be in at most one mailbox at the same time.
+struct MailboxNode {
+  MailboxNode() = default;
+  // the link is not copied, a copied message is not in any mailbox
+  MailboxNode(const MailboxNode&) {}
+  MailboxNode& operator=(const MailboxNode&) { return *this; }
+
+  std::atomic<MailboxNode*> next_in_mailbox{nullptr};
+};
+
+// Receives the signals of a Mailbox instead of (or before) the reader that polls the mailbox,
+// e.g., a scheduler that runs the reader only when the reader has messages to read.
+class MailboxListener {
+public:
+  // invoked by a writer when the mailbox has new messages that the reader is not aware of
+  // return true if the signal is consumed, or false to also wake up the reader via the poll item
+  virtual bool on_mailbox_signaled() = 0;
+  virtual ~MailboxListener() = default;
+};
+
+// Waits for the signals of a Mailbox on behalf of the reader instead of polling the mailbox,
+// e.g., a scheduler that suspends the fiber of the reader until the mailbox is signaled.
+class MailboxWaiter {
+public:
+  // invoked by the reader, return when the mailbox is signaled or `timeout` ms elapse
+  // (-1 means no timeout), or spuriously
+  virtual void wait(long timeout) = 0;
+  virtual ~MailboxWaiter() = default;
+};
+
+/**
+ * Multi-writer single-reader message queue for local message delivery.
+ *
+ * 1. The queue is the intrusive lock-free MPSC queue by Dmitry Vyukov. `push` is
+ *    wait-free, i.e., one exchange plus one store, and `try_pop` does not need to lock.
+ * 2. The reader is woken up via a file descriptor (eventfd on linux, pipe otherwise)
+ *    so that the mailbox can be polled together with zmq sockets by `zmq::poll`.
+ * 3. Writers only signal the fd when the mailbox changes from "the reader is not
+ *    aware of new messages" to "the reader is aware of new messages", i.e., when
+ *    `notified` changes from false to true. The reader resets `notified` with
+ *    `prepare_wait` only when it finds no message to read. Thus a busy reader
+ *    does not incur any system call.
+ **/
+class Mailbox {
+public:
+  Mailbox();
+  Mailbox(const Mailbox&) = delete;
+  Mailbox& operator=(const Mailbox&) = delete;
+
+  // any thread can call
+  void push(Message* m);
+
+  // only reader can call
+  // return nullptr if there is no message that is ready to read
+  Message* try_pop();
+
+  // only reader can call
+  // whether there is no message in the mailbox
+  bool empty() const;
+
+  // any thread can call
+  // the number of messages pushed but not yet popped, counted only if ZAF is built with ENABLE_METRICS
+  size_t approx_size() const;
+
+  // only reader can call before waiting on the poll item of the mailbox
+  // return true if the mailbox is empty and the reader can wait until writers signal;
+  // return false if there are messages in the mailbox and the reader should not wait.
+  bool prepare_wait();
+
+  // the poll item that becomes readable when the mailbox receives new messages
+  zmq::pollitem_t get_poll_item() const;
+
+  // the mailbox takes the ownership of the listener, and the listener is kept until
+  // the mailbox is destroyed because writers may still hold the mailbox
+  // set at most once, usually before the reader starts to read
+  void set_listener(std::unique_ptr<MailboxListener> listener);
+  MailboxListener* get_listener() const;
+
+  // mark the mailbox as closed, i.e., the reader will not read the mailbox any more
+  void close();
+  bool is_closed() const;
+
+  // delete all the messages in the mailbox
+  ~Mailbox();
+
+private:
+  // `try_pop` without counting the message
+  Message* take();
+  void signal();
+  void clear_signal();
+
+  // writers exchange `head`
+  alignas(64) std::atomic<MailboxNode*> head;
+  // in the same cache line as `head`, which writers own already when they push
+  std::atomic<size_t> num_pushed{0};
+  // reader reads from `tail`
+  alignas(64) MailboxNode* tail;
+  MailboxNode stub;
+  // only updated by the reader
+  std::atomic<size_t> num_popped{0};
+  // whether the reader is (or will be) aware of the messages in the mailbox
+  alignas(64) std::atomic<bool> notified{false};
+  std::atomic<bool> closed{false};
+  std::atomic<MailboxListener*> listener{nullptr};
+  // whether the fd may be readable, used to avoid reading the fd when it is not signaled
+  std::atomic<bool> fd_signaled{false};
+  // read_fd == write_fd when eventfd is used
+  int read_fd = -1;
+  int write_fd = -1;
+};
+} // namespace zaf
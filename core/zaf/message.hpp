@@ -1,15 +1,24 @@
 #pragma once
 
+#include <cstddef>
+#include <new>
 #include <type_traits>
 
 #include "actor.hpp"
+#include "mailbox.hpp"
 #include "message_body.hpp"
 
 namespace zaf {
-class Message {
+class Message : public MailboxNode {
 public:
   Message(const Actor& sender);
 
+  // messages are allocated by MessagePool
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr, size_t size);
+  static void* operator new(size_t size, std::align_val_t align);
+  static void operator delete(void* ptr, size_t size, std::align_val_t align);
+
   const Actor& get_sender() const;
 
   virtual MessageBody& get_body() = 0;
@@ -33,6 +42,10 @@ public:
     Body(code, std::forward<ArgT>(args) ...) {
   }
 
+  // both Message and MessageBody define operator new and delete
+  using Message::operator new;
+  using Message::operator delete;
+
   MessageBody& get_body() {
     return *this;
   }
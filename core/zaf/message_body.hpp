@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <new>
 #include <string>
 #include <tuple>
 #include <type_traits>
@@ -20,6 +23,12 @@ class MessageBody {
 public:
   MessageBody(Code code);
 
+  // message bodies are allocated by MessagePool
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr, size_t size);
+  static void* operator new(size_t size, std::align_val_t align);
+  static void operator delete(void* ptr, size_t size, std::align_val_t align);
+
   // the code of the message body
   size_t get_code() const;
 
@@ -41,23 +50,42 @@ private:
   Code code;
 };
 
+// the address of `value` uniquely identifies the type T without RTTI
+template<typename T>
+struct ContentTypeTag {
+  inline static const char value = 0;
+};
+
 class MemoryMessageBody : public MessageBody {
 public:
-  MemoryMessageBody(Code code);
+  MemoryMessageBody(Code code, const void* content_type_tag = nullptr);
 
   bool is_serialized() const override;
 
   virtual void get_element_ptrs(std::vector<std::uintptr_t>& addrs) const = 0;
+
+  // &ContentTypeTag<ContentTuple>::value if the body is a TypedMessageBody<ContentTuple>,
+  // used to downcast the body without a virtual call
+  inline const void* get_content_type_tag() const {
+    return content_type_tag;
+  }
+
+private:
+  const void* content_type_tag;
 };
 
 template<typename ContentTuple>
 class TypedMessageBody : public MemoryMessageBody {
 public:
   TypedMessageBody(Code code, ContentTuple&& content):
-    MemoryMessageBody(code),
+    MemoryMessageBody(code, &ContentTypeTag<ContentTuple>::value),
     content(std::move(content)) {
   }
 
+  inline ContentTuple& get_content() {
+    return content;
+  }
+
   template<typename>
   struct TypesHashCode;
 
@@ -204,6 +232,33 @@ private:
   const size_t types_hash;
 };
 
+// The bytes of one message within a batch received from the network, e.g., by NetGate::Receiver.
+// The batch is shared by the messages in it and is freed when the last of them is destroyed.
+struct BatchSlice {
+  std::shared_ptr<const zmq::message_t> batch;
+  size_t offset = 0;
+  size_t size = 0;
+};
+
+// Used in NetGate::Receiver, no bytes are copied out of the batch
+template<>
+struct TypedSerializedMessageBody<BatchSlice> : public SerializedMessageBody {
+public:
+  TypedSerializedMessageBody(Code code, size_t types_hash, BatchSlice&& slice);
+
+  Deserializer make_deserializer() const override;
+
+  size_t get_type_hash_code() const override;
+
+  void serialize(Serializer& s) override;
+
+  void serialize_content(Serializer& s) override;
+
+private:
+  const BatchSlice slice;
+  const size_t types_hash;
+};
+
 void serialize(Serializer&, MessageBody*);
 
 template<typename T,
@@ -212,8 +267,8 @@ T deserialize(Deserializer& s) {
   auto code = s.read<Code>();
   auto type_hash = s.read<size_t>();
   auto num_bytes = s.read<unsigned>();
-  std::vector<char> bytes(num_bytes);
-  s.read_bytes(&bytes.front(), num_bytes);
+  auto view = s.read_view(num_bytes);
+  std::vector<char> bytes(view, view + num_bytes);
   return new TypedSerializedMessageBody<std::vector<char>>(
     code,
     type_hash,
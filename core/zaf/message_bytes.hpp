@@ -8,9 +8,18 @@
 #include "serializer.hpp"
 
 namespace zaf {
+// A message serialized for a remote actor, which is forwarded to the NetGate::Sender.
+// The header and the content are serialized into one buffer that is reserved
+// with the serialized sizes of the arguments, i.e., usually allocated once.
 struct MessageBytes {
-  std::vector<char> header;
-  std::vector<char> content;
+  inline constexpr static size_t HeaderSize =
+    LocalActorHandle::SerializationSize + // sender
+    LocalActorHandle::SerializationSize + // receiver
+    sizeof(Code) +
+    sizeof(size_t) + // type hash
+    sizeof(unsigned); // number of bytes of the content
+
+  std::vector<char> bytes;
 
   MessageBytes() = default;
   MessageBytes(const MessageBytes&) = delete;
@@ -21,25 +30,22 @@ struct MessageBytes {
   template<typename ... ArgT>
   static MessageBytes make(const LocalActorHandle& send,
     const LocalActorHandle& recv, Code code, ArgT&& ... args) {
-    MessageBytes bytes;
-    bytes.header.reserve(
-      LocalActorHandle::SerializationSize +
-      LocalActorHandle::SerializationSize +
-      sizeof(code) +
-      sizeof(size_t) +
-      sizeof(unsigned)
-    );
+    MessageBytes m;
     const size_t type_hash = hash_combine(typeid(std::decay_t<ArgT>).hash_code() ...);
-    Serializer(bytes.header)
-      .write(send)
-      .write(recv)
-      .write(code)
-      .write(type_hash);
-    Serializer(bytes.content)
-      .write(std::forward<ArgT>(args) ...);
-    Serializer(bytes.header)
-      .write(static_cast<unsigned>(bytes.content.size()));
-    return bytes;
+    Serializer s(m.bytes);
+    s.reserve(HeaderSize + (size_t(0) + ... + serialized_size(args)));
+    s.write(send)
+     .write(recv)
+     .write(code)
+     .write(type_hash);
+    auto num_bytes_ptr = s.size();
+    s.write(unsigned{0})
+     .write(std::forward<ArgT>(args) ...);
+    // back-patch the number of bytes of the content
+    s.move_write_ptr_to(num_bytes_ptr);
+    s.write(static_cast<unsigned>(s.size() - num_bytes_ptr - sizeof(unsigned)));
+    s.move_write_ptr_to_end();
+    return m;
   }
 };
 } // namespace zaf
@@ -67,6 +67,17 @@ public:
   // recover the types of the arguments in the message
   // then forward the arguments into the handler
   void process_body(MemoryMessageBody& body) override {
+    if constexpr (ArgTypes::content_tuple_instantiable) {
+      using Body = TypedMessageBody<typename ArgTypes::content_tuple_t>;
+      // fast path: the content is exactly the tuple of the argument types,
+      // thus there is no need to check the type hash or collect the element addresses
+      if (body.get_content_type_tag() ==
+          &ContentTypeTag<typename ArgTypes::content_tuple_t>::value) {
+        process_content(static_cast<Body&>(body).get_content(), body.get_code(),
+          std::make_index_sequence<ArgTypes::size>());
+        return;
+      }
+    }
     if (body.get_type_hash_code() != ArgTypes::hash_code()) {
       throw ZAFException("The hash code of the message content types does not"
         " match with the argument types of the message handler.",
@@ -101,7 +112,7 @@ public:
     try {
       handler(
         static_cast<typename ArgTypes::template arg_t<I>>(
-          *reinterpret_cast<typename ArgTypes::template decay_arg_t<I>*>(
+          *reinterpret_cast<typename ArgTypes::template content_arg_t<I>*>(
             message_element_addrs.operator[](I)
           )
         )...
@@ -115,6 +126,23 @@ public:
     }
   }
 
+  template<typename Content, size_t ... I>
+  inline void process_content(Content& content, size_t code, std::index_sequence<I ...>) {
+    try {
+      handler(
+        static_cast<typename ArgTypes::template arg_t<I>>(
+          std::get<I>(content)
+        )...
+      );
+    } catch (...) {
+      std::throw_with_nested(ZAFException(
+        "Exception caught in ", __PRETTY_FUNCTION__,
+        " when handling typed message with code ", code,
+        " (", std::hex, code, ")."
+      ));
+    }
+  }
+
   template<size_t ... I>
   inline void process_body(SerializedMessageBody& m, std::index_sequence<I ...>) {
     auto&& content = m.deserialize_content<ArgTypes>();
@@ -1,14 +1,32 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include "code.hpp"
 #include "message_handler.hpp"
 
 namespace zaf {
+/**
+ * A set of message handlers indexed by their codes.
+ *
+ * 1. The handlers are owned in a vector sorted by code, and are indexed by a flat
+ *    dispatch table: handlers of small codes, e.g., the codes defined by users, are
+ *    stored in an array indexed by code, and the others, e.g., DefaultCodes, are
+ *    stored in a small vector sorted by code, or a flat hash table if there are many
+ *    of them. Thus finding the handler for a small code is a single indexed load.
+ * 2. When child handlers are added, the dispatch table of the handlers and that of
+ *    the child are merged so that a message is dispatched with one lookup instead of
+ *    one lookup per level. The merged table is cached and rebuilt only when the child
+ *    or any of the two handler sets changes.
+ **/
 class MessageHandlers {
 public:
   template<typename ... ArgT>
-  MessageHandlers(ArgT&& ... args):
-    default_handler(nullptr) {
+  MessageHandlers(ArgT&& ... args) {
     add_handlers(std::forward<ArgT>(args) ...);
   }
 
@@ -30,7 +48,7 @@ public:
       }
       default_handler = std::move(code_handler.second);
     } else {
-      if (!handlers.emplace(std::move(code_handler)).second) {
+      if (!set_handler(code_handler.first, std::move(code_handler.second), false)) {
         throw ZAFException("Message handler code conflicts with a previous "
           "handler. Code: ", code_handler.first);
       }
@@ -43,22 +61,86 @@ public:
     if (code_handler.first == DefaultCodes::DefaultMessageHandler) {
       default_handler = std::move(code_handler.second);
     } else {
-      handlers[code_handler.first] = std::move(code_handler.second);
+      set_handler(code_handler.first, std::move(code_handler.second), true);
     }
     update_handlers(std::forward<ArgT>(args) ...);
   }
 
   size_t size() const;
 
+  // rebuild the dispatch table after the handlers are added or updated
   void add_handlers();
+  void update_handlers();
 
   void add_child_handlers(MessageHandlers& child);
   MessageHandlers& get_child_handlers();
   void remove_child_handlers();
 
 private:
-  DefaultHashMap<size_t, std::unique_ptr<MessageHandler>> handlers;
+  struct DispatchTable {
+    // the handlers of small codes, indexed by code, nullptr if a code has no handler
+    std::vector<MessageHandler*> dense;
+    // the handlers of the other codes, sorted by code if there are only a few of them,
+    // otherwise an open addressing hash table with linear probing
+    std::vector<std::pair<size_t, MessageHandler*>> sparse;
+    bool sparse_hashed = false;
+    MessageHandler* default_handler = nullptr;
+
+    // `handlers` must be sorted by code without duplicates
+    void build(const std::vector<std::pair<size_t, MessageHandler*>>& handlers,
+      MessageHandler* default_handler);
+
+    // fibonacci hashing into a table with 2^(64 - sparse_shift) slots
+    unsigned sparse_shift = 0;
+    inline size_t hash(size_t code) const {
+      return size_t(uint64_t(code) * 11400714819323198485ull >> sparse_shift);
+    }
+
+    inline MessageHandler* find(size_t code) const {
+      if (code < dense.size()) {
+        return dense[code];
+      }
+      if (sparse_hashed) {
+        auto mask = sparse.size() - 1;
+        for (auto i = hash(code); ; i = (i + 1) & mask) {
+          if (sparse[i].first == code) {
+            return sparse[i].second;
+          }
+          if (!sparse[i].second) {
+            return nullptr;
+          }
+        }
+      }
+      for (auto& h : sparse) {
+        if (h.first >= code) {
+          return h.first == code ? h.second : nullptr;
+        }
+      }
+      return nullptr;
+    }
+  };
+
+  // return false if `replace` is false and the code already has a handler
+  bool set_handler(size_t code, std::unique_ptr<MessageHandler>&& handler, bool replace);
+
+  void rebuild_table();
+
+  // the table to dispatch messages to the handlers of both this and the child,
+  // or nullptr if the child has its own child, in which case the child is looked up recursively
+  const DispatchTable* get_dispatch_table();
+
+  // sorted by code
+  std::vector<std::pair<size_t, std::unique_ptr<MessageHandler>>> handlers;
   MessageHandlers* child = nullptr;
   std::unique_ptr<MessageHandler> default_handler = nullptr;
+
+  // a unique number that changes whenever the handlers are changed
+  uint64_t version = 0;
+  DispatchTable table;
+  // `table` merged with the table of `merged_child`
+  DispatchTable merged_table;
+  const MessageHandlers* merged_child = nullptr;
+  uint64_t merged_child_version = 0;
+  uint64_t merged_version = 0;
 };
 } // namespace zaf
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+
+namespace zaf {
+/**
+ * Per-thread size-class pool for the memory of messages.
+ *
+ * 1. Each thread owns a pool that keeps a free list for each size class. Allocating
+ *    and freeing a block owned by the current thread do not need any synchronization.
+ * 2. A block freed by a thread other than its owner is put into a small batch for the
+ *    owner, and a full batch is pushed to the return list of the owner with one CAS.
+ *    The owner takes back the returned blocks once a free list becomes empty.
+ *    Thus messages allocated by a sender and freed by a receiver go back to the sender.
+ * 3. The pool of an exited thread is kept and adopted by a later thread because the
+ *    blocks allocated by the exited thread may still be in use.
+ * 4. Memory larger than the largest size class is allocated by ::operator new.
+ *
+ * The pool is used by the operator new/delete of Message and MessageBody.
+ * Compile with ENABLE_MESSAGE_POOL=0 to forward all the allocations to ::operator new.
+ **/
+class MessagePool {
+public:
+  struct Stats {
+    size_t num_allocations = 0;
+    // allocations served by free lists
+    size_t num_reuses = 0;
+    // allocations larger than the largest size class
+    size_t num_large_allocations = 0;
+    size_t num_deallocations = 0;
+    // deallocations by a thread other than the owner of the block
+    size_t num_remote_deallocations = 0;
+    // batches of blocks returned to the owners
+    size_t num_returned_batches = 0;
+  };
+
+  static void* allocate(size_t size);
+  static void deallocate(void* ptr, size_t size);
+
+  // flush the blocks that are freed by the current thread but not yet returned to their owners
+  static void flush_returns();
+
+  // aggregated over all the threads
+  static Stats get_stats();
+  // of the pool used by the current thread only, which may be adopted from an exited thread
+  static Stats get_thread_stats();
+};
+} // namespace zaf
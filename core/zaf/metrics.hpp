@@ -0,0 +1,274 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "macros.hpp"
+#include "message_pool.hpp"
+
+namespace zaf {
+class Mailbox;
+
+// A counter that is updated by one thread at a time and read by any thread.
+// Updating it is a relaxed load and store instead of a read-modify-write,
+// thus it costs about the same as incrementing a plain integer.
+class MetricCounter {
+public:
+  inline void add(uint64_t n = 1) {
+    value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  inline void set(uint64_t n) {
+    value.store(n, std::memory_order_relaxed);
+  }
+
+  inline uint64_t get() const {
+    return value.load(std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<uint64_t> value{0};
+};
+
+// Durations in power-of-two buckets of nanoseconds.
+// Bucket 0 counts 0ns, and bucket i (i > 0) counts the durations in [2^(i-1), 2^i) ns.
+// Updated by one thread at a time.
+class LatencyHistogram {
+public:
+  inline constexpr static size_t NumBuckets = 64;
+
+  struct Stats {
+    std::array<uint64_t, NumBuckets> buckets{};
+    uint64_t count = 0;
+    uint64_t sum_ns = 0;
+
+    double mean_ns() const;
+    // the upper bound of the bucket that contains the p-th percentile, p in [0, 100]
+    uint64_t percentile_ns(double p) const;
+  };
+
+  inline void record(uint64_t ns) {
+    size_t i = ns == 0 ? 0 : 64 - __builtin_clzll(ns);
+    buckets[i < NumBuckets ? i : NumBuckets - 1].add();
+    sum_ns.add(ns);
+  }
+
+  Stats get_stats() const;
+
+private:
+  std::array<MetricCounter, NumBuckets> buckets;
+  MetricCounter sum_ns;
+};
+
+/**
+ * The counters of an actor, updated by the thread that runs the actor.
+ * The messages used by ZAF itself, e.g., the notifications of SWSR queues, are counted as well.
+ **/
+struct ActorMetrics {
+  // the handlers of 1 in every `HandlerSamplingPeriod` messages are timed
+  inline constexpr static uint64_t HandlerSamplingPeriod = 16;
+
+  struct Stats {
+    ActorIdType actor_id = 0;
+    std::string name;
+    uint64_t messages_received = 0;
+    uint64_t messages_sent = 0;
+    uint64_t bytes_sent = 0;
+    uint64_t swsr_send_stalls = 0;
+    uint64_t swsr_reserved_bytes = 0;
+    // the number of messages in the mailbox, excluding those in SWSR queues
+    uint64_t mailbox_depth = 0;
+    LatencyHistogram::Stats handler_ns;
+  };
+
+  Stats get_stats() const;
+
+  // set when the actor is initialized, before the metrics are registered
+  ActorIdType actor_id = 0;
+  std::string name;
+  const Mailbox* mailbox = nullptr;
+
+  MetricCounter messages_received;
+  MetricCounter messages_sent;
+  // the bytes of the messages serialized for remote actors
+  MetricCounter bytes_sent;
+  // the number of messages sent by ActorBehaviorX that find the SWSR queue full
+  MetricCounter swsr_send_stalls;
+  // the bytes reserved by the SWSR queues that ActorBehaviorX receives from, set when it is idle
+  MetricCounter swsr_reserved_bytes;
+  LatencyHistogram handler_ns;
+};
+
+// Counts a message received by an actor, and times its handler if the message is sampled.
+class HandlerTimer {
+public:
+  explicit HandlerTimer(ActorMetrics* metrics) {
+    if constexpr (ENABLE_METRICS) {
+      metrics->messages_received.add();
+      if (metrics->messages_received.get() % ActorMetrics::HandlerSamplingPeriod == 0) {
+        this->metrics = metrics;
+        start = std::chrono::steady_clock::now();
+      }
+    }
+  }
+
+  HandlerTimer(const HandlerTimer&) = delete;
+  HandlerTimer& operator=(const HandlerTimer&) = delete;
+
+  ~HandlerTimer() {
+    if constexpr (ENABLE_METRICS) {
+      if (metrics) {
+        metrics->handler_ns.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start).count());
+      }
+    }
+  }
+
+private:
+  ActorMetrics* metrics = nullptr;
+  std::chrono::steady_clock::time_point start;
+};
+
+// The counters of an executor of ActorEngine, updated by the thread of the executor.
+struct ExecutorMetrics {
+  struct Stats {
+    std::string name;
+    size_t eid = 0;
+    // time spent in running actors (and in the executor itself)
+    uint64_t busy_ns = 0;
+    // time spent in waiting for actors to run, i.e., polling or parking
+    uint64_t idle_ns = 0;
+    // the number of times the executor is woken up to run actors
+    uint64_t wakeups = 0;
+    // the number of times the executor runs a batch of messages of an actor
+    uint64_t runs = 0;
+    // the number of actors pinned to the executor, always 0 under WorkStealing scheduling
+    uint64_t num_actors = 0;
+  };
+
+  Stats get_stats() const;
+
+  // adds the time since the last lap to `counter`
+  inline void lap(MetricCounter& counter) {
+    auto now = std::chrono::steady_clock::now();
+    counter.add(std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_lap).count());
+    last_lap = now;
+  }
+
+  std::string name;
+  size_t eid = 0;
+  std::chrono::steady_clock::time_point last_lap = std::chrono::steady_clock::now();
+
+  MetricCounter busy_ns;
+  MetricCounter idle_ns;
+  MetricCounter wakeups;
+  MetricCounter runs;
+  MetricCounter num_actors;
+};
+
+// The counters of one lane of NetGate to a peer, either the sending or the receiving side.
+struct NetLinkMetrics {
+  // why a Sender sends a batch
+  enum FlushReason : unsigned {
+    Size,        // the batch reaches `FlushPolicy::max_bytes`
+    Count,       // the batch reaches `FlushPolicy::max_messages`
+    Linger,      // the Sender has no more messages to consume and the linger expires
+    Termination, // the Sender terminates
+    NumFlushReasons
+  };
+
+  struct Stats {
+    std::string local_url;
+    std::string peer_url;
+    unsigned lane = 0;
+    bool is_sender = true;
+    uint64_t batches = 0;
+    uint64_t messages = 0;
+    // the bytes of the batches before compression
+    uint64_t raw_bytes = 0;
+    // the bytes of the batches sent or received by the socket, including the batch headers
+    uint64_t wire_bytes = 0;
+    // indexed by FlushReason, always 0 for a receiving side
+    std::array<uint64_t, NumFlushReasons> flushes{};
+  };
+
+  Stats get_stats() const;
+
+  std::string local_url;
+  std::string peer_url;
+  unsigned lane = 0;
+  bool is_sender = true;
+
+  MetricCounter batches;
+  MetricCounter messages;
+  MetricCounter raw_bytes;
+  MetricCounter wire_bytes;
+  std::array<MetricCounter, NumFlushReasons> flushes;
+};
+
+struct MetricsSnapshot {
+  // milliseconds since epoch
+  int64_t time_ms = 0;
+  // sorted by actor id
+  std::vector<ActorMetrics::Stats> actors;
+  std::vector<ExecutorMetrics::Stats> executors;
+  std::vector<NetLinkMetrics::Stats> net_links;
+  MessagePool::Stats message_pool;
+
+  // write the snapshot as a single line of JSON
+  void write_json(std::ostream& out) const;
+};
+
+/**
+ * Keeps the metrics of the alive actors, executors and NetGate links of an ActorSystem.
+ *
+ * Each metrics object is owned by the actor that updates it, and is registered when the
+ * actor is initialized and deregistered before the actor terminates. The counters are
+ * only read when a snapshot is taken, thus counting does not synchronize with any thread.
+ * The counts of the terminated actors are not kept.
+ *
+ * Nothing is registered if ZAF is built with ENABLE_METRICS=0.
+ **/
+class MetricsRegistry {
+public:
+  MetricsRegistry() = default;
+  MetricsRegistry(const MetricsRegistry&) = delete;
+  MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+  void add(const ActorMetrics* metrics);
+  void remove(const ActorMetrics* metrics);
+  void add(const ExecutorMetrics* metrics);
+  void remove(const ExecutorMetrics* metrics);
+  void add(const NetLinkMetrics* metrics);
+  void remove(const NetLinkMetrics* metrics);
+
+  MetricsSnapshot snapshot() const;
+
+  // append a snapshot to the file at `path` as a line of JSON every `period`,
+  // replacing the previous dump if any
+  void start_dump(const std::string& path, std::chrono::milliseconds period);
+  // append a last snapshot and stop the dump
+  void stop_dump();
+
+  ~MetricsRegistry();
+
+private:
+  mutable std::mutex mutex;
+  DefaultHashSet<const ActorMetrics*> actors;
+  DefaultHashSet<const ExecutorMetrics*> executors;
+  DefaultHashSet<const NetLinkMetrics*> net_links;
+
+  std::thread dump_thread;
+  std::mutex dump_mutex;
+  std::condition_variable dump_cv;
+  bool dump_stopped = false;
+};
+} // namespace zaf
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -8,6 +9,8 @@
 #include "actor.hpp"
 #include "actor_behavior_x.hpp"
 #include "actor_system.hpp"
+#include "compression.hpp"
+#include "metrics.hpp"
 #include "scoped_actor.hpp"
 
 namespace zaf {
@@ -19,6 +22,10 @@ namespace zaf {
  *
  * But this impl may also makes too many threads and sockets when there are too many machines.
  * Another impl is to use router socket in each thread in order to connect to multiple machines
+ *
+ * The comm with one machine can use multiple lanes, i.e., pairs of push and pull sockets,
+ * each with its own threads and TCP connection. Messages are striped across the lanes by
+ * the ids of the receiving actors, thus the messages to the same actor keep their order.
  **/
 class NetGate {
 public:
@@ -42,10 +49,53 @@ public:
   inline constexpr static Code NetGateBindPortReq    {NetGateCodeBase + 17};
   inline constexpr static Code NetGateBindPortRep    {NetGateCodeBase + 18};
 
+  /**
+   * When a Sender sends the messages it buffers for a peer as one batch.
+   * A batch is sent as soon as it reaches `max_bytes` or `max_messages`.
+   * Otherwise it is sent when the Sender has no more messages to consume and
+   * the first message in the batch has been buffered for at least `max_linger`.
+   * A zero `max_linger` sends the batch once the Sender has no more messages to consume.
+   **/
+  struct FlushPolicy {
+    size_t max_bytes = 1 << 20;
+    unsigned max_messages = 4096;
+    std::chrono::microseconds max_linger{0};
+  };
+
+  struct Options {
+    FlushPolicy flush_policy;
+    // the number of Senders (and Receivers) created for each peer
+    unsigned num_lanes = 1;
+    // The codec to compress batches with. A peer that cannot decompress the codec
+    // receives uncompressed batches, i.e., the codec is negotiated per connection.
+    Compression compression = Compression::None;
+    // batches with fewer bytes are not compressed
+    size_t min_compression_bytes = 1024;
+    // A Receiver drops the connection of a peer that sends a batch with more bytes (before
+    // decompression), so a corrupt or malicious batch header cannot make it allocate any size.
+    // Must be larger than the largest message as a batch may hold a message beyond `max_bytes`.
+    size_t max_batch_bytes = 256 << 20;
+  };
+
 private:
+  // the first frame of a batch sent from a Sender to a Receiver, followed by the bytes frame
+  // the fields are serialized one by one, i.e., neither the layout nor the padding is sent
+  struct BatchHeader {
+    unsigned num_messages;
+    // the codec that the bytes frame is compressed with
+    Compression compression;
+    // the number of bytes before compression
+    size_t num_raw_bytes;
+
+    // the size of the header frame
+    constexpr static size_t NumSerializedBytes =
+      sizeof(num_messages) + sizeof(compression) + sizeof(num_raw_bytes);
+  };
+
   class Receiver : public ActorBehaviorX {
   public:
-    Receiver(const std::string bind_host, const NetSenderInfo& net_sender_info);
+    Receiver(const std::string bind_host, const NetSenderInfo& net_sender_info, unsigned lane,
+      size_t max_batch_bytes);
 
     MessageHandlers behavior() override;
 
@@ -53,6 +103,8 @@ private:
 
     void launch() override;
 
+    bool is_blocking() const override;
+
     void initialize_recv_socket() override;
     void terminate_recv_socket() override;
 
@@ -60,30 +112,53 @@ private:
     const std::string bind_host;
     zmq::socket_t net_recv_socket;
     const NetSenderInfo& net_sender_info;
+    const size_t max_batch_bytes;
+    NetLinkMetrics link_metrics;
   };
 
   class Sender : public ActorBehaviorX {
   public:
+    Sender(const Options& options, const std::string& local_url, const std::string& peer_url,
+      unsigned lane);
+
     MessageHandlers behavior() override;
 
     void initialize_send_socket() override;
     void terminate_send_socket() override;
 
-    void push_to_buffer(MessageBytes& content);
-    void flush_byte_buffer();
+    void push_to_buffer(MessageBytes& m);
+    void flush_byte_buffer(NetLinkMetrics::FlushReason reason);
+    // return the number of bytes sent after compression,
+    // or 0 if the buffer is not compressed and thus should be sent as it is
+    size_t send_compressed_buffer(BatchHeader& header);
+    void send_batch_header(const BatchHeader& header);
+    // whether the first buffered message has been buffered for `max_linger`
+    bool is_linger_expired() const;
     void post_swsr_consumption() override;
 
     std::string get_name() const override;
 
+    // keeps a dedicated thread for its zmq socket
+    bool is_blocking() const override;
+
   protected:
+    const FlushPolicy flush_policy;
+    const size_t min_compression_bytes;
+    // negotiated with the peer when connecting
+    Compression compression = Compression::None;
     std::vector<char> byte_buffer;
+    // reused by the batches, zmq copies the compressed bytes out of it
+    std::vector<char> compression_buffer;
+    std::vector<char> header_bytes;
     unsigned num_buffered_messages = 0;
+    std::chrono::steady_clock::time_point first_buffered_time;
 
     std::string connected_url;
     zmq::socket_t net_send_socket;
     bool forward_any_message = true;
 
     std::vector<MessageBytes> pending_messages;
+    NetLinkMetrics link_metrics;
   };
 
   /**
@@ -95,7 +170,7 @@ private:
    **/
   class NetGateActor : public ActorBehaviorX {
   public:
-    NetGateActor(const std::string& host, int port);
+    NetGateActor(const std::string& host, int port, const Options& options);
 
     MessageHandlers behavior() override;
 
@@ -107,6 +182,7 @@ private:
     void send_to_net_gate(const std::string& ng_url, size_t msg_code, ArgT&& ... args) {
       const size_t type_hash = hash_combine(typeid(std::decay_t<ArgT>).hash_code() ...);
       std::vector<char> bytes;
+      bytes.reserve(sizeof(msg_code) + sizeof(type_hash) + (size_t(0) + ... + serialized_size(args)));
       Serializer(bytes)
         .write(msg_code)
         .write(type_hash)
@@ -126,6 +202,7 @@ private:
     void imme_send_to_net_gate(const std::string& ng_url, size_t msg_code, ArgT&& ... args) {
       const size_t type_hash = hash_combine(typeid(std::decay_t<ArgT>).hash_code() ...);
       std::vector<char> bytes;
+      bytes.reserve(sizeof(msg_code) + sizeof(type_hash) + (size_t(0) + ... + serialized_size(args)));
       Serializer(bytes)
         .write(msg_code)
         .write(type_hash)
@@ -142,6 +219,8 @@ private:
 
     void launch() override;
 
+    bool is_blocking() const override;
+
     void initialize_send_socket() override;
     void terminate_send_socket() override;
 
@@ -149,8 +228,9 @@ private:
     void terminate_recv_socket() override;
 
     struct NetGateConn {
-      Actor sender;
-      Actor receiver;
+      // one Sender and one Receiver for each lane
+      std::vector<Actor> senders;
+      std::vector<Actor> receivers;
       NetSenderInfo net_sender_info;
       // whether `pong` message is received, i.e., whether the connection is well established.
       bool is_ponged = false;
@@ -185,13 +265,23 @@ private:
     std::string bind_host;
     int bind_port = 0;
     std::string bind_url; // which is bind_host:bind_port
+    const Options options;
   };
 
 public:
   NetGate() = default;
   NetGate(ActorSystem& actor_sys, const std::string& bind_host, int port);
+  NetGate(ActorSystem& actor_sys, const std::string& bind_host, int port,
+    const Options& options);
+  // `num_lanes` is the number of Senders (and Receivers) created for each peer
+  NetGate(ActorSystem& actor_sys, const std::string& bind_host, int port,
+    const FlushPolicy& flush_policy, unsigned num_lanes = 1);
 
   void initialize(ActorSystem& actor_sys, const std::string& bind_host, int port);
+  void initialize(ActorSystem& actor_sys, const std::string& bind_host, int port,
+    const Options& options);
+  void initialize(ActorSystem& actor_sys, const std::string& bind_host, int port,
+    const FlushPolicy& flush_policy, unsigned num_lanes = 1);
   void terminate();
 
   const Actor& actor() const;
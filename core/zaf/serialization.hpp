@@ -1,13 +1,16 @@
 // To be included inside serializer.hpp
 
+#include <algorithm>
 #include <optional>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <type_traits>
 
 #include "actor.hpp"
 #include "count_pointer.hpp"
+#include "views.hpp"
 #include "zaf_exception.hpp"
 
 namespace zaf {
@@ -120,26 +123,45 @@ T deserialize(Deserializer& s) {
 // 3. Serialization for iterable, i.e., containers 
 template<typename Iterable,
   std::enable_if_t<!std::is_pod_v<traits::remove_cvref_t<Iterable>>>* = nullptr,
+  std::enable_if_t<!traits::is_view<Iterable>::value>* = nullptr,
   std::enable_if_t<traits::is_iterable<Iterable>::value>* = nullptr,
   typename E = traits::remove_cvref_t<decltype(*std::declval<Iterable&>().begin())>,
   std::enable_if_t<traits::is_savable<E>::value>* = nullptr>
 void serialize(Serializer& s, Iterable&& i) {
   serialize(s, size_t(i.size()));
-  for (auto&& x : i) {
-    serialize(s, x);
+  if constexpr (traits::is_pod_vector<traits::remove_cvref_t<Iterable>>::value) {
+    // the same bytes as serializing the elements one by one
+    s.write_bytes(reinterpret_cast<const char*>(i.data()), i.size() * sizeof(E));
+  } else {
+    for (auto&& x : i) {
+      serialize(s, x);
+    }
   }
 }
 
 template<typename Iterable,
   std::enable_if_t<!std::is_const_v<Iterable>>* = nullptr,
   std::enable_if_t<!std::is_pod_v<traits::remove_cvref_t<Iterable>>>* = nullptr,
+  std::enable_if_t<!traits::is_view<Iterable>::value>* = nullptr,
   std::enable_if_t<traits::is_iterable<Iterable>::value>* = nullptr,
   typename E = traits::remove_cvref_t<decltype(*std::declval<Iterable&>().begin())>,
   std::enable_if_t<traits::is_loadable<E>::value>* = nullptr>
 void deserialize(Deserializer& s, Iterable& it) {
   auto size = deserialize<size_t>(s);
+  if constexpr (traits::is_pod_vector<Iterable>::value) {
+    // check before resizing so that a corrupt size does not allocate
+    if (size > s.remaining() / sizeof(E)) {
+      throw ZAFException("Attempt to read ", size, " elements of ", sizeof(E),
+        " bytes while only ", s.remaining(), " bytes are left in Deserializer.");
+    }
+    auto prev_size = it.size();
+    it.resize(prev_size + size);
+    s.read_bytes(it.data() + prev_size, size * sizeof(E));
+    return;
+  }
   if constexpr (traits::has_reserve<Iterable>::value) {
-    it.reserve(size);
+    // each element takes at least one byte unless it is empty
+    it.reserve(it.size() + std::min(size, s.remaining()));
   }
   for (size_t i = 0; i < size; i++) {
     if constexpr (traits::has_emplace_back<Iterable, E>::value) {
@@ -179,11 +201,52 @@ inline void serialize(Serializer& s, const std::string& str) {
 }
 
 inline void deserialize(Deserializer& s, std::string& str) {
-  str.resize(s.read<size_t>());
-  s.read_bytes(str.data(), str.size());
+  auto size = s.read<size_t>();
+  auto view = s.read_view(size);
+  str.assign(view, size);
+}
+
+// 6. Serialization for views, which are written as the viewed types
+// and are read without copying the bytes, see views.hpp
+inline void serialize(Serializer& s, std::string_view str) {
+  s.write_pod(size_t(str.size()));
+  s.write_bytes(str.data(), str.size());
+}
+
+inline void deserialize(Deserializer& s, std::string_view& str) {
+  auto size = s.read<size_t>();
+  str = std::string_view(s.read_view(size), size);
+}
+
+inline void serialize(Serializer& s, const BytesView& bytes) {
+  s.write_pod(size_t(bytes.size()));
+  s.write_bytes(bytes.data(), bytes.size());
+}
+
+inline void deserialize(Deserializer& s, BytesView& bytes) {
+  auto size = s.read<size_t>();
+  bytes = BytesView(s.read_view(size), size);
 }
 
-// 6. Serialization for std::optional
+template<typename T>
+void serialize(Serializer& s, const span<const T>& v) {
+  // the same as the elements are written one by one
+  s.write_pod(size_t(v.size()));
+  s.write_bytes(v.data_bytes(), v.size() * sizeof(T));
+}
+
+template<typename T>
+void deserialize(Deserializer& s, span<const T>& v) {
+  auto size = s.read<size_t>();
+  // checked before `size * sizeof(T)`, which may overflow for a corrupt size
+  if (size > s.remaining() / sizeof(T)) {
+    throw ZAFException("Attempt to read a span of ", size, " elements of ", sizeof(T),
+      " bytes while only ", s.remaining(), " bytes are left in Deserializer.");
+  }
+  v = span<const T>(s.read_view(size * sizeof(T)), size);
+}
+
+// 7. Serialization for std::optional
 template<typename T,
   std::enable_if_t<
     !std::is_reference_v<T> &&
@@ -290,6 +353,41 @@ void deserialize(Deserializer& s, std::tuple<ArgT ...>& t, std::index_sequence<I
   s.read(std::get<I>(t) ...);
 }
 
+// 8. The number of bytes to serialize a value, used to reserve the buffer before serializing.
+// It is exact for PODs, strings, views, containers, pairs and tuples of them,
+// and a lower bound otherwise, e.g., 0 for types with user-defined serialization.
+template<typename T>
+size_t serialized_size(const T& t) {
+  using RAW = traits::remove_cvref_t<T>;
+  if constexpr (std::is_pod_v<RAW> && !std::is_pointer_v<RAW>) {
+    return sizeof(RAW);
+  } else if constexpr (std::is_same_v<RAW, std::string> || std::is_same_v<RAW, std::string_view> ||
+                       std::is_same_v<RAW, BytesView>) {
+    return sizeof(size_t) + t.size();
+  } else if constexpr (traits::is_pod_vector<RAW>::value) {
+    return sizeof(size_t) + t.size() * sizeof(typename RAW::value_type);
+  } else if constexpr (traits::is_view<RAW>::value) {
+    // zaf::span
+    return sizeof(size_t) + t.size() * sizeof(decltype(t[0]));
+  } else if constexpr (traits::is_pair<RAW>::value) {
+    return serialized_size(t.first) + serialized_size(t.second);
+  } else if constexpr (traits::is_tuple<RAW>::value) {
+    return std::apply([](const auto& ... x) {
+      return (size_t(0) + ... + serialized_size(x));
+    }, t);
+  } else if constexpr (std::is_pointer_v<RAW>) {
+    return serialized_size(*t);
+  } else if constexpr (traits::is_iterable<RAW>::value) {
+    size_t size = sizeof(size_t);
+    for (auto&& x : t) {
+      size += serialized_size(x);
+    }
+    return size;
+  } else {
+    return 0;
+  }
+}
+
 void serialize(Serializer& s, const LocalActorHandle& l);
 void deserialize(Deserializer& s, LocalActorHandle& l);
 
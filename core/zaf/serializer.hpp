@@ -26,6 +26,9 @@ public:
   template<typename T, typename ... Ts>
   Serializer& write(T&& t, Ts&& ... ts);
 
+  // reserve the space for another n bytes after the end of the bytes
+  void reserve(size_t n);
+
   void move_write_ptr_to(size_t ptr);
   void move_write_ptr_to_end();
 
@@ -38,12 +41,15 @@ private:
   size_t wptr;
 };
 
+// Reads the bytes written by Serializer.
+// Reading beyond the end of the bytes throws ZAFException, e.g., when the bytes are corrupt.
 class Deserializer {
 public:
-  Deserializer(const char* offset);
+  Deserializer(const char* begin, size_t size);
   Deserializer(const std::vector<char>&);
 
   inline void read_bytes(void* b, size_t n) {
+    check_remaining(n);
     std::memcpy(b, offset, n);
     offset += n;
   }
@@ -53,6 +59,25 @@ public:
     read_bytes(&x, sizeof(x));
   }
 
+  // skip the next n bytes and return their address, used to read views without copying
+  inline const char* read_view(size_t n) {
+    check_remaining(n);
+    auto view = offset;
+    offset += n;
+    return view;
+  }
+
+  // the number of bytes that are not read yet
+  inline size_t remaining() const {
+    return end - offset;
+  }
+
+  inline void check_remaining(size_t n) const {
+    if (n > remaining()) {
+      throw_out_of_range(n);
+    }
+  }
+
   template<typename T>
   T read();
 
@@ -65,7 +90,10 @@ public:
   Deserializer& read(T& t, Ts&& ... ts);
 
 private:
+  [[noreturn]] void throw_out_of_range(size_t n) const;
+
   const char* offset;
+  const char* end;
 };
 
 namespace traits {
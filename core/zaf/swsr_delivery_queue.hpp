@@ -1,19 +1,24 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <functional>
 #include <iostream>
+#include <memory>
 #include <thread>
 #include <type_traits>
 #include <vector>
 
+#include "zaf/swsr_ready_list.hpp"
+#include "zaf/thread_utils.hpp"
 #include "zaf/zaf_exception.hpp"
 
 namespace zaf {
 enum SWSRDeliveryQueueFullStrategy {
   Blocking,
-  // Resize is only available for sending message to self
-  // unless the buffer can be resized with thread-safety guarantee
+  // grow the capacity, which is safe with a concurrent reader as the queue grows by linking
+  // segments instead of moving the items
   Resize,
   // give up the message if the queue is full
   Giveup,
@@ -27,25 +32,62 @@ enum SWSRDeliveryQueueFullStrategy {
  * 4. reader needs to see the latest write_idx, otherwise reader will read nothing from the queue
  *    while the writer may not notify reader in future if the writer is blocked for writing.
  * 5. write_progress and read_progress (i.e., may_have_message flag) needs to be up-to-date to both writer and reader
- */
+ * 6. the state written by the writer, the state written by the reader and `may_have_message` are on
+ *    separate cache lines. Each side keeps a copy of the index of the other side and reloads it only
+ *    when the queue looks full (for the writer) or empty (for the reader).
+ * 7. `push_n` publishes the index once per batch instead of once per item. `pop_some` publishes the
+ *    index every `read_publish_interval` items, and at once if the writer is parked, so that a long
+ *    batch does not keep a Blocking writer waiting until the batch ends. The reader issues the fence
+ *    that pairs with the parking writer once per batch, and checks `writer_parked` with a relaxed
+ *    load in between.
+ * 8. With Blocking, a writer that finds the queue full spins for a while, then yields for a while,
+ *    and then parks on a futex until the reader leaves no more than `low_water_mark` items.
+ *    With Giveup, a writer that cannot wait in its thread calls `wait_for_room` instead, and the
+ *    reader calls `on_room` once it leaves no more than `low_water_mark` items or stops reading.
+ * 9. The items are stored in a list of fixed-size segments. The writer links a new segment when it
+ *    reaches the end of the last one, and the reader recycles a segment once it reads past it,
+ *    keeping one spare segment for the writer and freeing the others. Thus the capacity only bounds
+ *    the number of items in the queue, and the memory follows the items actually in the queue.
+ **/
 template<typename Item>
 class SWSRDeliveryQueue {
 private:
+  static constexpr size_t CacheLineSize = 64;
+  // the max number of items in a segment
+  static constexpr unsigned MaxSegmentSize = 256;
+
+  struct Segment {
+    Segment(unsigned n): items(n) {}
+
+    std::vector<Item> items;
+    // the segment after this one, set by the writer before it publishes any item in the next segment
+    Segment* next = nullptr;
+  };
+
   // atomic should be used because `write_idx`, `read_idx` and `may_have_message`
   // are accessed by two threads and the writes on them by one thread must be
   // visible to the other thread. Note: volatile does not help.
-  // items[write_idx & bit_mask] is the one that can be used to write the next item in case the queue is not full
-  // items[read_idx & bit_mask] is the one that can be read in case the queue is not empty
-  std::atomic<unsigned> write_idx{0};
-  std::atomic<unsigned> read_idx{0};
-  std::atomic<bool> may_have_message{false};
-  // `cap` must be 2 to a power of x
-  unsigned cap = 0;
-  // `bit_mask` must be `cap - 1`
-  unsigned bit_mask = 0;
-  // the buffer with len `cap`
-  std::vector<Item> items;
-
+  // write_seg->items[write_idx & seg_mask] is the one that can be used to write the next item in case the queue is not full
+  // read_seg->items[read_idx & seg_mask] is the one that can be read in case the queue is not empty
+
+  // written by the writer
+  alignas(CacheLineSize) std::atomic<unsigned> write_idx{0};
+  // the copy of `read_idx` by the writer, which is never ahead of `read_idx`
+  unsigned cached_read_idx = 0;
+  // the last segment and the index right after it
+  Segment* write_seg = nullptr;
+  unsigned write_seg_end = 0;
+  // the number of pushes that find the queue full, and the number of times the writer parks
+  std::atomic<uint64_t> num_stalls{0};
+  std::atomic<uint64_t> num_parks{0};
+
+  // written by the reader
+  alignas(CacheLineSize) std::atomic<unsigned> read_idx{0};
+  // the copy of `write_idx` by the reader, which is never ahead of `write_idx`
+  unsigned cached_write_idx = 0;
+  // the first segment and the index right after it
+  Segment* read_seg = nullptr;
+  unsigned read_seg_end = 0;
   // used to break pop_some
   bool flag_stop_pop_some = false;
 
@@ -53,45 +95,102 @@ public:
   // only accessed by the reader
   // when `num_empty_read` equals to `max_empty_read`, reader changes `may_have_message` to false
   unsigned num_empty_read = 0;
-  // updated by the writer
-  bool is_writing_by_sender = true;
+
+private:
+  // written by both
+  alignas(CacheLineSize) std::atomic<bool> may_have_message{false};
+  // 1 if the writer is parked or about to park for a full queue, 2 if it waits for `on_room`
+  std::atomic<uint32_t> writer_parked{0};
+  // the segment recycled by the reader for the writer to reuse
+  std::atomic<Segment*> spare{nullptr};
+  // the number of segments allocated, including `spare`
+  std::atomic<unsigned> num_segments{0};
+
+  // only changed by the writer after `resize`
+  alignas(CacheLineSize) std::atomic<unsigned> cap{0};
+  // `seg_size` must be 2 to a power of x and no more than `cap` when the queue is resized at first
+  // `seg_mask` must be `seg_size - 1`
+  unsigned seg_size = 0;
+  unsigned seg_mask = 0;
+
+public:
+  // updated by the writer with release after its last push, and loaded by the reader with acquire
+  // before it checks whether the queue is empty
+  std::atomic<bool> is_writing_by_sender{true};
+  // updated by the reader by `stop_reading`
+  std::atomic<bool> is_reading_by_receiver{true};
+  // set and called by the reader to wake up the writer that waits by `wait_for_room`
+  std::function<void()> on_room = nullptr;
+
+  // The ready list of the reader, into which the writer puts the queue when `inc_write_progress`
+  // returns true. Set by the reader once, and the writer notifies the reader in other ways before
+  // it is set. `ready_list_holder` keeps the list alive for the writer.
+  std::atomic<SWSRReadyList<SWSRDeliveryQueue>*> ready_list{nullptr};
+  std::shared_ptr<SWSRReadyList<SWSRDeliveryQueue>> ready_list_holder;
+  // the link in the ready list
+  SWSRDeliveryQueue* next_ready = nullptr;
 
   // configurations
   unsigned max_messages_read = 100;
   unsigned max_empty_read = 100;
+  // the backpressure of Blocking when the queue is full, see 8 above
+  unsigned full_spin_count = 128;
+  unsigned full_yield_count = 16;
+  // 0 means half of the capacity
+  unsigned low_water_mark = 0;
+  // the number of items read by `pop_some` between two publishes of the read index, see 7 above
+  unsigned read_publish_interval = 32;
 
   std::function<void()> destructor = nullptr;
 
   SWSRDeliveryQueue() = default;
 
   SWSRDeliveryQueue(SWSRDeliveryQueue<Item>&& other) {
-    this->write_idx.store(other.write_index());
-    this->read_idx.store(other.read_index());
-    this->may_have_message.store(other.may_have_message.load());
-    this->cap = other.cap;
-    this->bit_mask = other.bit_mask;
-    this->items = std::move(other.items);
-    other.clear();
+    *this = std::move(other);
   }
 
   SWSRDeliveryQueue& operator=(SWSRDeliveryQueue<Item>&& other) {
+    this->clear();
     this->write_idx.store(other.write_index());
     this->read_idx.store(other.read_index());
+    this->cached_read_idx = this->read_idx.load(std::memory_order_relaxed);
+    this->cached_write_idx = this->write_idx.load(std::memory_order_relaxed);
     this->may_have_message.store(other.may_have_message.load());
-    this->cap = other.cap;
-    this->bit_mask = other.bit_mask;
-    this->items = other.items;
+    this->cap.store(other.capacity(), std::memory_order_relaxed);
+    this->seg_size = other.seg_size;
+    this->seg_mask = other.seg_mask;
+    this->write_seg = other.write_seg;
+    this->write_seg_end = other.write_seg_end;
+    this->read_seg = other.read_seg;
+    this->read_seg_end = other.read_seg_end;
+    this->spare.store(other.spare.exchange(nullptr));
+    this->num_segments.store(other.num_segments.load());
+    // the segments now belong to this queue
+    other.write_seg = other.read_seg = nullptr;
+    other.num_segments.store(0);
     other.clear();
     return *this;
   }
 
+  // free all the segments, the queue needs to `resize` before use
   void clear() {
     this->write_idx.store(0, std::memory_order_release);
     this->read_idx.store(0, std::memory_order_release);
+    this->cached_read_idx = 0;
+    this->cached_write_idx = 0;
     this->may_have_message.store(false, std::memory_order_release);
-    this->cap = 0;
-    this->bit_mask = 0;
-    this->items.clear();
+    this->cap.store(0, std::memory_order_relaxed);
+    for (auto seg = read_seg; seg != nullptr;) {
+      auto next = seg->next;
+      delete seg;
+      seg = next;
+    }
+    delete spare.exchange(nullptr);
+    this->read_seg = this->write_seg = nullptr;
+    this->read_seg_end = this->write_seg_end = 0;
+    this->seg_size = 0;
+    this->seg_mask = 0;
+    this->num_segments.store(0, std::memory_order_relaxed);
   }
 
   constexpr static unsigned max_empty_read_timespan_ms() {
@@ -102,22 +201,32 @@ public:
   // mark that the writer has somehow notified the reader one more time
   // only writer can call
   inline bool inc_write_progress() {
-    return !may_have_message.exchange(true, std::memory_order_acq_rel);
+    // pairs with the store in `inc_read_progress`, such that either the reader sees the items
+    // pushed before or the writer sees `may_have_message` being false and notifies the reader
+    return !may_have_message.exchange(true, std::memory_order_seq_cst);
   }
 
   // mark that the reader get notified one more time
   // only reader can call
   inline void inc_read_progress() {
-    may_have_message.store(false, std::memory_order_acq_rel);
+    may_have_message.store(false, std::memory_order_seq_cst);
+  }
+
+  // called by the reader after `inc_read_progress` if the queue is not empty
+  // return true if the reader keeps reading the queue, or false if the writer has seen the reset
+  // and thus notifies the reader again
+  // only reader can call
+  inline bool keep_read_progress() {
+    return !may_have_message.exchange(true, std::memory_order_seq_cst);
   }
 
   inline bool can_read() const {
-    return may_have_message.load(std::memory_order_acq_rel);
+    return may_have_message.load(std::memory_order_acquire);
   }
 
   // whether the queue is too full that writer cannot push anything
   inline bool full() const {
-    return write_index() - read_index() == cap;
+    return write_index() - read_index() == capacity();
   }
 
   // whether the reader can get anything from the queue
@@ -139,70 +248,69 @@ public:
   }
 
   // set the capacity of the queue to 2^scale
+  // the first call allocates the first segment, so it must be called before the queue is shared
   inline void resize(unsigned scale) {
-    this->cap = 1u << scale;
-    items.resize(this->cap);
-    bit_mask = cap - 1;
+    this->cap.store(1u << scale, std::memory_order_relaxed);
+    if (write_seg == nullptr) {
+      seg_size = std::min(1u << scale, MaxSegmentSize);
+      seg_mask = seg_size - 1;
+      write_seg = read_seg = new Segment(seg_size);
+      num_segments.store(1, std::memory_order_relaxed);
+      // the segment covers the current indices
+      auto w = write_idx.load(std::memory_order_relaxed);
+      write_seg_end = read_seg_end = (w & ~seg_mask) + seg_size;
+    }
   }
 
   inline unsigned capacity() const {
-    return cap;
+    return cap.load(std::memory_order_relaxed);
+  }
+
+  // the bytes of the segments allocated by the queue
+  inline size_t reserved_bytes() const {
+    return size_t(num_segments.load(std::memory_order_relaxed)) *
+      (sizeof(Segment) + sizeof(Item) * seg_size);
   }
 
   // writer push an item
   // only writer can call
   template<typename U>
   inline bool push(U&& elem, SWSRDeliveryQueueFullStrategy s = Blocking) {
-    auto w = write_index();
-    if (w - cap == read_index()) {
-      // the queue is full
-      switch (s) {
-        case Blocking: {
-          // for sending messages to others
-          while (w - cap == read_index()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-          }
-          break;
-        }
-        // Note(zzxx):
-        // To use Resize in two-thread-context:
-        // 1. change std::vector to std::deque, such that reading std::deque remains valid while resizing
-        // 2. change std::move to std::copy such that reader either reads old or new data, depending on whether the reader gets the old bit_mask or the new one
-        // 3. the content stored in the queue should be trivally copyable, e.g., pointer
-        case Resize: {
-          // for sending messages to self
-          items.resize(this->cap << 1);
-          std::move(items.begin(), items.begin() + (w & bit_mask), items.begin() + this->cap);
-          this->cap <<= 1;
-          this->bit_mask = this->cap - 1;
-          break;
-        }
-        case Giveup: {
-          return false;
-        }
-        default: {
-          throw ZAFException("Unknown SWSRDeliveryQueueFullStrategy: ", s);
-        }
-      }
+    auto w = write_idx.load(std::memory_order_relaxed);
+    if (w - cached_read_idx == capacity() && !make_room(w, s)) {
+      return false;
     }
-    items[w & bit_mask] = std::forward<U>(elem);
-    write_idx.fetch_add(1, std::memory_order_release);
+    writer_slot(w) = std::forward<U>(elem);
+    write_idx.store(w + 1, std::memory_order_release);
     return true;
   }
 
+  // writer push `n` items starting from `first`, and publish them at once
+  // return the number of items pushed, which is less than `n` only if `s` is Giveup
+  // only writer can call
+  template<typename InputIt>
+  inline unsigned push_n(InputIt first, unsigned n, SWSRDeliveryQueueFullStrategy s = Blocking) {
+    return push_n(first, n, []() {}, s);
+  }
+
   // Note: ensure the queue is NOT empty()
   // only reader can call
   inline Item& top() {
-    return items[read_index(std::memory_order_relaxed) & bit_mask];
+    return reader_slot(read_idx.load(std::memory_order_relaxed));
   }
 
   // Note: ensure the queue is NOT empty()
   // only reader can call
   template<typename PopHandler>
   inline void pop_one(PopHandler&& handler) {
-    auto& item = top();
-    handler(item);
-    read_idx.fetch_add(1, std::memory_order_release);
+    auto r = read_idx.load(std::memory_order_relaxed);
+    if (cached_write_idx == r) {
+      // the item exists, so `cached_write_idx` stays not ahead of `write_idx`
+      cached_write_idx = r + 1;
+    }
+    handler(reader_slot(r));
+    read_idx.store(r + 1, std::memory_order_release);
+    wake_writer(r + 1);
   }
 
   // Note: ensure the queue is NOT empty()
@@ -224,18 +332,78 @@ public:
     return false;
   }
 
+  // The reader is notified once for the batch, and also before the writer waits for a full queue
+  template<typename InputIt, typename Notifier,
+    std::enable_if_t<std::is_invocable_v<Notifier>>* = nullptr>
+  inline unsigned push_n(InputIt first, unsigned n, Notifier notify_reader,
+    SWSRDeliveryQueueFullStrategy s = Blocking) {
+    auto w = write_idx.load(std::memory_order_relaxed);
+    unsigned num_pushed = 0;
+    auto publish = [&]() {
+      write_idx.store(w, std::memory_order_release);
+      if (inc_write_progress()) {
+        notify_reader();
+      }
+    };
+    while (num_pushed < n) {
+      if (w - cached_read_idx == capacity()) {
+        cached_read_idx = read_idx.load(std::memory_order_acquire);
+        if (w - cached_read_idx == capacity()) {
+          if (num_pushed != 0) {
+            // let the reader consume the items pushed so far
+            publish();
+          }
+          if (!make_room(w, s)) {
+            return num_pushed;
+          }
+        }
+      }
+      auto k = std::min(capacity() - (w - cached_read_idx), n - num_pushed);
+      for (unsigned i = 0; i < k; i++, ++first) {
+        writer_slot(w++) = *first;
+      }
+      num_pushed += k;
+    }
+    if (num_pushed != 0) {
+      publish();
+    }
+    return num_pushed;
+  }
+
   // Read some messages that are immediately available in the queue.
   // The number of messages to be read will be no more than `max_messages_read`.
   // Return: the number of messages that have been read
   template<typename PopHandler>
   inline unsigned pop_some(PopHandler&& handler, unsigned max_messages_read) {
-    auto w = write_index();
-    auto r = read_index(std::memory_order_relaxed);
+    auto r = read_idx.load(std::memory_order_relaxed);
+    if (r == cached_write_idx) {
+      cached_write_idx = write_idx.load(std::memory_order_acquire);
+    }
+    auto n = std::min(cached_write_idx - r, max_messages_read);
     flag_stop_pop_some = false;
     unsigned num_read = 0;
-    for (; r != w && !flag_stop_pop_some && num_read < max_messages_read; num_read++, r++) {
-      // update `read_idx` for each message so that the writer can find available slot when the slot becomes empty
-      pop_one(handler);
+    unsigned num_unpublished = 0;
+    while (num_read < n && !flag_stop_pop_some) {
+      // the handler may link new segments by pushing to self, which leaves `read_seg` valid
+      handler(reader_slot(r++));
+      num_read++;
+      // free the slots for the writer in the middle of the batch, and wake it up only if it looks parked
+      if (++num_unpublished >= read_publish_interval) {
+        read_idx.store(r, std::memory_order_release);
+        num_unpublished = 0;
+      }
+      if (writer_parked.load(std::memory_order_relaxed) != 0) {
+        read_idx.store(r, std::memory_order_release);
+        num_unpublished = 0;
+        wake_parked_writer(r);
+      }
+    }
+    // one fenced check for the batch, which catches a writer that parks after the relaxed checks above
+    if (num_read != 0) {
+      if (num_unpublished != 0) {
+        read_idx.store(r, std::memory_order_release);
+      }
+      wake_writer(r);
     }
     return num_read;
   }
@@ -265,29 +433,184 @@ public:
 
   template<typename PopHandler, typename OnReachMaxEmptyRead>
   inline void pop_some(PopHandler&& handler, OnReachMaxEmptyRead&& on_reach_max_empty_read) {
-    this->pop_some(std::forward<PopHandler>(handler), std::forward<OnReachMaxEmptyRead>(on_reach_max_empty_read), this->max_empty_read);
+    this->pop_some(std::forward<PopHandler>(handler), std::forward<OnReachMaxEmptyRead>(on_reach_max_empty_read), this->max_messages_read);
+  }
+
+  // the number of pushes with Blocking that find the queue full
+  uint64_t get_num_stalls() const {
+    return num_stalls.load(std::memory_order_relaxed);
+  }
+
+  // the number of times the writer parks for a full queue
+  uint64_t get_num_parks() const {
+    return num_parks.load(std::memory_order_relaxed);
   }
 
   void stop_pop_some() {
     this->flag_stop_pop_some = true;
   }
 
+  // With Giveup, the writer that finds the queue full calls it to be woken up by `on_room` once the
+  // reader makes room. Return false if the queue is not full any more or the reader stops reading,
+  // in which case `on_room` may still be called.
+  // only writer can call
+  inline bool wait_for_room() {
+    writer_parked.store(2, std::memory_order_relaxed);
+    // pairs with the fences in `wake_writer` and `stop_reading`
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    cached_read_idx = read_idx.load(std::memory_order_acquire);
+    if (write_idx.load(std::memory_order_relaxed) - cached_read_idx == capacity() &&
+        is_reading_by_receiver.load(std::memory_order_relaxed)) {
+      return true;
+    }
+    writer_parked.store(0, std::memory_order_relaxed);
+    return false;
+  }
+
+  // called by the reader that will not read the queue any more, which wakes up the writer
+  // waiting by `wait_for_room`
+  inline void stop_reading() {
+    is_reading_by_receiver.store(false, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint32_t waiting = 2;
+    if (writer_parked.compare_exchange_strong(waiting, 0, std::memory_order_relaxed) && on_room) {
+      on_room();
+    }
+  }
+
   ~SWSRDeliveryQueue() {
     if (destructor) {
       destructor();
     }
+    clear();
   }
 
   friend std::ostream& operator<<(std::ostream& out, const SWSRDeliveryQueue<Item>& item) {
     out << "SWSRDeliveryQueue{"
         << &item
         << ", size: " << item.size()
-        << ", write idx: " << (item.write_index() & item.bit_mask)
-        << ", read idx: " << (item.read_index() & item.bit_mask)
+        << ", capacity: " << item.capacity()
+        << ", reserved bytes: " << item.reserved_bytes()
+        << ", write idx: " << item.write_index()
+        << ", read idx: " << item.read_index()
         << ", empty read: " << item.num_empty_read
         << ", can read: " << item.can_read()
         << "}";
     return out;
   }
+
+private:
+  // the slot to write the item of index `w`
+  // only writer can call
+  inline Item& writer_slot(unsigned w) {
+    if (w == write_seg_end) {
+      // take the segment recycled by the reader if any
+      auto seg = spare.exchange(nullptr, std::memory_order_acquire);
+      if (seg == nullptr) {
+        seg = new Segment(seg_size);
+        num_segments.fetch_add(1, std::memory_order_relaxed);
+      }
+      seg->next = nullptr;
+      // the reader follows the link only after it sees the items in the new segment
+      write_seg->next = seg;
+      write_seg = seg;
+      write_seg_end += seg_size;
+    }
+    return write_seg->items[w & seg_mask];
+  }
+
+  // the slot to read the item of index `r`, which is in the queue
+  // only reader can call
+  inline Item& reader_slot(unsigned r) {
+    if (r == read_seg_end) {
+      // the writer has moved to the next segment as the item `r` is in the queue
+      auto seg = read_seg;
+      read_seg = seg->next;
+      read_seg_end += seg_size;
+      // keep one segment for the writer and free the others, which shrinks an idle queue
+      if (auto old = spare.exchange(seg, std::memory_order_acq_rel)) {
+        delete old;
+        num_segments.fetch_sub(1, std::memory_order_relaxed);
+      }
+    }
+    return read_seg->items[r & seg_mask];
+  }
+
+  // called by the writer when the queue looks full with `w` being the write index,
+  // return false if the item cannot be pushed
+  bool make_room(unsigned w, SWSRDeliveryQueueFullStrategy s) {
+    cached_read_idx = read_idx.load(std::memory_order_acquire);
+    if (w - cached_read_idx != capacity()) {
+      return true;
+    }
+    switch (s) {
+      case Blocking: {
+        // for sending messages to others
+        num_stalls.store(num_stalls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        auto is_full = [&]() {
+          cached_read_idx = read_idx.load(std::memory_order_acquire);
+          return w - cached_read_idx == capacity();
+        };
+        for (unsigned i = 0; i < full_spin_count; i++) {
+          thread::cpu_relax();
+          if (!is_full()) {
+            return true;
+          }
+        }
+        for (unsigned i = 0; i < full_yield_count; i++) {
+          std::this_thread::yield();
+          if (!is_full()) {
+            return true;
+          }
+        }
+        num_parks.store(num_parks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        while (true) {
+          writer_parked.store(1, std::memory_order_relaxed);
+          // pairs with the fence in `wake_writer`, such that either the writer sees the space
+          // freed by the reader or the reader sees `writer_parked`
+          std::atomic_thread_fence(std::memory_order_seq_cst);
+          if (!is_full()) {
+            writer_parked.store(0, std::memory_order_relaxed);
+            return true;
+          }
+          thread::futex_wait(writer_parked, 1);
+        }
+      }
+      case Resize: {
+        // the items stay in their segments, and the writer links more segments as it pushes
+        cap.store(capacity() << 1, std::memory_order_relaxed);
+        return true;
+      }
+      case Giveup: {
+        return false;
+      }
+      default: {
+        throw ZAFException("Unknown SWSRDeliveryQueueFullStrategy: ", s);
+      }
+    }
+  }
+
+  // called by the reader after it publishes `r` as the read index
+  inline void wake_writer(unsigned r) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (writer_parked.load(std::memory_order_relaxed) != 0) {
+      wake_parked_writer(r);
+    }
+  }
+
+  // called by the reader after it publishes `r` and sees `writer_parked`, no fence is needed
+  // because the writer checks the read index again after it sets `writer_parked`
+  inline void wake_parked_writer(unsigned r) {
+    auto c = capacity();
+    auto low_water = low_water_mark == 0 ? c / 2 : std::min(low_water_mark, c - 1);
+    if (write_idx.load(std::memory_order_acquire) - r <= low_water) {
+      auto parked = writer_parked.exchange(0, std::memory_order_relaxed);
+      if (parked == 1) {
+        thread::futex_wake(writer_parked);
+      } else if (parked == 2 && on_room) {
+        on_room();
+      }
+    }
+  }
 };
 } // namespace zaf
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+
+namespace zaf {
+/**
+ * Multi-writer single-reader list of the nodes that have something for the reader, e.g., the
+ * SWSR queues of an actor that become non-empty.
+ * 1. A node carries the intrusive link `Node* next_ready` and is in the list at most once, i.e.,
+ *    a writer puts a node into the list only when the node changes from "the reader is not aware
+ *    of it" to "the reader is aware of it", see `SWSRDeliveryQueue::inc_write_progress`.
+ * 2. `push` is a lock-free CAS loop on `head` and `take_all` takes the whole list with a single
+ *    exchange, which is free from ABA as no node is taken individually.
+ * 3. Writers notify the reader only when `notified` changes from false to true. The reader resets
+ *    `notified` with `prepare_wait` only when it has nothing to do, as Mailbox does. Thus a busy
+ *    reader gets no notification.
+ **/
+template<typename Node>
+class SWSRReadyList {
+public:
+  SWSRReadyList() = default;
+  SWSRReadyList(const SWSRReadyList&) = delete;
+  SWSRReadyList& operator=(const SWSRReadyList&) = delete;
+
+  // any writer can call
+  // return true if the reader is to be notified
+  bool push(Node* node) {
+    auto h = head.load(std::memory_order_relaxed);
+    do {
+      node->next_ready = h;
+    } while (!head.compare_exchange_weak(h, node, std::memory_order_seq_cst, std::memory_order_relaxed));
+    // must be seq_cst, pairs with the store in `prepare_wait`
+    return !notified.exchange(true, std::memory_order_seq_cst);
+  }
+
+  // only reader can call
+  // take all the nodes, which are linked by `next_ready` in the order they are pushed
+  Node* take_all() {
+    auto h = head.exchange(nullptr, std::memory_order_acquire);
+    Node* first = nullptr;
+    while (h) {
+      auto next = h->next_ready;
+      h->next_ready = first;
+      first = h;
+      h = next;
+    }
+    return first;
+  }
+
+  bool empty() const {
+    return head.load(std::memory_order_seq_cst) == nullptr;
+  }
+
+  // only reader can call before it stops taking nodes
+  // return true if the list is empty and writers notify the reader for the nodes pushed afterwards;
+  // return false if there are nodes in the list and the reader should take them.
+  bool prepare_wait() {
+    notified.store(false, std::memory_order_seq_cst);
+    if (empty()) {
+      return true;
+    }
+    notified.store(true, std::memory_order_seq_cst);
+    return false;
+  }
+
+private:
+  alignas(64) std::atomic<Node*> head{nullptr};
+  alignas(64) std::atomic<bool> notified{false};
+};
+} // namespace zaf
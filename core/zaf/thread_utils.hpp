@@ -1,13 +1,21 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
 #include <string>
+#include <thread>
 
 #ifdef __APPLE__
 #include <pthread.h>
 #endif
 
 #ifdef __linux__
+#include <linux/futex.h>
 #include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 #endif
 
 #include "zaf_exception.hpp"
@@ -88,5 +96,39 @@ inline static void set_name(const std::string& t_name) {
       " to ", t_name, ". Error: Thread name is not updated.");
   }
 }
+
+// a hint to the cpu that the thread is spinning
+inline static void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t));
+
+// Block until `word` is not `expected` or `futex_wake` is called on it, may return spuriously.
+// Without futex, sleep for a while instead.
+inline static void futex_wait(std::atomic<uint32_t>& word, uint32_t expected) {
+#ifdef __linux__
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected,
+    nullptr, nullptr, 0);
+#else
+  if (word.load(std::memory_order_relaxed) == expected) {
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+#endif
+}
+
+// wake all the threads blocked by `futex_wait` on `word`
+inline static void futex_wake(std::atomic<uint32_t>& word) {
+#ifdef __linux__
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, INT_MAX,
+    nullptr, nullptr, 0);
+#else
+  (void) word;
+#endif
+}
 } // namespace thread
 } // namespace zaf
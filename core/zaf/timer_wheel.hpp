@@ -0,0 +1,306 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace zaf {
+// Refers to a timer in a TimerWheel, stays valid (but refers to nothing) after the timer fires.
+struct TimerHandle {
+  uint32_t index = ~uint32_t(0);
+  uint32_t generation = 0;
+
+  explicit operator bool() const {
+    return index != ~uint32_t(0);
+  }
+};
+
+/**
+ * A hashed hierarchical timer wheel that keeps a value for each timer.
+ * 1. Time is counted in ticks of `TickDuration` since the construction of the wheel. A timer is
+ *    put into the tick that is not earlier than its time point, and the timers of the same tick
+ *    fire together in the order they are added, so a timer never fires early and fires at most
+ *    one tick late.
+ * 2. There are `NumLevels` levels of `NumSlots` slots each. A timer is put into the level of the
+ *    highest digit (in base `NumSlots`) in which its tick differs from the current tick, and is
+ *    moved to a lower level when the current tick reaches the start of its slot. Timers further
+ *    than the top level can cover go around the top level again.
+ * 3. `add` and `cancel` take O(1), finding the next tick with work to do takes O(NumLevels) with
+ *    the occupancy bitmaps of the levels, and `expire` skips the ticks with nothing to do.
+ * 4. The timers live in a pool with a free list, and a handle carries the generation of its slot
+ *    in the pool so that cancelling a fired timer does nothing.
+ **/
+template<typename T>
+class TimerWheel {
+public:
+  using Clock = std::chrono::steady_clock;
+  using TimePoint = Clock::time_point;
+  using TickDuration = std::chrono::milliseconds;
+
+  static constexpr unsigned SlotBits = 6;
+  static constexpr unsigned NumSlots = 1u << SlotBits;
+  static constexpr unsigned NumLevels = 6;
+
+  TimerWheel():
+    origin(Clock::now()) {
+  }
+
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  TimerHandle add(TimePoint time, T&& value) {
+    auto index = allocate();
+    auto& node = nodes[index];
+    node.value.emplace(std::move(value));
+    node.tick = to_tick_ceil(time);
+    place(index);
+    ++num_timers;
+    return {index, node.generation};
+  }
+
+  // return false if the timer has fired or has been cancelled
+  bool cancel(const TimerHandle& handle) {
+    if (!handle || handle.index >= nodes.size()) {
+      return false;
+    }
+    auto& node = nodes[handle.index];
+    if (node.generation != handle.generation || node.list == FreeList) {
+      return false;
+    }
+    unlink(handle.index);
+    release(handle.index);
+    --num_timers;
+    return true;
+  }
+
+  // Call `callback` with the value of each timer that is due at `now`, in the order of their ticks.
+  // `callback` may add, cancel and expire timers.
+  template<typename Callback>
+  void expire(TimePoint now, Callback&& callback) {
+    advance(to_tick_floor(now));
+    while (lists[ExpiredList].head != Nil) {
+      auto index = lists[ExpiredList].head;
+      unlink(index);
+      T value = std::move(*nodes[index].value);
+      release(index);
+      --num_timers;
+      callback(std::move(value));
+    }
+  }
+
+  // The time point at which `expire` has some work to do, which is either to fire timers or
+  // to move timers to a lower level, or nullopt if there is no timer.
+  std::optional<TimePoint> next_time() const {
+    if (num_timers == 0) {
+      return std::nullopt;
+    }
+    if (lists[ExpiredList].head != Nil) {
+      return origin + TickDuration{current_tick};
+    }
+    return origin + TickDuration{next_event_tick()};
+  }
+
+  bool empty() const {
+    return num_timers == 0;
+  }
+
+  size_t size() const {
+    return num_timers;
+  }
+
+  // drop all the timers, the handles given before refer to nothing afterwards
+  void clear() {
+    for (uint32_t i = 0; i < nodes.size(); i++) {
+      if (nodes[i].list != FreeList) {
+        unlink(i);
+        release(i);
+      }
+    }
+    num_timers = 0;
+  }
+
+private:
+  static constexpr uint32_t Nil = ~uint32_t(0);
+  // the lists of the slots are followed by the list of the expired timers
+  static constexpr uint16_t ExpiredList = NumLevels * NumSlots;
+  static constexpr uint16_t FreeList = ExpiredList + 1;
+
+  struct Node {
+    std::optional<T> value;
+    uint64_t tick = 0;
+    uint32_t prev = Nil;
+    uint32_t next = Nil;
+    uint32_t generation = 0;
+    uint16_t list = FreeList;
+  };
+
+  struct List {
+    uint32_t head = Nil;
+    uint32_t tail = Nil;
+  };
+
+  uint64_t to_tick_floor(TimePoint time) const {
+    if (time <= origin) {
+      return 0;
+    }
+    return std::chrono::duration_cast<TickDuration>(time - origin).count();
+  }
+
+  uint64_t to_tick_ceil(TimePoint time) const {
+    if (time <= origin) {
+      return 0;
+    }
+    auto tick = to_tick_floor(time);
+    return origin + TickDuration{tick} < time ? tick + 1 : tick;
+  }
+
+  uint32_t allocate() {
+    if (free_head != Nil) {
+      auto index = free_head;
+      free_head = nodes[index].next;
+      return index;
+    }
+    nodes.emplace_back();
+    return nodes.size() - 1;
+  }
+
+  void release(uint32_t index) {
+    auto& node = nodes[index];
+    node.value.reset();
+    ++node.generation;
+    node.list = FreeList;
+    node.prev = Nil;
+    node.next = free_head;
+    free_head = index;
+  }
+
+  void append(uint16_t list_id, uint32_t index) {
+    auto& list = lists[list_id];
+    auto& node = nodes[index];
+    node.list = list_id;
+    node.prev = list.tail;
+    node.next = Nil;
+    if (list.tail == Nil) {
+      list.head = index;
+    } else {
+      nodes[list.tail].next = index;
+    }
+    list.tail = index;
+    if (list_id != ExpiredList) {
+      occupied[list_id / NumSlots] |= uint64_t(1) << (list_id % NumSlots);
+    }
+  }
+
+  void unlink(uint32_t index) {
+    auto& node = nodes[index];
+    auto& list = lists[node.list];
+    if (node.prev == Nil) {
+      list.head = node.next;
+    } else {
+      nodes[node.prev].next = node.next;
+    }
+    if (node.next == Nil) {
+      list.tail = node.prev;
+    } else {
+      nodes[node.next].prev = node.prev;
+    }
+    if (list.head == Nil && node.list != ExpiredList) {
+      occupied[node.list / NumSlots] &= ~(uint64_t(1) << (node.list % NumSlots));
+    }
+    node.prev = node.next = Nil;
+  }
+
+  void place(uint32_t index) {
+    auto tick = nodes[index].tick;
+    if (tick <= current_tick) {
+      append(ExpiredList, index);
+      return;
+    }
+    auto highest_bit = 63 - __builtin_clzll(tick ^ current_tick);
+    auto level = std::min(unsigned(highest_bit) / SlotBits, NumLevels - 1);
+    auto slot = (tick >> (level * SlotBits)) & (NumSlots - 1);
+    append(level * NumSlots + slot, index);
+  }
+
+  // the earliest tick at which a slot is to be processed, requires some timer in the slots
+  uint64_t next_event_tick() const {
+    auto next = ~uint64_t(0);
+    for (unsigned level = 0; level < NumLevels; level++) {
+      if (occupied[level] == 0) {
+        continue;
+      }
+      auto shift = level * SlotBits;
+      auto digit = (current_tick >> shift) & (NumSlots - 1);
+      // the timers of a slot differ from the current tick at the digit of the slot,
+      // except for the top level where the timers may go around
+      auto later = digit == NumSlots - 1 ? 0 : occupied[level] & (~uint64_t(0) << (digit + 1));
+      auto base = current_tick >> (shift + SlotBits) << (shift + SlotBits);
+      uint64_t tick;
+      if (later) {
+        tick = base | (uint64_t(__builtin_ctzll(later)) << shift);
+      } else {
+        // only possible for the top level
+        tick = base + (uint64_t(1) << (shift + SlotBits)) +
+          (uint64_t(__builtin_ctzll(occupied[level])) << shift);
+      }
+      next = std::min(next, tick);
+    }
+    return next;
+  }
+
+  // move the current tick to `target`, cascading the slots and collecting the expired timers
+  void advance(uint64_t target) {
+    while (current_tick < target) {
+      auto next = occupied_any() ? next_event_tick() : ~uint64_t(0);
+      if (next > target) {
+        current_tick = target;
+        return;
+      }
+      current_tick = next;
+      // the higher levels first as their timers may go to the lower slots of this tick
+      for (unsigned level = NumLevels - 1; level > 0; level--) {
+        auto shift = level * SlotBits;
+        if ((current_tick & ((uint64_t(1) << shift) - 1)) != 0) {
+          continue;
+        }
+        reschedule(level * NumSlots + ((current_tick >> shift) & (NumSlots - 1)));
+      }
+      reschedule(current_tick & (NumSlots - 1));
+    }
+  }
+
+  void reschedule(uint16_t list_id) {
+    auto index = lists[list_id].head;
+    if (index == Nil) {
+      return;
+    }
+    lists[list_id] = List{};
+    occupied[list_id / NumSlots] &= ~(uint64_t(1) << (list_id % NumSlots));
+    while (index != Nil) {
+      auto next = nodes[index].next;
+      place(index);
+      index = next;
+    }
+  }
+
+  bool occupied_any() const {
+    for (auto o : occupied) {
+      if (o) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  TimePoint origin;
+  uint64_t current_tick = 0;
+  size_t num_timers = 0;
+  std::vector<Node> nodes;
+  uint32_t free_head = Nil;
+  List lists[NumLevels * NumSlots + 1];
+  uint64_t occupied[NumLevels] = {};
+};
+} // namespace zaf
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "macros.hpp"
+#include "message.hpp"
+
+namespace zaf {
+enum class TraceEventType : uint8_t {
+  Send,        // an actor sends a message to a local actor
+  Receive,     // an actor takes a message from its mailbox or SWSR queues
+  HandleBegin, // an actor starts to handle a message
+  HandleEnd,   // an actor finishes handling a message
+  NetSend,     // a NetGate Sender sends a batch
+  NetReceive   // a NetGate Receiver receives a batch
+};
+
+/**
+ * For Send, Receive, HandleBegin and HandleEnd:
+ *   `actor` is the sending actor for Send and the receiving actor otherwise, `peer` is the other one,
+ *   `code` is the code of the message, `id` is the address of the message.
+ *   Thus the Send and the Receive of a message have the same `id`, though the address may
+ *   be reused by another message once the message is deleted.
+ * For NetSend and NetReceive:
+ *   `actor` is the NetGate Sender or Receiver, `peer` is 0,
+ *   `code` is the number of messages in the batch, `id` is the number of bytes in the batch.
+ **/
+struct TraceEvent {
+  // TSC on x86-64, otherwise nanoseconds of std::chrono::steady_clock
+  uint64_t timestamp;
+  uint64_t id;
+  size_t code;
+  ActorIdType actor;
+  ActorIdType peer;
+  // assigned by the tracer to each thread that records events
+  uint32_t tid;
+  TraceEventType type;
+};
+
+/**
+ * An opt-in recorder of the events of messages, compiled in only if ZAF is built with
+ * ENABLE_TRACING and recording only between `enable` and `disable`.
+ *
+ * 1. Each thread records its events into its own ring buffer without any synchronization
+ *    with other threads. A full buffer overwrites its oldest events, i.e., the buffers
+ *    keep the last `EventsPerThread` events of each thread.
+ * 2. The buffer of an exited thread is kept and adopted by a later thread.
+ * 3. Exporting reads the buffers of all the threads. Events that may be overwritten during
+ *    the export are dropped, including the oldest event of a full buffer as it is the next
+ *    one to overwrite. Disable the tracer before exporting to get the other events.
+ **/
+namespace tracer {
+inline constexpr size_t EventsPerThread = size_t(1) << 14;
+
+namespace impl {
+// the runtime switch
+extern std::atomic<bool> enabled;
+} // namespace impl
+
+void enable();
+void disable();
+
+inline bool is_enabled() {
+  return ENABLE_TRACING && impl::enabled.load(std::memory_order_relaxed);
+}
+
+// record an event of the current thread, call only if `is_enabled()`
+void record(TraceEventType type, ActorIdType actor, ActorIdType peer, size_t code, uint64_t id);
+
+// record the Send of `m` from `actor` to `receiver` if the tracer is enabled
+inline void record_send(ActorIdType actor, ActorIdType receiver, const Message* m) {
+  if (is_enabled()) {
+    record(TraceEventType::Send, actor, receiver, m->get_body().get_code(),
+      reinterpret_cast<std::uintptr_t>(m));
+  }
+}
+
+// record the Receive of `m` by `actor` if the tracer is enabled
+inline void record_receive(ActorIdType actor, const Message* m) {
+  if (is_enabled()) {
+    record(TraceEventType::Receive, actor, m->get_sender().get_actor_id(),
+      m->get_body().get_code(), reinterpret_cast<std::uintptr_t>(m));
+  }
+}
+
+// Records HandleBegin when constructed and HandleEnd when destroyed if the tracer is enabled.
+class HandleScope {
+public:
+  HandleScope(ActorIdType actor, const Message* m) {
+    if (is_enabled()) {
+      this->actor = actor;
+      traced = true;
+      record(TraceEventType::HandleBegin, actor, m->get_sender().get_actor_id(),
+        m->get_body().get_code(), reinterpret_cast<std::uintptr_t>(m));
+    }
+  }
+
+  HandleScope(const HandleScope&) = delete;
+  HandleScope& operator=(const HandleScope&) = delete;
+
+  ~HandleScope() {
+    if (traced) {
+      record(TraceEventType::HandleEnd, actor, 0, 0, 0);
+    }
+  }
+
+private:
+  ActorIdType actor = 0;
+  bool traced = false;
+};
+
+// drop the events recorded so far
+void clear();
+
+// write the recorded events in the Chrome trace event format, which can be loaded by
+// chrome://tracing or Perfetto
+void write_chrome_trace(std::ostream& out);
+void write_chrome_trace(const std::string& path);
+} // namespace tracer
+} // namespace zaf
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <tuple>
 #include <type_traits>
+#include <vector>
 
 namespace zaf {
 namespace traits {
@@ -23,6 +25,12 @@ struct is_pair<std::pair<A, B>> : public std::true_type {
   using second_type = B;
 };
 
+template<typename T>
+struct is_tuple : public std::false_type {};
+
+template<typename ... ArgT>
+struct is_tuple<std::tuple<ArgT ...>> : public std::true_type {};
+
 namespace impl {
 template<typename T>
 auto is_iterable(int) -> decltype(
@@ -89,6 +97,15 @@ using has_reserve = decltype(impl::has_reserve<T>(0));
 
 template<typename T>
 using remove_cvref_t = std::remove_cv_t<std::remove_reference_t<T>>;
+
+// a std::vector of POD elements, which can be (de)serialized with one memcpy
+template<typename T>
+struct is_pod_vector : public std::false_type {};
+
+template<typename E, typename A>
+struct is_pod_vector<std::vector<E, A>> : public std::bool_constant<
+  std::is_pod_v<E> && !std::is_same_v<E, bool>
+> {};
 } // namespace traits
 
 // https://en.cppreference.com/w/cpp/utility/variant/visit
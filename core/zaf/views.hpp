@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "traits.hpp"
+
+namespace zaf {
+/**
+ * Views that message handlers can declare as arguments in place of the types being viewed:
+ *
+ *   std::string_view  for  std::string
+ *   zaf::span<const T> for std::vector<T>, where T is POD
+ *   zaf::BytesView     for std::vector<char>
+ *
+ * 1. A message that contains the viewed type is accepted by a handler that takes the view,
+ *    i.e., the type hash of a view is that of the viewed type.
+ * 2. For a serialized message, e.g., one received by NetGate, the view points into the
+ *    bytes retained by the message body without copying. For a message in memory,
+ *    the view points to the content of the message.
+ * 3. The message (and thus the viewed bytes) is alive until the handler returns.
+ *    Copy the content if it is needed after that.
+ *
+ * Messages should carry the viewed types instead of the views.
+ **/
+
+// A read-only view of bytes
+class BytesView {
+public:
+  BytesView() = default;
+
+  BytesView(const char* data, size_t size):
+    bytes(data),
+    num_bytes(size) {
+  }
+
+  BytesView(const std::vector<char>& v):
+    bytes(v.data()),
+    num_bytes(v.size()) {
+  }
+
+  inline const char* data() const { return bytes; }
+  inline size_t size() const { return num_bytes; }
+  inline bool empty() const { return num_bytes == 0; }
+
+  inline const char* begin() const { return bytes; }
+  inline const char* end() const { return bytes + num_bytes; }
+
+  inline char operator[](size_t i) const { return bytes[i]; }
+
+  inline std::vector<char> to_vector() const {
+    return {bytes, bytes + num_bytes};
+  }
+
+private:
+  const char* bytes = nullptr;
+  size_t num_bytes = 0;
+};
+
+template<typename T>
+class span;
+
+// A read-only view of POD elements.
+// The elements may not be aligned in serialized bytes, thus they are read by value.
+template<typename T>
+class span<const T> {
+public:
+  static_assert(std::is_pod_v<T>, "zaf::span only views POD elements.");
+  static_assert(!std::is_same_v<T, bool>, "zaf::span does not view std::vector<bool>.");
+
+  class const_iterator {
+  public:
+    const_iterator(const char* ptr): ptr(ptr) {}
+
+    inline T operator*() const {
+      T t;
+      std::memcpy(&t, ptr, sizeof(T));
+      return t;
+    }
+
+    inline const_iterator& operator++() {
+      ptr += sizeof(T);
+      return *this;
+    }
+
+    inline bool operator==(const const_iterator& o) const { return ptr == o.ptr; }
+    inline bool operator!=(const const_iterator& o) const { return ptr != o.ptr; }
+
+  private:
+    const char* ptr;
+  };
+
+  span() = default;
+
+  // `size` is the number of elements in `bytes`
+  span(const char* bytes, size_t size):
+    bytes(bytes),
+    num_elements(size) {
+  }
+
+  span(const std::vector<T>& v):
+    bytes(reinterpret_cast<const char*>(v.data())),
+    num_elements(v.size()) {
+  }
+
+  inline size_t size() const { return num_elements; }
+  inline bool empty() const { return num_elements == 0; }
+
+  inline T operator[](size_t i) const {
+    T t;
+    std::memcpy(&t, bytes + i * sizeof(T), sizeof(T));
+    return t;
+  }
+
+  inline const_iterator begin() const { return {bytes}; }
+  inline const_iterator end() const { return {bytes + num_elements * sizeof(T)}; }
+
+  // the viewed bytes, i.e., size() * sizeof(T) bytes
+  inline const char* data_bytes() const { return bytes; }
+
+  // whether the elements are aligned such that `data()` can be used
+  inline bool is_aligned() const {
+    return reinterpret_cast<std::uintptr_t>(bytes) % alignof(T) == 0;
+  }
+
+  inline const T* data() const {
+    return reinterpret_cast<const T*>(bytes);
+  }
+
+  inline std::vector<T> to_vector() const {
+    std::vector<T> v(num_elements);
+    if (num_elements != 0) {
+      std::memcpy(v.data(), bytes, num_elements * sizeof(T));
+    }
+    return v;
+  }
+
+private:
+  const char* bytes = nullptr;
+  size_t num_elements = 0;
+};
+
+namespace traits {
+template<typename T>
+struct view_traits {
+  inline constexpr static bool is_view = false;
+  using viewed_type = T;
+};
+
+template<>
+struct view_traits<std::string_view> {
+  inline constexpr static bool is_view = true;
+  using viewed_type = std::string;
+};
+
+template<typename T>
+struct view_traits<span<const T>> {
+  inline constexpr static bool is_view = true;
+  using viewed_type = std::vector<T>;
+};
+
+template<>
+struct view_traits<BytesView> {
+  inline constexpr static bool is_view = true;
+  using viewed_type = std::vector<char>;
+};
+
+template<typename T>
+using is_view = std::bool_constant<view_traits<remove_cvref_t<T>>::is_view>;
+
+// the type carried by messages for a handler argument of type T
+template<typename T>
+using content_type_t = typename view_traits<remove_cvref_t<T>>::viewed_type;
+} // namespace traits
+} // namespace zaf
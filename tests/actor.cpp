@@ -1,3 +1,6 @@
+#include <atomic>
+#include <vector>
+
 #include "zaf/actor_system.hpp"
 #include "zaf/net_gate.hpp"
 #include "zaf/net_gate_client.hpp"
@@ -90,6 +93,94 @@ GTEST_TEST(Actor, RemoteActorLocalTransfer) {
   EXPECT_EQ(i, 1);
 }
 
+GTEST_TEST(Actor, RemoteMessagesWithFlushPolicy) {
+  int sum = 0;
+  std::thread machine_a([&]() {
+    ActorSystem sys;
+    NetGate gate{sys, "127.0.0.1", 45679};
+    NetGateClient client{gate.actor()};
+    auto sender = sys.create_scoped_actor();
+    client.register_actor(*sender, "A", sys.spawn([&](ActorBehavior& self) {
+      for (int j = 0; j < 100; j++) {
+        self.receive_once({
+          Code{0} - [&](int k) {
+            // messages are received in order
+            EXPECT_EQ(k, j);
+            sum += k;
+          }
+        });
+      }
+    }));
+  });
+  std::thread machine_b([&]() {
+    ActorSystem sys;
+    NetGate::FlushPolicy policy;
+    policy.max_messages = 8;
+    policy.max_linger = std::chrono::microseconds{500};
+    NetGate gate{sys, "127.0.0.1", 34568, policy};
+    NetGateClient client{gate.actor()};
+    auto c = sys.create_scoped_actor();
+    client.lookup_actor(*c, "127.0.0.1:45679", "A");
+    c->receive_once({
+      client.on_lookup_actor_reply([&](std::string&, std::string&, Actor a) {
+        for (int k = 0; k < 100; k++) {
+          c->send(a, 0, k);
+        }
+      })
+    });
+  });
+  machine_a.join();
+  machine_b.join();
+  EXPECT_EQ(sum, 99 * 100 / 2);
+}
+
+GTEST_TEST(Actor, RemoteMessagesOverLanes) {
+  std::atomic<int> sum{0};
+  std::thread machine_a([&]() {
+    ActorSystem sys;
+    NetGate gate{sys, "127.0.0.1", 45680, NetGate::FlushPolicy{}, 3};
+    NetGateClient client{gate.actor()};
+    auto sender = sys.create_scoped_actor();
+    for (int i = 0; i < 4; i++) {
+      client.register_actor(*sender, to_string("A", i), sys.spawn([&](ActorBehavior& self) {
+        for (int j = 0; j < 100; j++) {
+          self.receive_once({
+            Code{0} - [&](int k) {
+              // messages to the same actor go through the same lane and thus are in order
+              EXPECT_EQ(k, j);
+              sum += k;
+            }
+          });
+        }
+      }));
+    }
+  });
+  std::thread machine_b([&]() {
+    ActorSystem sys;
+    // the peers use different numbers of lanes
+    NetGate gate{sys, "127.0.0.1", 34569, NetGate::FlushPolicy{}, 2};
+    NetGateClient client{gate.actor()};
+    auto c = sys.create_scoped_actor();
+    std::vector<Actor> actors;
+    for (int i = 0; i < 4; i++) {
+      client.lookup_actor(*c, "127.0.0.1:45680", to_string("A", i));
+      c->receive_once({
+        client.on_lookup_actor_reply([&](std::string&, std::string&, Actor a) {
+          actors.push_back(a);
+        })
+      });
+    }
+    for (int k = 0; k < 100; k++) {
+      for (auto& a : actors) {
+        c->send(a, 0, k);
+      }
+    }
+  });
+  machine_a.join();
+  machine_b.join();
+  EXPECT_EQ(sum, 4 * 99 * 100 / 2);
+}
+
 // GTEST_TEST(Actor, RemoteActorTransferToOriginalActorSystem) 
 // GTEST_TEST(Actor, RemoteActorTransferToAThirdActorSystem) 
 } // namespace zaf
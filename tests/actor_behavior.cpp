@@ -1,3 +1,5 @@
+#include <vector>
+
 #include "zaf/actor_behavior.hpp"
 #include "zaf/actor_system.hpp"
 
@@ -44,6 +46,29 @@ GTEST_TEST(ActorBehavior, DelayedSendWithReceiveTimeout) {
   });
 }
 
+GTEST_TEST(ActorBehavior, CancelDelayedSend) {
+  ActorSystem actor_system;
+
+  ActorBehavior actor;
+  actor.initialize_actor(actor_system, actor_system);
+
+  auto h1 = actor.delayed_send(std::chrono::milliseconds{20}, actor, Code{0}, 1);
+  auto h2 = actor.delayed_send(std::chrono::milliseconds{10}, actor, Code{0}, 2);
+  EXPECT_TRUE(actor.cancel_delayed_send(h1));
+  EXPECT_FALSE(actor.cancel_delayed_send(h1));
+  std::vector<int> received;
+  while (actor.get_next_delayed_message_time()) {
+    actor.receive_once({
+      Code{0} - [&](int v) { received.push_back(v); }
+    }, std::chrono::milliseconds{50});
+  }
+  actor.receive_once({
+    Code{0} - [&](int v) { received.push_back(v); }
+  }, std::chrono::milliseconds{0});
+  EXPECT_EQ(received, std::vector<int>{2});
+  EXPECT_FALSE(actor.cancel_delayed_send(h2));
+}
+
 GTEST_TEST(ActorBehavior, ExtraRecvPoll) {
   ActorSystem actor_system;
 
@@ -93,4 +118,31 @@ GTEST_TEST(ActorBehavior, ExtraRecvPoll) {
   EXPECT_EQ((int) num_recvs, 2);
 }
 
+GTEST_TEST(ActorBehavior, ReceiveBatch) {
+  ActorSystem actor_system;
+
+  ActorBehavior actor;
+  actor.initialize_actor(actor_system, actor_system);
+
+  for (int i = 0; i < 10; i++) {
+    actor.send(actor, 0, i);
+  }
+  int next = 0;
+  MessageHandlers handlers{
+    Code{0} - [&](int i) {
+      EXPECT_EQ(i, next++);
+      if (i == 8) {
+        actor.deactivate();
+      }
+    }
+  };
+  actor.activate();
+  EXPECT_EQ(actor.receive_batch(handlers, 4, 0), 4);
+  // stop once the actor is deactivated
+  EXPECT_EQ(actor.receive_batch(handlers, 10, 0), 5);
+  EXPECT_EQ(actor.receive_batch(handlers, 10, 0), 1);
+  EXPECT_EQ(actor.receive_batch(handlers, 10, 0), 0);
+  EXPECT_EQ(next, 10);
+}
+
 } // namespace zaf
@@ -1,9 +1,147 @@
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <thread>
+
 #include "zaf/actor_behavior_x.hpp"
+#include "zaf/actor_engine.hpp"
 #include "zaf/actor_system.hpp"
 
 #include "gtest/gtest.h"
 
 namespace zaf {
+namespace {
+class Producer : public ActorBehaviorX {
+public:
+  Producer(Actor consumer, int n):
+    consumer(consumer),
+    n(n) {
+  }
+
+  void start() override {
+    // more messages than a queue can hold, and the producer terminates before they are consumed
+    for (int i = 0; i < n; i++) {
+      this->send(consumer, 0, i);
+    }
+    this->send(consumer, 1);
+    this->deactivate();
+  }
+
+  Actor consumer;
+  const int n;
+};
+
+class Consumer : public ActorBehaviorX {
+public:
+  Consumer(int num_producers, std::atomic<int>& total):
+    num_producers(num_producers),
+    total(total) {
+  }
+
+  MessageHandlers behavior() override {
+    return {
+      Code{0} - [&](int i) {
+        // the messages of each producer arrive in order
+        EXPECT_EQ(next[this->get_current_sender_actor().get_actor_id()]++, i);
+        total++;
+      },
+      Code{1} - [&]() {
+        if (++num_done == num_producers) {
+          this->deactivate();
+        }
+      }
+    };
+  }
+
+  const int num_producers;
+  int num_done = 0;
+  std::map<ActorIdType, int> next;
+  std::atomic<int>& total;
+};
+
+// sends `n` messages, or sends until `send` throws if `n` is 0, and terminates after the sink
+// receives them
+class PendingProducer : public ActorBehaviorX {
+public:
+  PendingProducer(Actor sink, int n, size_t max_pending):
+    sink(sink),
+    n(n),
+    max_pending(max_pending) {
+  }
+
+  void start() override {
+    if (max_pending != 0) {
+      this->set_max_pending_messages(max_pending);
+    }
+    int num_sent = 0;
+    try {
+      for (; n == 0 || num_sent < n; num_sent++) {
+        this->send(sink, 0, num_sent);
+      }
+    } catch (const ZAFException&) {
+      // the queue holds 1 << 15 messages
+      EXPECT_EQ(num_sent, (1 << 15) + int(max_pending));
+    }
+    // by the mailbox, which never keeps the message
+    this->ActorBehavior::send(sink, 1, num_sent);
+  }
+
+  MessageHandlers behavior() override {
+    return {
+      Code{2} - [&]() {
+        this->deactivate();
+      }
+    };
+  }
+
+  Actor sink;
+  const int n;
+  const size_t max_pending;
+};
+
+class Sink : public ActorBehaviorX {
+public:
+  Sink(std::atomic<int>& total):
+    total(total) {
+  }
+
+  MessageHandlers behavior() override {
+    return {
+      Code{0} - [&](int i) {
+        EXPECT_EQ(total++, i);
+        check_done();
+      },
+      Code{1} - [&](int n) {
+        expected = n;
+        producer = this->get_current_sender_actor();
+        check_done();
+      }
+    };
+  }
+
+  void check_done() {
+    if (total == expected) {
+      this->ActorBehavior::send(producer, 2);
+      this->deactivate();
+    }
+  }
+
+  int expected = -1;
+  Actor producer;
+  std::atomic<int>& total;
+};
+
+void run_producers_on_engine(ActorEngine& engine) {
+  std::atomic<int> total{0};
+  auto consumer = engine.spawn<Consumer>(3, total);
+  for (int i = 0; i < 3; i++) {
+    engine.spawn<Producer>(consumer, 50000);
+  }
+  engine.await_all_actors_done();
+  EXPECT_EQ(total, 3 * 50000);
+}
+} // namespace
+
 GTEST_TEST(ActorBehaviorX, ToSelf) {
   ActorSystem actor_system;
 
@@ -98,4 +236,81 @@ GTEST_TEST(ActorBehaviorX, X2A2X) {
     }
   });
 }
+
+GTEST_TEST(ActorBehaviorX, FanInOnThreads) {
+  ActorSystem actor_system;
+  const int num_producers = 20, num_messages = 2000;
+  std::atomic<int> total{0};
+  auto consumer = actor_system.spawn([&](ActorBehaviorX& self) {
+    int num_done = 0;
+    std::map<ActorIdType, int> next;
+    self.receive({
+      Code{0} - [&](int i) {
+        EXPECT_EQ(next[self.get_current_sender_actor().get_actor_id()]++, i);
+        total++;
+      },
+      Code{1} - [&]() {
+        if (++num_done == num_producers) {
+          self.deactivate();
+        }
+      }
+    });
+  });
+  for (int k = 0; k < num_producers; k++) {
+    actor_system.spawn([&](ActorBehaviorX& self) {
+      for (int i = 0; i < num_messages; i++) {
+        self.send(consumer, 0, i);
+        if (i % 100 == 0) {
+          // let the consumer drain the queues and wait
+          std::this_thread::sleep_for(std::chrono::microseconds{100});
+        }
+      }
+      self.send(consumer, 1);
+    });
+  }
+  actor_system.await_all_actors_done();
+  EXPECT_EQ(total, num_producers * num_messages);
+}
+
+GTEST_TEST(ActorBehaviorX, OnEnginePolling) {
+  ActorSystem actor_system;
+  ActorEngine engine{actor_system, 2};
+  run_producers_on_engine(engine);
+}
+
+GTEST_TEST(ActorBehaviorX, OnEngineWorkStealing) {
+  ActorSystem actor_system;
+  ActorEngine engine{actor_system, 2, ActorEngine::Scheduling::WorkStealing};
+  run_producers_on_engine(engine);
+}
+
+GTEST_TEST(ActorBehaviorX, OnEngineRebalance) {
+  ActorSystem actor_system;
+  ActorEngine engine{actor_system, 3};
+  // move actors among the executors while their queues are being used
+  engine.set_load_rebalance_period(1);
+  engine.set_load_diff_ratio(0);
+  run_producers_on_engine(engine);
+}
+
+GTEST_TEST(ActorBehaviorX, OnEngineWaitForRoom) {
+  ActorSystem actor_system;
+  // the sink does not run while the producer sends, so the producer keeps some messages
+  ActorEngine engine{actor_system, 1, ActorEngine::Scheduling::WorkStealing};
+  std::atomic<int> total{0};
+  auto sink = engine.spawn<Sink>(total);
+  engine.spawn<PendingProducer>(sink, 50000, 0);
+  engine.await_all_actors_done();
+  EXPECT_EQ(total, 50000);
+}
+
+GTEST_TEST(ActorBehaviorX, OnEngineMaxPendingMessages) {
+  ActorSystem actor_system;
+  ActorEngine engine{actor_system, 1, ActorEngine::Scheduling::WorkStealing};
+  std::atomic<int> total{0};
+  auto sink = engine.spawn<Sink>(total);
+  engine.spawn<PendingProducer>(sink, 0, 100);
+  engine.await_all_actors_done();
+  EXPECT_EQ(total, (1 << 15) + 100);
+}
 } // namespace zaf
@@ -0,0 +1,254 @@
+#include <atomic>
+#include <chrono>
+
+#include "zaf/actor_behavior_x.hpp"
+#include "zaf/actor_engine.hpp"
+#include "zaf/actor_system.hpp"
+
+#include "gtest/gtest.h"
+
+namespace zaf {
+namespace {
+class Counter : public ActorBehavior {
+public:
+  Counter(int n, std::atomic<int>& total):
+    n(n),
+    total(total) {
+  }
+
+  void start() override {
+    this->send(*this, 0, 0);
+  }
+
+  MessageHandlers behavior() override {
+    return {
+      Code{0} - [&](int i) {
+        total++;
+        if (i + 1 == n) {
+          this->deactivate();
+        } else {
+          this->send(*this, 0, i + 1);
+        }
+      }
+    };
+  }
+
+  const int n;
+  std::atomic<int>& total;
+};
+
+class Idle : public ActorBehavior {
+public:
+  Idle(std::atomic<int>& num_stopped):
+    num_stopped(num_stopped) {
+  }
+
+  void stop() override {
+    num_stopped++;
+  }
+
+  std::atomic<int>& num_stopped;
+};
+
+class Asker : public ActorBehavior {
+public:
+  Asker(Actor replier, std::atomic<int>& num_replies):
+    replier(replier),
+    num_replies(num_replies) {
+  }
+
+  void start() override {
+    this->send(*this, 0);
+  }
+
+  MessageHandlers behavior() override {
+    return {
+      Code{0} - [&]() {
+        // blocking in a nested receive within a handler
+        this->request(replier, 1, 10).on_reply({
+          Code{2} - [&](int v) {
+            EXPECT_EQ(v, 20);
+            num_replies++;
+          }
+        });
+        this->deactivate();
+      }
+    };
+  }
+
+  Actor replier;
+  std::atomic<int>& num_replies;
+};
+
+class Replier : public ActorBehavior {
+public:
+  MessageHandlers behavior() override {
+    return {
+      Code{1} - [&](int v) {
+        this->reply(2, v * 2);
+        this->deactivate();
+      }
+    };
+  }
+};
+
+class Ticker : public ActorBehavior {
+public:
+  Ticker(int n, std::atomic<int>& num_ticks):
+    n(n),
+    num_ticks(num_ticks) {
+  }
+
+  void start() override {
+    this->delayed_send(std::chrono::milliseconds{1}, *this, 0, 0);
+  }
+
+  MessageHandlers behavior() override {
+    return {
+      Code{0} - [&](int i) {
+        num_ticks++;
+        if (i + 1 == n) {
+          this->deactivate();
+        } else {
+          this->delayed_send(std::chrono::milliseconds{1}, *this, 0, i + 1);
+        }
+      }
+    };
+  }
+
+  const int n;
+  std::atomic<int>& num_ticks;
+};
+} // namespace
+
+GTEST_TEST(ActorEngine, Polling) {
+  ActorSystem actor_system;
+  std::atomic<int> total{0};
+  {
+    ActorEngine engine{actor_system, 2};
+    for (int i = 0; i < 10; i++) {
+      engine.spawn<Counter>(100, total);
+    }
+    engine.await_all_actors_done();
+  }
+  EXPECT_EQ(total, 10 * 100);
+}
+
+GTEST_TEST(ActorEngine, WorkStealing) {
+  ActorSystem actor_system;
+  std::atomic<int> total{0};
+  {
+    ActorEngine engine{actor_system, 4, ActorEngine::Scheduling::WorkStealing};
+    engine.set_max_messages_per_run(8);
+    for (int i = 0; i < 100; i++) {
+      engine.spawn<Counter>(1000, total);
+    }
+    engine.await_all_actors_done();
+  }
+  EXPECT_EQ(total, 100 * 1000);
+}
+
+GTEST_TEST(ActorEngine, WorkStealingNestedReceive) {
+  ActorSystem actor_system;
+  std::atomic<int> num_replies{0};
+  {
+    // the asker blocks one executor while the replier runs on the other one
+    ActorEngine engine{actor_system, 2, ActorEngine::Scheduling::WorkStealing};
+    engine.spawn<Asker>(engine.spawn<Replier>(), num_replies);
+    engine.await_all_actors_done();
+  }
+  EXPECT_EQ(num_replies, 1);
+}
+
+GTEST_TEST(ActorEngine, WorkStealingTerminate) {
+  ActorSystem actor_system;
+  std::atomic<int> num_stopped{0};
+  ActorEngine engine{actor_system, 2, ActorEngine::Scheduling::WorkStealing};
+  for (int i = 0; i < 10; i++) {
+    engine.spawn<Idle>(num_stopped);
+  }
+  engine.terminate();
+  EXPECT_EQ(num_stopped, 10);
+}
+
+GTEST_TEST(ActorEngine, WorkStealingDelayedSend) {
+  ActorSystem actor_system;
+  std::atomic<int> num_ticks{0};
+  {
+    // the actors get no other message, so only their timers run them again
+    ActorEngine engine{actor_system, 2, ActorEngine::Scheduling::WorkStealing};
+    for (int i = 0; i < 10; i++) {
+      engine.spawn<Ticker>(5, num_ticks);
+    }
+    engine.await_all_actors_done();
+  }
+  EXPECT_EQ(num_ticks, 10 * 5);
+}
+
+GTEST_TEST(ActorEngine, FiberRequestReply) {
+  ActorSystem actor_system;
+  std::atomic<int> num_replies{0};
+  {
+    // the askers wait for replies without blocking the only executor
+    ActorEngine engine{actor_system, 1, ActorEngine::Scheduling::WorkStealing};
+    auto replier = engine.spawn([&](ActorBehavior& self) {
+      for (int i = 0; i < 100; i++) {
+        self.receive_once({
+          Code{1} - [&](int v) { self.reply(2, v * 2); }
+        });
+      }
+    });
+    for (int i = 0; i < 100; i++) {
+      engine.spawn([&, i](ActorBehavior& self) {
+        self.request(replier, 1, i).on_reply({
+          Code{2} - [&](int v) {
+            EXPECT_EQ(v, i * 2);
+            num_replies++;
+          }
+        });
+      });
+    }
+    engine.await_all_actors_done();
+  }
+  EXPECT_EQ(num_replies, 100);
+}
+
+GTEST_TEST(ActorEngine, FiberReceiveTimeout) {
+  ActorSystem actor_system;
+  std::atomic<int> num_timeouts{0}, num_received{0};
+  {
+    ActorEngine engine{actor_system, 1, ActorEngine::Scheduling::WorkStealing};
+    auto receiver = engine.spawn([&](ActorBehavior& self) {
+      MessageHandlers handlers{
+        Code{0} - [&]() { num_received++; }
+      };
+      while (num_received < 2) {
+        if (!self.receive_once(handlers, std::chrono::milliseconds{10})) {
+          num_timeouts++;
+        }
+      }
+    });
+    engine.spawn([&](ActorBehavior& self) {
+      self.send(receiver, 0);
+      self.delayed_send(std::chrono::milliseconds{50}, receiver, 0);
+      // flush the delayed message
+      self.receive_once({}, std::chrono::milliseconds{100});
+    });
+    engine.await_all_actors_done();
+  }
+  EXPECT_EQ(num_received, 2);
+  EXPECT_GE(num_timeouts, 2);
+}
+
+GTEST_TEST(ActorEngine, FiberUnderPolling) {
+  ActorSystem actor_system;
+  ActorEngine engine{actor_system, 1};
+  EXPECT_THROW(engine.spawn([](ActorBehavior&) {}), ZAFException);
+}
+
+GTEST_TEST(ActorEngine, FiberRejectsActorBehaviorX) {
+  ActorSystem actor_system;
+  ActorEngine engine{actor_system, 1, ActorEngine::Scheduling::WorkStealing};
+  EXPECT_THROW(engine.spawn([](ActorBehaviorX&) {}), ZAFException);
+}
+} // namespace zaf
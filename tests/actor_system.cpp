@@ -1,9 +1,73 @@
+#include <atomic>
+#include <string>
+
 #include "zaf/actor_system.hpp"
+#include "zaf/thread_utils.hpp"
 
 #include "gtest/gtest.h"
 #include "glog/logging.h"
 
 namespace zaf {
+namespace {
+// records the name of the thread that starts the actor
+class Echo : public ActorBehavior {
+public:
+  Echo(std::string& thread_name):
+    thread_name(thread_name) {
+  }
+
+  void start() override {
+    thread_name = thread::get_name();
+  }
+
+  MessageHandlers behavior() override {
+    return {
+      Code{0} - [&](int i) {
+        this->reply(1, i);
+        this->deactivate();
+      }
+    };
+  }
+
+  std::string& thread_name;
+};
+
+class BlockingEcho : public Echo {
+public:
+  using Echo::Echo;
+
+  bool is_blocking() const override {
+    return true;
+  }
+};
+
+class Timer : public ActorBehavior {
+public:
+  Timer(std::atomic<int>& num_fired):
+    num_fired(num_fired) {
+  }
+
+  void start() override {
+    this->delayed_send(std::chrono::milliseconds{20}, *this, Code{0}, 3);
+  }
+
+  MessageHandlers behavior() override {
+    return {
+      Code{0} - [&](int n) {
+        num_fired++;
+        if (n == 1) {
+          this->deactivate();
+        } else {
+          this->delayed_send(std::chrono::milliseconds{5}, *this, Code{0}, n - 1);
+        }
+      }
+    };
+  }
+
+  std::atomic<int>& num_fired;
+};
+} // namespace
+
 GTEST_TEST(ActorSystem, Basic) {
   ActorSystem actor_system;
 }
@@ -73,4 +137,62 @@ GTEST_TEST(ActorSystem, Terminator) {
     });
   }
 }
+
+GTEST_TEST(ActorSystem, Scheduler) {
+  ActorSystem actor_system;
+  actor_system.set_num_scheduler_executors(2);
+  std::string name, blocking_name;
+  auto a = actor_system.spawn<Echo>(name);
+  auto b = actor_system.spawn<BlockingEcho>(blocking_name);
+  auto s = actor_system.create_scoped_actor();
+  s->send(a, 0, 1);
+  s->send(b, 0, 2);
+  int sum = 0;
+  for (int i = 0; i < 2; i++) {
+    s->receive_once({
+      Code{1} - [&](int x) { sum += x; }
+    });
+  }
+  EXPECT_EQ(sum, 3);
+  s = nullptr;
+  actor_system.await_all_actors_done();
+  // run by an executor of the scheduler
+  EXPECT_EQ(name.rfind("ZAF/E", 0), 0u);
+  // run by its own thread
+  EXPECT_EQ(blocking_name, to_string("ZAF/A", b.get_actor_id()));
+}
+
+GTEST_TEST(ActorSystem, SchedulerRestart) {
+  ActorSystem actor_system;
+  actor_system.set_num_scheduler_executors(2);
+  for (int round = 0; round < 3; round++) {
+    std::string names[100];
+    auto s = actor_system.create_scoped_actor();
+    for (int i = 0; i < 100; i++) {
+      s->send(actor_system.spawn<Echo>(names[i]), 0, i);
+    }
+    int sum = 0;
+    for (int i = 0; i < 100; i++) {
+      s->receive_once({
+        Code{1} - [&](int x) { sum += x; }
+      });
+    }
+    EXPECT_EQ(sum, 4950);
+    s = nullptr;
+    // stops the scheduler, and the next spawn starts it again
+    actor_system.await_all_actors_done();
+  }
+}
+
+GTEST_TEST(ActorSystem, SchedulerDelayedSend) {
+  std::atomic<int> num_fired{0};
+  {
+    ActorSystem actor_system;
+    actor_system.set_num_scheduler_executors(1);
+    for (int i = 0; i < 4; i++) {
+      actor_system.spawn<Timer>(num_fired);
+    }
+  }
+  EXPECT_EQ(num_fired.load(), 12);
+}
 } // namespace zaf
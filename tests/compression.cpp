@@ -0,0 +1,54 @@
+#include <string>
+#include <vector>
+
+#include "zaf/compression.hpp"
+#include "zaf/zaf_exception.hpp"
+
+#include "gtest/gtest.h"
+
+namespace zaf {
+namespace {
+std::vector<char> make_records() {
+  std::vector<char> bytes;
+  for (int i = 0; i < 1000; i++) {
+    auto record = "{\"id\":" + std::to_string(i % 10) + ",\"status\":\"OK\"}";
+    bytes.insert(bytes.end(), record.begin(), record.end());
+  }
+  return bytes;
+}
+} // namespace
+
+GTEST_TEST(Compression, None) {
+  auto bytes = make_records();
+  std::vector<char> compressed(compression::max_compressed_size(Compression::None, bytes.size()));
+  auto size = compression::compress(Compression::None, bytes.data(), bytes.size(),
+    compressed.data(), compressed.size());
+  EXPECT_EQ(size, bytes.size());
+  std::vector<char> decompressed(bytes.size());
+  compression::decompress(Compression::None, compressed.data(), size,
+    decompressed.data(), decompressed.size());
+  EXPECT_EQ(decompressed, bytes);
+}
+
+GTEST_TEST(Compression, LZ4) {
+  if (!compression::is_supported(Compression::LZ4)) {
+    GTEST_SKIP() << "ZAF is built without LZ4";
+  }
+  auto bytes = make_records();
+  std::vector<char> compressed(compression::max_compressed_size(Compression::LZ4, bytes.size()));
+  auto size = compression::compress(Compression::LZ4, bytes.data(), bytes.size(),
+    compressed.data(), compressed.size());
+  EXPECT_GT(size, 0u);
+  EXPECT_LT(size, bytes.size() / 2);
+  std::vector<char> decompressed(bytes.size());
+  compression::decompress(Compression::LZ4, compressed.data(), size,
+    decompressed.data(), decompressed.size());
+  EXPECT_EQ(decompressed, bytes);
+  // corrupt bytes
+  EXPECT_THROW(compression::decompress(Compression::LZ4, compressed.data(), size / 2,
+    decompressed.data(), decompressed.size()), ZAFException);
+  // not enough room for the compressed bytes
+  EXPECT_EQ(compression::compress(Compression::LZ4, bytes.data(), bytes.size(),
+    compressed.data(), size / 2), 0u);
+}
+} // namespace zaf
@@ -0,0 +1,57 @@
+#include <thread>
+#include <vector>
+
+#include "zaf/fiber.hpp"
+#include "zaf/zaf_exception.hpp"
+
+#include "gtest/gtest.h"
+
+namespace zaf {
+GTEST_TEST(Fiber, ResumeAndSuspend) {
+  std::vector<int> steps;
+  Fiber* fiber_ptr = nullptr;
+  Fiber fiber([&]() {
+    EXPECT_EQ(Fiber::current(), fiber_ptr);
+    steps.push_back(1);
+    fiber_ptr->suspend();
+    steps.push_back(3);
+  });
+  fiber_ptr = &fiber;
+  EXPECT_EQ(Fiber::current(), nullptr);
+  fiber.resume();
+  steps.push_back(2);
+  EXPECT_FALSE(fiber.is_done());
+  fiber.resume();
+  EXPECT_TRUE(fiber.is_done());
+  EXPECT_EQ(steps, (std::vector<int>{1, 2, 3}));
+  EXPECT_THROW(fiber.resume(), ZAFException);
+}
+
+GTEST_TEST(Fiber, ResumeByAnotherThread) {
+  int sum = 0;
+  Fiber* fiber_ptr = nullptr;
+  Fiber fiber([&]() {
+    for (int i = 1; i <= 10; i++) {
+      sum += i;
+      fiber_ptr->suspend();
+    }
+  });
+  fiber_ptr = &fiber;
+  while (!fiber.is_done()) {
+    std::thread([&]() { fiber.resume(); }).join();
+  }
+  EXPECT_EQ(sum, 55);
+}
+
+GTEST_TEST(Fiber, DeepStack) {
+  // touches most of the stack
+  Fiber fiber([]() {
+    volatile char buffer[200 * 1024];
+    for (size_t i = 0; i < sizeof(buffer); i += 4096) {
+      buffer[i] = 1;
+    }
+  });
+  fiber.resume();
+  EXPECT_TRUE(fiber.is_done());
+}
+} // namespace zaf
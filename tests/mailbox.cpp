@@ -0,0 +1,83 @@
+#include <thread>
+#include <vector>
+
+#include "zaf/mailbox.hpp"
+#include "zaf/make_message.hpp"
+#include "zaf/message.hpp"
+
+#include "gtest/gtest.h"
+
+namespace zaf {
+GTEST_TEST(Mailbox, PushAndPop) {
+  Mailbox mailbox;
+  EXPECT_TRUE(mailbox.empty());
+  EXPECT_EQ(mailbox.try_pop(), nullptr);
+
+  for (int i = 0; i < 100; i++) {
+    mailbox.push(new_message(nullptr, Code{0}, i));
+  }
+  EXPECT_FALSE(mailbox.empty());
+  for (int i = 0; i < 100; i++) {
+    auto m = mailbox.try_pop();
+    ASSERT_NE(m, nullptr);
+    std::vector<std::uintptr_t> ptrs(1);
+    static_cast<MemoryMessageBody&>(m->get_body()).get_element_ptrs(ptrs);
+    EXPECT_EQ(*reinterpret_cast<int*>(ptrs[0]), i);
+    delete m;
+  }
+  EXPECT_TRUE(mailbox.empty());
+  EXPECT_EQ(mailbox.try_pop(), nullptr);
+}
+
+GTEST_TEST(Mailbox, PrepareWait) {
+  Mailbox mailbox;
+  EXPECT_TRUE(mailbox.prepare_wait());
+  mailbox.push(new_message(nullptr, Code{0}));
+  // a message arrives after prepare_wait, the reader must not wait
+  EXPECT_FALSE(mailbox.prepare_wait());
+  delete mailbox.try_pop();
+  EXPECT_TRUE(mailbox.prepare_wait());
+}
+
+GTEST_TEST(Mailbox, DeleteRemainingMessages) {
+  auto mailbox = std::make_unique<Mailbox>();
+  for (int i = 0; i < 10; i++) {
+    mailbox->push(new_message(nullptr, Code{0}, std::string("Remaining")));
+  }
+  mailbox = nullptr;
+}
+
+GTEST_TEST(Mailbox, MultiWriters) {
+  const int W = 4;
+  const int num_messages = 100000;
+  Mailbox mailbox;
+
+  std::thread writers[W];
+  for (int w = 0; w < W; w++) {
+    writers[w] = std::thread([&, w]() {
+      for (int i = 0; i < num_messages; i++) {
+        mailbox.push(new_message(nullptr, Code(w), i));
+      }
+    });
+  }
+
+  int next[W] = {0};
+  std::vector<std::uintptr_t> ptrs(1);
+  for (int num_recv = 0; num_recv < W * num_messages;) {
+    if (auto m = mailbox.try_pop()) {
+      auto w = m->get_body().get_code();
+      static_cast<MemoryMessageBody&>(m->get_body()).get_element_ptrs(ptrs);
+      // messages from the same writer are in order
+      EXPECT_EQ(*reinterpret_cast<int*>(ptrs[0]), next[w]++);
+      delete m;
+      ++num_recv;
+    } else {
+      mailbox.prepare_wait();
+    }
+  }
+  for (int w = 0; w < W; w++) {
+    writers[w].join();
+  }
+  EXPECT_TRUE(mailbox.empty());
+}
+} // namespace zaf
@@ -1,3 +1,4 @@
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -102,4 +103,115 @@ GTEST_TEST(MessageHandler, TypeMismatch) {
   auto m = make_message(nullptr, 0, "123");
   EXPECT_ANY_THROW(handlers.process(m));
 }
+
+GTEST_TEST(MessageHandler, CompatibleContent) {
+  int x = 1;
+  std::string s = "Hello";
+  MessageHandlers handlers = {
+    zaf::Code{0} - [&](int& a, const std::string& b) {
+      a *= 2;
+      EXPECT_EQ(b, "Hello");
+    }
+  };
+  {
+    // the content is exactly std::tuple<int, std::string>
+    auto m = make_message(nullptr, 0, x, s);
+    handlers.process(m);
+    EXPECT_EQ(x, 1);
+  }
+  {
+    // the content is std::tuple<int&, const std::string&>, which has the same type hash
+    auto m = make_message(nullptr, 0, std::ref(x), std::cref(s));
+    handlers.process(m);
+    EXPECT_EQ(x, 2);
+  }
+}
+
+GTEST_TEST(MessageHandler, DenseAndSparseCodes) {
+  std::vector<size_t> codes;
+  MessageHandlers handlers = {
+    zaf::Code{3} - [&]() { codes.push_back(3); },
+    zaf::Code{100000} - [&]() { codes.push_back(100000); },
+    zaf::Code{DefaultCodes::ZAFCodeBase + 100} - [&]() {
+      codes.push_back(DefaultCodes::ZAFCodeBase + 100);
+    }
+  };
+  for (size_t code : {size_t(3), size_t(100000), DefaultCodes::ZAFCodeBase + 100}) {
+    auto m = make_message(nullptr, code);
+    handlers.process(m);
+  }
+  EXPECT_EQ(codes, (std::vector<size_t>{3, 100000, DefaultCodes::ZAFCodeBase + 100}));
+  for (size_t code : {size_t(2), size_t(4), size_t(99999), DefaultCodes::ZAFCodeBase + 99}) {
+    auto m = make_message(nullptr, code);
+    EXPECT_ANY_THROW(handlers.process(m));
+  }
+
+  // many sparse codes
+  size_t sum = 0;
+  for (size_t i = 1; i <= 20; i++) {
+    handlers.update_handlers(zaf::Code{i * 1000003} - [&, i]() { sum += i; });
+  }
+  for (size_t i = 1; i <= 20; i++) {
+    auto m = make_message(nullptr, i * 1000003);
+    handlers.process(m);
+    auto n = make_message(nullptr, i * 1000003 + 1);
+    EXPECT_ANY_THROW(handlers.process(n));
+  }
+  EXPECT_EQ(sum, 210u);
+  EXPECT_EQ(handlers.size(), 23u);
+}
+
+GTEST_TEST(MessageHandler, ChildHandlers) {
+  std::string trace;
+  MessageHandlers parent = {
+    zaf::Code{0} - [&]() { trace += "p0"; },
+    zaf::Code{DefaultCodes::ZAFCodeBase + 100} - [&]() { trace += "pz"; }
+  };
+  MessageHandlers child = {
+    zaf::Code{0} - [&]() { trace += "c0"; },
+    zaf::Code{1} - [&]() { trace += "c1"; },
+    zaf::Code{DefaultCodes::DefaultMessageHandler} - [&](Message&) { trace += "cd"; }
+  };
+  parent.add_child_handlers(child);
+  for (size_t code : {size_t(0), size_t(1), size_t(2), DefaultCodes::ZAFCodeBase + 100}) {
+    auto m = make_message(nullptr, code);
+    parent.process(m);
+  }
+  // the handlers of the parent take precedence, while the default handler of the child is used
+  EXPECT_EQ(trace, "p0c1cdpz");
+
+  // the merged handlers are updated with the child
+  trace.clear();
+  child.update_handlers(zaf::Code{1} - [&]() { trace += "u1"; });
+  {
+    auto m = make_message(nullptr, 1);
+    parent.process(m);
+  }
+  MessageHandlers another_child = {
+    zaf::Code{1} - [&]() { trace += "a1"; }
+  };
+  parent.add_child_handlers(another_child);
+  {
+    auto m = make_message(nullptr, 1);
+    parent.process(m);
+    // the body is processed without the default handler
+    EXPECT_TRUE(parent.try_process_body(m.get_body()));
+    auto n = make_message(nullptr, 2);
+    EXPECT_FALSE(parent.try_process_body(n.get_body()));
+  }
+  EXPECT_EQ(trace, "u1a1a1");
+
+  // nested child handlers
+  trace.clear();
+  another_child.add_child_handlers(child);
+  for (size_t code : {size_t(0), size_t(1), size_t(2)}) {
+    auto m = make_message(nullptr, code);
+    parent.process(m);
+  }
+  EXPECT_EQ(trace, "p0a1cd");
+
+  parent.remove_child_handlers();
+  auto m = make_message(nullptr, 1);
+  EXPECT_ANY_THROW(parent.process(m));
+}
 } // namespace zaf
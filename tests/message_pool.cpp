@@ -0,0 +1,70 @@
+#include <array>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "zaf/make_message.hpp"
+#include "zaf/message.hpp"
+#include "zaf/message_pool.hpp"
+
+#include "gtest/gtest.h"
+
+namespace zaf {
+GTEST_TEST(MessagePool, ReuseLocally) {
+  std::thread([]() {
+    auto m = new_message(nullptr, Code{0}, 1);
+    delete m;
+    auto stats = MessagePool::get_thread_stats();
+    m = new_message(nullptr, Code{0}, 2);
+    delete m;
+    auto diff = MessagePool::get_thread_stats();
+    EXPECT_EQ(diff.num_allocations - stats.num_allocations, 1);
+    EXPECT_EQ(diff.num_reuses - stats.num_reuses, 1);
+    EXPECT_EQ(diff.num_deallocations - stats.num_deallocations, 1);
+    EXPECT_EQ(diff.num_remote_deallocations, stats.num_remote_deallocations);
+  }).join();
+}
+
+GTEST_TEST(MessagePool, ReturnToOwner) {
+  const int num_messages = 1000;
+  std::vector<Message*> messages;
+  std::thread([&]() {
+    for (int i = 0; i < num_messages; i++) {
+      messages.push_back(new_message(nullptr, Code{0}, i, std::string("Return")));
+    }
+    // the owner is alive when another thread frees the messages
+    std::thread([&]() {
+      // the counters are kept by the thread that frees the messages
+      auto stats = MessagePool::get_thread_stats();
+      for (auto m : messages) {
+        delete m;
+      }
+      MessagePool::flush_returns();
+      auto diff = MessagePool::get_thread_stats();
+      EXPECT_EQ(diff.num_remote_deallocations - stats.num_remote_deallocations, num_messages);
+      EXPECT_EQ(diff.num_returned_batches - stats.num_returned_batches, (num_messages + 31) / 32);
+    }).join();
+
+    // the owner reuses the returned blocks
+    auto stats = MessagePool::get_thread_stats();
+    for (int i = 0; i < num_messages; i++) {
+      messages[i] = new_message(nullptr, Code{0}, i, std::string("Return"));
+    }
+    auto diff = MessagePool::get_thread_stats();
+    EXPECT_EQ(diff.num_reuses - stats.num_reuses, num_messages);
+    for (auto m : messages) {
+      delete m;
+    }
+  }).join();
+}
+
+GTEST_TEST(MessagePool, LargeMessage) {
+  auto stats = MessagePool::get_thread_stats();
+  auto m = new_message(nullptr, Code{0}, std::array<char, 4096>{});
+  delete m;
+  auto body = new_message(Code{0}, std::array<char, 4096>{});
+  delete body;
+  auto diff = MessagePool::get_thread_stats();
+  EXPECT_EQ(diff.num_large_allocations - stats.num_large_allocations, 2);
+}
+} // namespace zaf
@@ -0,0 +1,161 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "zaf/actor_engine.hpp"
+#include "zaf/actor_system.hpp"
+#include "zaf/mailbox.hpp"
+#include "zaf/make_message.hpp"
+#include "zaf/metrics.hpp"
+
+#include "gtest/gtest.h"
+
+namespace zaf {
+namespace {
+class Counter : public ActorBehavior {
+public:
+  Counter(int n, std::atomic<int>& total):
+    n(n),
+    total(total) {
+  }
+
+  void start() override {
+    this->send(*this, 0, 0);
+  }
+
+  MessageHandlers behavior() override {
+    return {
+      Code{0} - [&](int i) {
+        total++;
+        if (i + 1 == n) {
+          this->deactivate();
+        } else {
+          this->send(*this, 0, i + 1);
+        }
+      }
+    };
+  }
+
+  const int n;
+  std::atomic<int>& total;
+};
+} // namespace
+
+GTEST_TEST(Metrics, LatencyHistogram) {
+  LatencyHistogram histogram;
+  for (int i = 0; i < 99; i++) {
+    histogram.record(100);
+  }
+  histogram.record(1000000);
+  auto stats = histogram.get_stats();
+  EXPECT_EQ(stats.count, 100u);
+  EXPECT_EQ(stats.sum_ns, 99u * 100 + 1000000);
+  // 100ns is in [64, 128)
+  EXPECT_EQ(stats.percentile_ns(50), 127u);
+  EXPECT_EQ(stats.percentile_ns(99), 127u);
+  // 1ms is in [2^19, 2^20)
+  EXPECT_EQ(stats.percentile_ns(100), (1u << 20) - 1);
+  EXPECT_EQ(LatencyHistogram{}.get_stats().percentile_ns(50), 0u);
+}
+
+GTEST_TEST(Metrics, MailboxDepth) {
+  if (!ENABLE_METRICS) {
+    GTEST_SKIP() << "ZAF is built without ENABLE_METRICS";
+  }
+  Mailbox mailbox;
+  for (int i = 0; i < 10; i++) {
+    mailbox.push(new_message(nullptr, Code{0}, i));
+  }
+  EXPECT_EQ(mailbox.approx_size(), 10u);
+  delete mailbox.try_pop();
+  EXPECT_EQ(mailbox.approx_size(), 9u);
+}
+
+GTEST_TEST(Metrics, ActorCounters) {
+  if (!ENABLE_METRICS) {
+    GTEST_SKIP() << "ZAF is built without ENABLE_METRICS";
+  }
+  ActorSystem actor_system;
+  auto sender = actor_system.create_scoped_actor();
+  auto receiver = actor_system.create_scoped_actor();
+  for (int i = 0; i < 100; i++) {
+    sender->send(*receiver, Code{0}, i);
+  }
+  auto snapshot = actor_system.snapshot_metrics();
+  ASSERT_EQ(snapshot.actors.size(), 2u);
+  auto find = [&](ActorIdType id) {
+    for (auto& a : snapshot.actors) {
+      if (a.actor_id == id) {
+        return a;
+      }
+    }
+    return ActorMetrics::Stats{};
+  };
+  EXPECT_EQ(find(sender->get_actor_id()).messages_sent, 100u);
+  EXPECT_EQ(find(receiver->get_actor_id()).mailbox_depth, 100u);
+  for (int i = 0; i < 100; i++) {
+    receiver->receive_once({
+      Code{0} - [](int) {}
+    });
+  }
+  snapshot = actor_system.snapshot_metrics();
+  auto stats = find(receiver->get_actor_id());
+  EXPECT_EQ(stats.messages_received, 100u);
+  EXPECT_EQ(stats.mailbox_depth, 0u);
+  EXPECT_EQ(stats.handler_ns.count, 100 / ActorMetrics::HandlerSamplingPeriod);
+  EXPECT_EQ(stats.name, receiver->get_name());
+}
+
+GTEST_TEST(Metrics, ExecutorCounters) {
+  if (!ENABLE_METRICS) {
+    GTEST_SKIP() << "ZAF is built without ENABLE_METRICS";
+  }
+  for (auto scheduling : {ActorEngine::Scheduling::Polling, ActorEngine::Scheduling::WorkStealing}) {
+    ActorSystem actor_system;
+    ActorEngine engine{actor_system, 2, scheduling};
+    std::atomic<int> num_received{0};
+    for (int i = 0; i < 4; i++) {
+      engine.spawn<Counter>(100, num_received);
+    }
+    engine.await_all_actors_done();
+    EXPECT_EQ(num_received.load(), 400);
+    auto snapshot = actor_system.snapshot_metrics();
+    ASSERT_EQ(snapshot.executors.size(), 2u);
+    // an executor may not have run yet when the other one runs all the actors
+    uint64_t runs = 0, ns = 0;
+    for (auto& e : snapshot.executors) {
+      runs += e.runs;
+      ns += e.busy_ns + e.idle_ns;
+    }
+    EXPECT_GT(runs, 0u);
+    EXPECT_GT(ns, 0u);
+    engine.terminate();
+  }
+}
+
+GTEST_TEST(Metrics, Dump) {
+  auto path = testing::TempDir() + "zaf_metrics_dump.json";
+  std::remove(path.c_str());
+  {
+    ActorSystem actor_system;
+    auto actor = actor_system.create_scoped_actor();
+    actor_system.dump_metrics(path, std::chrono::milliseconds{10});
+    std::this_thread::sleep_for(std::chrono::milliseconds{50});
+    actor_system.stop_dumping_metrics();
+  }
+  std::ifstream in(path);
+  std::string line;
+  int num_lines = 0;
+  while (std::getline(in, line)) {
+    EXPECT_EQ(line.front(), '{');
+    EXPECT_EQ(line.back(), '}');
+    EXPECT_NE(line.find("\"actors\":["), std::string::npos);
+    num_lines++;
+  }
+  EXPECT_GE(num_lines, 2);
+  std::remove(path.c_str());
+}
+} // namespace zaf
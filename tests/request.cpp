@@ -1,3 +1,6 @@
+#include <functional>
+#include <vector>
+
 #include "zaf/actor_behavior.hpp"
 #include "zaf/actor_system.hpp"
 
@@ -201,4 +204,241 @@ GTEST_TEST(Request, UnorderedRequest) {
     }
   });
 }
+
+GTEST_TEST(Request, ThenStoredResponse) {
+  ActorSystem actor_system;
+
+  ActorBehavior actor1;
+  actor1.initialize_actor(actor_system, actor_system);
+
+  ActorBehavior actor2;
+  actor2.initialize_actor(actor_system, actor_system);
+
+  auto req = actor1.request(actor2, 0, 21);
+  actor2.receive_once({
+    Code{0} - [&](int v) { actor2.reply(1, v * 2); }
+  });
+  // the response is stored by actor1 before `then` is called
+  actor1.receive_once({});
+
+  int r = 0;
+  req.then({
+    Code{1} - [&](int v) { r = v; }
+  });
+  EXPECT_EQ(r, 42);
+}
+
+GTEST_TEST(Request, ThenChain) {
+  ActorSystem actor_system;
+
+  auto a = actor_system.spawn([&](ActorBehavior& self) {
+    self.receive({
+      Code{0} - [&](int v) { self.reply(0, v * 2); },
+      Code{1} - [&]() { self.deactivate(); }
+    });
+  });
+
+  std::vector<int> results;
+  int num_others = 0;
+  actor_system.spawn([&](ActorBehavior& self) {
+    // each continuation issues the next request while other messages keep being processed
+    std::function<void(int)> next = [&](int v) {
+      results.push_back(v);
+      if (results.size() == 3) {
+        self.send(a, 1);
+        self.send(self, 3);
+        return;
+      }
+      self.request(a, 0, v).then({
+        Code{0} - [&](int r) { next(r); }
+      });
+      self.send(self, 2);
+    };
+    next(1);
+    self.receive({
+      Code{2} - [&]() { num_others++; },
+      Code{3} - [&]() { self.deactivate(); }
+    });
+  });
+  actor_system.await_all_actors_done();
+  EXPECT_EQ(results, (std::vector<int>{1, 2, 4}));
+  EXPECT_EQ(num_others, 2);
+}
+
+GTEST_TEST(Request, ThenTimeout) {
+  ActorSystem actor_system;
+
+  // replies to the second request only
+  auto a = actor_system.spawn([&](ActorBehavior& self) {
+    self.receive_once({
+      Code{0} - [&](int) {}
+    });
+    self.receive_once({
+      Code{0} - [&](int v) { self.reply(0, v); }
+    });
+  });
+
+  int num_timeouts = 0, num_replies = 0;
+  actor_system.spawn([&](ActorBehavior& self) {
+    self.request(a, 0, 1).then({
+      Code{0} - [&](int) { num_replies++; }
+    }, std::chrono::milliseconds{20}, [&]() {
+      num_timeouts++;
+      self.request(a, 0, 2).then({
+        Code{0} - [&](int v) {
+          EXPECT_EQ(v, 2);
+          num_replies++;
+          self.deactivate();
+        }
+      }, std::chrono::seconds{10}, [&]() {
+        num_timeouts++;
+        self.deactivate();
+      });
+    });
+    self.receive({});
+  });
+  actor_system.await_all_actors_done();
+  EXPECT_EQ(num_timeouts, 1);
+  EXPECT_EQ(num_replies, 1);
+}
+
+GTEST_TEST(Request, OnReplyTimeout) {
+  ActorSystem actor_system;
+
+  ActorBehavior actor1;
+  actor1.initialize_actor(actor_system, actor_system);
+
+  ActorBehavior actor2;
+  actor2.initialize_actor(actor_system, actor_system);
+
+  int r = 0;
+  auto req = actor1.request(actor2, 0, 1);
+  EXPECT_FALSE(req.on_reply({
+    Code{1} - [&](int v) { r = v; }
+  }, std::chrono::milliseconds{20}));
+  EXPECT_FALSE(actor1.get_next_delayed_message_time());
+
+  // the late response is dropped when the next request waits for its response
+  actor2.receive_once({
+    Code{0} - [&](int v) { actor2.reply(1, v); }
+  });
+  auto req2 = actor1.request(actor2, 0, 2);
+  actor2.receive_once({
+    Code{0} - [&](int v) { actor2.reply(1, v); }
+  });
+  EXPECT_TRUE(req2.on_reply({
+    Code{1} - [&](int v) { r = v; }
+  }, std::chrono::seconds{10}));
+  EXPECT_EQ(r, 2);
+  EXPECT_FALSE(actor1.get_next_delayed_message_time());
+}
+
+GTEST_TEST(Request, OnReplyWithinTimeout) {
+  ActorSystem actor_system;
+
+  auto a = actor_system.spawn([&](ActorBehavior& self) {
+    self.receive_once({
+      Code{0} - [&](int v) { self.reply(1, v * 2); }
+    });
+  });
+
+  int r = 0;
+  bool replied = false;
+  actor_system.spawn([&](ActorBehavior& self) {
+    replied = self.request(a, 0, 21).on_reply({
+      Code{1} - [&](int v) { r = v; }
+    }, std::chrono::seconds{10});
+    // the deadline is removed once the response arrives
+    EXPECT_FALSE(self.get_next_delayed_message_time());
+  });
+  actor_system.await_all_actors_done();
+  EXPECT_TRUE(replied);
+  EXPECT_EQ(r, 42);
+}
+
+GTEST_TEST(Request, Cancel) {
+  ActorSystem actor_system;
+
+  ActorBehavior actor1;
+  actor1.initialize_actor(actor_system, actor_system);
+
+  ActorBehavior actor2;
+  actor2.initialize_actor(actor_system, actor_system);
+
+  int r = 0;
+  auto req = actor1.request(actor2, 0, 1);
+  req.then({
+    Code{1} - [&](int v) { r = v; }
+  }, std::chrono::seconds{10}, [&]() { r = -1; });
+  EXPECT_TRUE(actor1.get_next_delayed_message_time());
+
+  auto req2 = actor1.request(actor2, 0, 2);
+  req2.cancel();
+  EXPECT_THROW(req2.cancel(), ZAFException);
+
+  // the response of the cancelled request is dropped
+  for (int i = 0; i < 2; i++) {
+    actor2.receive_once({
+      Code{0} - [&](int v) { actor2.reply(1, v); }
+    });
+  }
+  actor1.receive_once({});
+  actor1.receive_once({});
+  EXPECT_EQ(r, 1);
+  EXPECT_FALSE(actor1.get_next_delayed_message_time());
+}
+
+GTEST_TEST(Request, CancelAfterThen) {
+  ActorSystem actor_system;
+
+  ActorBehavior actor1;
+  actor1.initialize_actor(actor_system, actor_system);
+
+  ActorBehavior actor2;
+  actor2.initialize_actor(actor_system, actor_system);
+
+  int r = 0;
+  auto req = actor1.request(actor2, 0, 1);
+  req.then({
+    Code{1} - [&](int v) { r = v; }
+  }, std::chrono::seconds{10}, [&]() { r = -1; });
+  EXPECT_TRUE(req.cancel());
+  EXPECT_THROW(req.cancel(), ZAFException);
+  // the deadline is removed together with the request
+  EXPECT_FALSE(actor1.get_next_delayed_message_time());
+
+  // cancel by the request id as the handler of a request is usually gone after `then`
+  unsigned req_id;
+  {
+    auto req2 = actor1.request(actor2, 0, 2);
+    req_id = req2.get_request_id();
+    req2.then({
+      Code{1} - [&](int v) { r = v; }
+    });
+  }
+  EXPECT_TRUE(actor1.cancel_request(req_id));
+  EXPECT_FALSE(actor1.cancel_request(req_id));
+
+  // the responses of the cancelled requests are dropped
+  for (int i = 0; i < 2; i++) {
+    actor2.receive_once({
+      Code{0} - [&](int v) { actor2.reply(1, v); }
+    });
+  }
+  actor1.receive_once({});
+  actor1.receive_once({});
+  EXPECT_EQ(r, 0);
+
+  // a request cannot be cancelled once its response is processed
+  auto req3 = actor1.request(actor2, 0, 3);
+  req3.then({
+    Code{1} - [&](int v) { r = v; }
+  });
+  actor2.receive_once({
+    Code{0} - [&](int v) { actor2.reply(1, v); }
+  });
+  actor1.receive_once({});
+  EXPECT_EQ(r, 3);
+  EXPECT_FALSE(req3.cancel());
+}
 } // namespace zaf
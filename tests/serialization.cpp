@@ -4,6 +4,8 @@
 #include <map>
 #include <memory>
 #include <set>
+#include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -13,6 +15,7 @@
 #include "zaf/count_pointer.hpp"
 #include "zaf/macros.hpp"
 #include "zaf/message.hpp"
+#include "zaf/message_bytes.hpp"
 #include "zaf/message_handler.hpp"
 #include "zaf/serializer.hpp"
 
@@ -313,4 +316,167 @@ GTEST_TEST(SerializedMessage, Tuple) {
     EXPECT_EQ(a, b);
   }
 }
+
+GTEST_TEST(SerializedMessage, Views) {
+  std::string str = "Hello World";
+  std::vector<double> doubles{1.5, 2.5, 3.5};
+  std::vector<char> chars{'a', 'b', 'c'};
+  const char* viewed_str = nullptr;
+  MessageHandlers handlers = {
+    Code{0} - [&](std::string_view a, span<const double> b, const BytesView& c) {
+      viewed_str = a.data();
+      EXPECT_EQ(a, "Hello World");
+      EXPECT_EQ(b.to_vector(), doubles);
+      double sum = 0;
+      for (auto x : b) {
+        sum += x;
+      }
+      EXPECT_EQ(sum, 7.5);
+      EXPECT_EQ(b[1], 2.5);
+      EXPECT_EQ(c.to_vector(), chars);
+    }
+  };
+  {
+    // the views point to the content of the message in memory
+    auto m = make_message(nullptr, 0, str, doubles, chars);
+    handlers.process(m);
+    EXPECT_NE(viewed_str, str.data());
+    viewed_str = nullptr;
+  }
+  {
+    // the views point into the bytes of the serialized message
+    auto m = make_message(nullptr, 0, str, doubles, chars);
+    auto s = make_serialized_message(m);
+    handlers.process(s);
+    ASSERT_NE(viewed_str, nullptr);
+    EXPECT_NE(viewed_str, str.data());
+  }
+  {
+    std::vector<char> bytes;
+    Serializer s(bytes);
+    s.write(std::string_view(str), span<const double>(doubles), BytesView(chars));
+    Deserializer d(bytes);
+    auto a = d.read<std::string>();
+    auto b = d.read<std::vector<double>>();
+    auto c = d.read<BytesView>();
+    EXPECT_EQ(a, str);
+    EXPECT_EQ(b, doubles);
+    EXPECT_EQ(c.data(), &bytes.back() - 2);
+  }
+}
+
+GTEST_TEST(SerializedMessage, PodVector) {
+  std::vector<Y> ys{{1}, {2}, {3}};
+  std::vector<char> bytes;
+  Serializer(bytes).write(ys);
+  // the same bytes as writing the size and then the elements one by one
+  std::vector<char> expected;
+  Serializer e(expected);
+  e.write(ys.size());
+  for (auto& y : ys) {
+    e.write(y);
+  }
+  EXPECT_EQ(bytes, expected);
+
+  Deserializer d(bytes);
+  auto read_ys = d.read<std::vector<Y>>();
+  ASSERT_EQ(read_ys.size(), ys.size());
+  for (size_t i = 0; i < ys.size(); i++) {
+    EXPECT_EQ(read_ys[i].a, ys[i].a);
+  }
+  EXPECT_EQ(d.remaining(), 0u);
+}
+
+GTEST_TEST(SerializedMessage, CorruptBytes) {
+  std::vector<char> bytes;
+  Serializer(bytes).write(std::vector<int>{1, 2, 3}, std::string("Hello"));
+  // truncated bytes are rejected instead of being over-read
+  for (size_t n = 0; n < bytes.size(); n++) {
+    Deserializer d(bytes.data(), n);
+    EXPECT_ANY_THROW((d.read<std::vector<int>>(), d.read<std::string>()));
+  }
+  // a corrupt size is rejected before allocating the memory
+  std::vector<char> corrupt;
+  Serializer(corrupt).write(~size_t(0) / 8, 1, 2, 3);
+  EXPECT_ANY_THROW(Deserializer(corrupt).read<std::vector<int>>());
+  EXPECT_ANY_THROW(Deserializer(corrupt).read<std::vector<std::string>>());
+  EXPECT_ANY_THROW(Deserializer(corrupt).read<std::string>());
+  // a size whose number of bytes overflows to that of one element
+  std::vector<char> overflow;
+  Serializer(overflow).write((size_t(1) << 61) + 1, 1.0);
+  EXPECT_ANY_THROW(Deserializer(overflow).read<span<const double>>());
+}
+
+GTEST_TEST(SerializedMessage, SerializedSize) {
+  auto expect_exact = [](auto&& x) {
+    std::vector<char> bytes;
+    Serializer(bytes).write(x);
+    EXPECT_EQ(serialized_size(x), bytes.size());
+  };
+  expect_exact(1);
+  expect_exact(Y{2});
+  expect_exact(std::string("Hello"));
+  expect_exact(std::string_view("Hello"));
+  expect_exact(std::vector<int>{1, 2, 3});
+  expect_exact(std::vector<std::string>{"a", "bc"});
+  expect_exact(std::map<int, std::string>{{1, "a"}, {2, "bc"}});
+  expect_exact(std::make_pair(1, std::string("a")));
+  expect_exact(std::make_tuple(1, 2.0, std::string("abc")));
+  expect_exact(std::array<int, 3>{1, 2, 3});
+}
+
+GTEST_TEST(SerializedMessage, MessageBytes) {
+  LocalActorHandle send{1, false}, recv{2, true};
+  auto m = MessageBytes::make(send, recv, Code{3}, 4, std::string("Hello"));
+  // the buffer is allocated once with the exact size
+  EXPECT_EQ(m.bytes.size(), m.bytes.capacity());
+  EXPECT_EQ(m.bytes.size(), MessageBytes::HeaderSize + sizeof(int) + sizeof(size_t) + 5);
+
+  Deserializer d(m.bytes);
+  EXPECT_EQ(d.read<LocalActorHandle>(), send);
+  EXPECT_EQ(d.read<LocalActorHandle>(), recv);
+  EXPECT_EQ(d.read<Code>(), 3u);
+  EXPECT_EQ(d.read<size_t>(), (hash_combine(typeid(int).hash_code(), typeid(std::string).hash_code())));
+  auto num_bytes = d.read<unsigned>();
+  EXPECT_EQ(num_bytes, d.remaining());
+  EXPECT_EQ(d.read<int>(), 4);
+  EXPECT_EQ(d.read<std::string>(), "Hello");
+}
+
+GTEST_TEST(SerializedMessage, BatchSlice) {
+  // a batch of two messages, i.e., what NetGate::Receiver receives
+  std::vector<char> bytes;
+  Serializer s(bytes);
+  s.write(std::string("Hello"), 1);
+  auto offset = bytes.size();
+  s.write(std::string("World"), 2);
+  std::shared_ptr<const zmq::message_t> batch =
+    std::make_shared<zmq::message_t>(bytes.data(), bytes.size());
+  const size_t hash = hash_combine(typeid(std::string).hash_code(), typeid(int).hash_code());
+  auto m1 = new TypedMessage<TypedSerializedMessageBody<BatchSlice>>(
+    nullptr, Code{0}, hash, BatchSlice{batch, 0, offset});
+  auto m2 = new TypedMessage<TypedSerializedMessageBody<BatchSlice>>(
+    nullptr, Code{0}, hash, BatchSlice{batch, offset, bytes.size() - offset});
+  EXPECT_EQ(batch.use_count(), 3);
+
+  std::string received;
+  int sum = 0;
+  MessageHandlers handlers = {
+    Code{0} - [&](std::string_view str, int i) {
+      // the view points into the batch
+      EXPECT_GE(str.data(), batch->data<char>());
+      EXPECT_LT(str.data(), batch->data<char>() + batch->size());
+      received += str;
+      sum += i;
+    }
+  };
+  handlers.process(*m1);
+  delete m1;
+  EXPECT_EQ(batch.use_count(), 2);
+  handlers.process(*m2);
+  delete m2;
+  EXPECT_EQ(batch.use_count(), 1);
+  EXPECT_EQ(received, "HelloWorld");
+  EXPECT_EQ(sum, 3);
+}
 } // namespace zaf
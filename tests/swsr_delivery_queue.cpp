@@ -1,5 +1,9 @@
+#include <algorithm>
 #include <condition_variable>
 #include <mutex>
+#include <numeric>
+#include <thread>
+#include <vector>
 
 #include "zaf/swsr_delivery_queue.hpp"
 
@@ -27,6 +31,207 @@ GTEST_TEST(SWSRDeliveryQueue, ToSelfWithResize) {
   EXPECT_EQ(r, 100 * 1000);
 }
 
+GTEST_TEST(SWSRDeliveryQueue, ResizeWhenWrapped) {
+  SWSRDeliveryQueue<int> queue;
+  queue.resize(2);
+
+  int s = 0;
+  int r = 0;
+  // move the read index to 6 such that the items wrap around when the queue is full
+  for (int i = 0; i < 6; i++) {
+    queue.push(s++, SWSRDeliveryQueueFullStrategy::Resize);
+    queue.pop_one([&](int n) { EXPECT_EQ(r++, n); });
+  }
+  for (int i = 0; i < 5; i++) {
+    queue.push(s++, SWSRDeliveryQueueFullStrategy::Resize);
+  }
+  EXPECT_EQ(queue.capacity(), 8u);
+  EXPECT_EQ(queue.pop_some([&](int n) { EXPECT_EQ(r++, n); }, 100u), 5u);
+  EXPECT_EQ(s, r);
+}
+
+GTEST_TEST(SWSRDeliveryQueue, PushN) {
+  SWSRDeliveryQueue<int> queue;
+  queue.resize(3);
+
+  std::vector<int> items(20);
+  std::iota(items.begin(), items.end(), 0);
+  int num_notified = 0;
+  auto notify = [&]() { num_notified++; };
+  EXPECT_EQ(queue.push_n(items.begin(), 5, notify, SWSRDeliveryQueueFullStrategy::Giveup), 5u);
+  EXPECT_EQ(num_notified, 1);
+  // only 3 slots are left
+  EXPECT_EQ(queue.push_n(items.begin() + 5, 5, notify, SWSRDeliveryQueueFullStrategy::Giveup), 3u);
+  EXPECT_EQ(num_notified, 1);
+  EXPECT_TRUE(queue.full());
+
+  int r = 0;
+  EXPECT_EQ(queue.pop_some([&](int n) { EXPECT_EQ(r++, n); }, 100u), 8u);
+  queue.inc_read_progress();
+  // push to self with Resize
+  EXPECT_EQ(queue.push_n(items.begin() + 8, 12, notify, SWSRDeliveryQueueFullStrategy::Resize), 12u);
+  EXPECT_EQ(num_notified, 2);
+  EXPECT_EQ(queue.capacity(), 16u);
+  EXPECT_EQ(queue.pop_some([&](int n) { EXPECT_EQ(r++, n); }, 100u), 12u);
+  EXPECT_EQ(r, 20);
+}
+
+GTEST_TEST(SWSRDeliveryQueue, Segments) {
+  SWSRDeliveryQueue<int> queue;
+  queue.resize(15);
+  // a single segment instead of all the 2^15 slots
+  auto initial = queue.reserved_bytes();
+  EXPECT_GT(initial, 0u);
+  EXPECT_LT(initial, (1u << 15) * sizeof(int) / 16);
+
+  int s = 0;
+  int r = 0;
+  for (int i = 0; i < 10000; i++) {
+    queue.push(s++, SWSRDeliveryQueueFullStrategy::Giveup);
+  }
+  EXPECT_GE(queue.reserved_bytes(), 10000 * sizeof(int));
+  EXPECT_EQ(queue.pop_some([&](int n) { EXPECT_EQ(r++, n); }, 100000u), 10000u);
+  // the segments read past are freed except a spare one
+  EXPECT_LE(queue.reserved_bytes(), 2 * initial);
+  EXPECT_EQ(queue.capacity(), 1u << 15);
+
+  // and reused
+  for (int k = 0; k < 10; k++) {
+    for (int i = 0; i < 1000; i++) {
+      queue.push(s++);
+    }
+    EXPECT_EQ(queue.pop_some([&](int n) { EXPECT_EQ(r++, n); }, 100000u), 1000u);
+    EXPECT_LE(queue.reserved_bytes(), 2 * initial);
+  }
+  EXPECT_EQ(s, r);
+}
+
+GTEST_TEST(SWSRDeliveryQueue, ResizeWithConcurrentReader) {
+  SWSRDeliveryQueue<int> queue;
+  queue.resize(2);
+  const int N = 1000000;
+  std::thread writer([&]() {
+    for (int i = 0; i < N; i++) {
+      queue.push(i, SWSRDeliveryQueueFullStrategy::Resize);
+    }
+  });
+  int r = 0;
+  while (r < N) {
+    if (queue.pop_some([&](int n) { ASSERT_EQ(r++, n); }, 100u) == 0) {
+      std::this_thread::yield();
+    }
+  }
+  writer.join();
+  EXPECT_TRUE(queue.empty());
+}
+
+GTEST_TEST(SWSRDeliveryQueue, OneToOneBatch) {
+  SWSRDeliveryQueue<int> queue;
+  queue.resize(6);
+
+  int num_messages = 100000;
+
+  std::mutex notifier_mutex;
+  std::condition_variable notifier;
+  bool reader_work = false;
+
+  std::thread writer([&]() {
+    std::vector<int> batch(100);
+    for (int i = 0; i < num_messages; i += batch.size()) {
+      std::iota(batch.begin(), batch.end(), i);
+      // blocks in the middle of a batch when the queue is full
+      queue.push_n(batch.begin(), batch.size(), [&]() {
+        {
+          std::lock_guard<std::mutex> _(notifier_mutex);
+          reader_work = true;
+        }
+        notifier.notify_one();
+      });
+    }
+  });
+
+  std::thread reader([&]() {
+    int num_receive = 0;
+    while (num_receive < num_messages) {
+      queue.pop_some([&](int n) {
+        EXPECT_EQ(n, num_receive++);
+      }, [&]() {
+        std::unique_lock<std::mutex> _(notifier_mutex);
+        notifier.wait(_, [&]() { return reader_work; });
+        reader_work = false;
+      }, 32);
+    }
+  });
+
+  writer.join();
+  reader.join();
+}
+
+GTEST_TEST(SWSRDeliveryQueue, BlockingBackpressure) {
+  SWSRDeliveryQueue<int> queue;
+  queue.resize(2);
+  queue.low_water_mark = 1;
+
+  int num_messages = 1000;
+  std::thread writer([&]() {
+    for (int i = 0; i < num_messages; i++) {
+      queue.push(i);
+    }
+  });
+
+  int num_receive = 0;
+  while (num_receive < num_messages) {
+    if (num_receive % 100 == 0) {
+      // keep the queue full for a while so that the writer parks
+      std::this_thread::sleep_for(std::chrono::milliseconds{5});
+    }
+    queue.pop_some([&](int n) {
+      EXPECT_EQ(n, num_receive++);
+    }, 1u);
+  }
+  writer.join();
+  EXPECT_GT(queue.get_num_stalls(), 0u);
+  EXPECT_GT(queue.get_num_parks(), 0u);
+  EXPECT_LE(queue.get_num_parks(), queue.get_num_stalls());
+}
+
+GTEST_TEST(SWSRDeliveryQueue, PublishWithinBatch) {
+  SWSRDeliveryQueue<int> queue;
+  queue.resize(8);
+  // a parked writer wakes up once the reader frees 64 slots
+  queue.low_water_mark = 192;
+
+  int num_messages = 1024;
+  std::thread writer([&]() {
+    for (int i = 0; i < num_messages; i++) {
+      queue.push(i);
+    }
+  });
+
+  while (!queue.full()) {
+    std::this_thread::yield();
+  }
+  int num_receive = 0;
+  bool writer_progress = false;
+  queue.pop_some([&](int n) {
+    EXPECT_EQ(n, num_receive++);
+    if (num_receive == 64) {
+      // the writer pushes more before the batch ends
+      for (int i = 0; i < 1000 && !writer_progress; i++) {
+        writer_progress = queue.write_index() > queue.capacity();
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+      }
+    }
+  }, 256u);
+  EXPECT_TRUE(writer_progress);
+  while (num_receive < num_messages) {
+    queue.pop_some([&](int n) {
+      EXPECT_EQ(n, num_receive++);
+    });
+  }
+  writer.join();
+}
+
 GTEST_TEST(SWSRDeliveryQueue, OneToOne) {
   SWSRDeliveryQueue<int> queue;
   queue.resize(16);
@@ -65,6 +270,75 @@ GTEST_TEST(SWSRDeliveryQueue, OneToOne) {
   reader.join();
 }
 
+GTEST_TEST(SWSRDeliveryQueue, ReadyList) {
+  using Queue = SWSRDeliveryQueue<int>;
+  const int num_writers = 4, num_messages = 100000;
+  std::vector<Queue> queues(num_writers);
+  SWSRReadyList<Queue> ready_list;
+
+  std::mutex notifier_mutex;
+  std::condition_variable notifier;
+  bool reader_work = false;
+
+  std::vector<std::thread> writers;
+  for (int k = 0; k < num_writers; k++) {
+    queues[k].resize(8);
+    writers.emplace_back([&, k]() {
+      for (int i = 0; i < num_messages; i++) {
+        queues[k].push(i, [&]() {
+          // the queue becomes non-empty, and the reader is notified if it has nothing to read
+          if (ready_list.push(&queues[k])) {
+            {
+              std::lock_guard<std::mutex> _(notifier_mutex);
+              reader_work = true;
+            }
+            notifier.notify_one();
+          }
+        });
+      }
+    });
+  }
+
+  std::vector<int> num_receive(num_writers, 0);
+  std::vector<Queue*> active;
+  for (int total = 0; total < num_writers * num_messages;) {
+    for (auto q = ready_list.take_all(); q; q = q->next_ready) {
+      // a queue is in the ready list only if it is not active
+      EXPECT_EQ(std::count(active.begin(), active.end(), q), 0);
+      active.push_back(q);
+    }
+    for (size_t i = 0; i < active.size();) {
+      auto q = active[i];
+      auto k = q - &queues.front();
+      total += q->pop_some([&](int n) {
+        EXPECT_EQ(n, num_receive[k]++);
+      }, 100u);
+      if (!q->empty()) {
+        i++;
+        continue;
+      }
+      q->inc_read_progress();
+      if (!q->empty() && q->keep_read_progress()) {
+        i++;
+        continue;
+      }
+      active[i] = active.back();
+      active.pop_back();
+    }
+    if (active.empty() && ready_list.prepare_wait()) {
+      std::unique_lock<std::mutex> _(notifier_mutex);
+      notifier.wait(_, [&]() { return reader_work || total == num_writers * num_messages; });
+      reader_work = false;
+    }
+  }
+  for (auto& w : writers) {
+    w.join();
+  }
+  for (int k = 0; k < num_writers; k++) {
+    EXPECT_EQ(num_receive[k], num_messages);
+  }
+}
+
 GTEST_TEST(SWSRDeliveryQueue, OneToOneWithSomeDelay) {
   SWSRDeliveryQueue<int> queue;
   queue.resize(16);
@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "zaf/timer_wheel.hpp"
+
+#include "gtest/gtest.h"
+
+namespace zaf {
+namespace {
+using Clock = std::chrono::steady_clock;
+using std::chrono::milliseconds;
+} // namespace
+
+GTEST_TEST(TimerWheel, Order) {
+  TimerWheel<int> wheel;
+  auto t0 = Clock::now();
+  // added out of order, and some of them share a tick
+  int delays[] = {300, 5, 70, 5, 4200, 1, 70, 300000};
+  for (int i = 0; i < 8; i++) {
+    wheel.add(t0 + milliseconds{delays[i]}, int(i));
+  }
+  EXPECT_EQ(wheel.size(), 8u);
+  std::vector<int> fired;
+  auto collect = [&](int&& i) { fired.push_back(i); };
+  wheel.expire(t0, collect);
+  EXPECT_TRUE(fired.empty());
+  // never fires early
+  wheel.expire(t0 + milliseconds{4}, collect);
+  EXPECT_EQ(fired, std::vector<int>{5});
+  wheel.expire(t0 + milliseconds{301}, collect);
+  EXPECT_EQ(fired, (std::vector<int>{5, 1, 3, 2, 6, 0}));
+  ASSERT_TRUE(wheel.next_time());
+  EXPECT_LE(*wheel.next_time(), t0 + milliseconds{4200});
+  wheel.expire(t0 + milliseconds{300001}, collect);
+  EXPECT_EQ(fired, (std::vector<int>{5, 1, 3, 2, 6, 0, 4, 7}));
+  EXPECT_TRUE(wheel.empty());
+  EXPECT_FALSE(wheel.next_time());
+}
+
+GTEST_TEST(TimerWheel, Cancel) {
+  TimerWheel<std::unique_ptr<int>> wheel;
+  auto t0 = Clock::now();
+  auto h1 = wheel.add(t0 + milliseconds{10}, std::make_unique<int>(1));
+  auto h2 = wheel.add(t0 + milliseconds{10}, std::make_unique<int>(2));
+  auto h3 = wheel.add(t0 + milliseconds{100000}, std::make_unique<int>(3));
+  EXPECT_TRUE(wheel.cancel(h1));
+  EXPECT_FALSE(wheel.cancel(h1));
+  EXPECT_FALSE(wheel.cancel(TimerHandle{}));
+  std::vector<int> fired;
+  wheel.expire(t0 + milliseconds{11}, [&](std::unique_ptr<int>&& i) {
+    fired.push_back(*i);
+    if (*i == 2) {
+      // cancel and add timers in the callback
+      EXPECT_TRUE(wheel.cancel(h3));
+      wheel.add(t0, std::make_unique<int>(4));
+    }
+  });
+  EXPECT_EQ(fired, (std::vector<int>{2, 4}));
+  // the handle of a fired timer refers to nothing even if its slot in the pool is reused
+  auto h5 = wheel.add(t0 + milliseconds{20}, std::make_unique<int>(5));
+  EXPECT_FALSE(wheel.cancel(h2));
+  EXPECT_EQ(wheel.size(), 1u);
+  wheel.clear();
+  EXPECT_FALSE(wheel.cancel(h5));
+  EXPECT_TRUE(wheel.empty());
+}
+
+GTEST_TEST(TimerWheel, Random) {
+  TimerWheel<uint64_t> wheel;
+  auto t0 = Clock::now();
+  std::mt19937_64 rng(2023);
+  // tick -> ids, the timers due at each step are compared in ticks
+  std::multimap<uint64_t, uint64_t> expected;
+  std::map<uint64_t, TimerHandle> handles;
+  uint64_t now = 0, next_id = 0;
+  for (int step = 0; step < 2000; step++) {
+    for (int i = 0; i < 50; i++) {
+      // up to beyond what the top level covers
+      auto delay = rng() % (uint64_t(1) << (1 + rng() % 38));
+      auto id = next_id++;
+      handles[id] = wheel.add(t0 + milliseconds{now + delay}, uint64_t(id));
+      expected.emplace(now + delay, id);
+    }
+    for (int i = 0; i < 10 && !expected.empty(); i++) {
+      auto iter = expected.begin();
+      std::advance(iter, rng() % expected.size());
+      EXPECT_TRUE(wheel.cancel(handles[iter->second]));
+      handles.erase(iter->second);
+      expected.erase(iter);
+    }
+    now += rng() % (uint64_t(1) << (rng() % 30));
+    std::vector<uint64_t> fired;
+    // one more tick for the rounding of t0 to the ticks of the wheel
+    wheel.expire(t0 + milliseconds{now + 1}, [&](uint64_t&& id) {
+      fired.push_back(id);
+      handles.erase(id);
+    });
+    std::vector<uint64_t> due;
+    for (auto iter = expected.begin(); iter != expected.end() && iter->first <= now;) {
+      due.push_back(iter->second);
+      iter = expected.erase(iter);
+    }
+    std::sort(fired.begin(), fired.end());
+    std::sort(due.begin(), due.end());
+    // timers due at `now + 1` may also fire
+    for (auto id : fired) {
+      if (!std::binary_search(due.begin(), due.end(), id)) {
+        auto iter = std::find_if(expected.begin(), expected.end(),
+          [&](auto& e) { return e.second == id; });
+        ASSERT_NE(iter, expected.end());
+        EXPECT_EQ(iter->first, now + 1);
+        expected.erase(iter);
+      }
+    }
+    for (auto id : due) {
+      ASSERT_TRUE(std::binary_search(fired.begin(), fired.end(), id));
+    }
+    ASSERT_EQ(wheel.size(), expected.size());
+  }
+}
+} // namespace zaf
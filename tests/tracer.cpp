@@ -0,0 +1,90 @@
+#include <sstream>
+#include <string>
+
+#include "zaf/actor_system.hpp"
+#include "zaf/tracer.hpp"
+#include "zaf/zaf_exception.hpp"
+
+#include "gtest/gtest.h"
+
+namespace zaf {
+namespace {
+size_t count(const std::string& str, const std::string& pattern) {
+  size_t n = 0;
+  for (auto pos = str.find(pattern); pos != std::string::npos; pos = str.find(pattern, pos + 1)) {
+    n++;
+  }
+  return n;
+}
+} // namespace
+
+GTEST_TEST(Tracer, Disabled) {
+  if (ENABLE_TRACING) {
+    GTEST_SKIP() << "ZAF is built with ENABLE_TRACING";
+  }
+  EXPECT_THROW(tracer::enable(), ZAFException);
+  EXPECT_FALSE(tracer::is_enabled());
+}
+
+GTEST_TEST(Tracer, MessageEvents) {
+  if (!ENABLE_TRACING) {
+    GTEST_SKIP() << "ZAF is built without ENABLE_TRACING";
+  }
+  ActorSystem actor_system;
+  auto sender = actor_system.create_scoped_actor();
+  auto receiver = actor_system.create_scoped_actor();
+  tracer::clear();
+  tracer::enable();
+  for (int i = 0; i < 10; i++) {
+    sender->send(*receiver, Code{0x2a}, i);
+  }
+  for (int i = 0; i < 10; i++) {
+    receiver->receive_once({
+      Code{0x2a} - [](int) {}
+    });
+  }
+  tracer::disable();
+  // not recorded
+  sender->send(*receiver, Code{0x2a}, 0);
+
+  std::stringstream out;
+  tracer::write_chrome_trace(out);
+  auto trace = out.str();
+  EXPECT_EQ(trace.front(), '{');
+  EXPECT_EQ(count(trace, "\"name\":\"send\""), 10u);
+  EXPECT_EQ(count(trace, "\"name\":\"receive\""), 10u);
+  EXPECT_EQ(count(trace, "\"ph\":\"B\""), 10u);
+  EXPECT_EQ(count(trace, "\"ph\":\"E\""), 10u);
+  // each send starts a flow that ends at the handling of the message
+  EXPECT_EQ(count(trace, "\"ph\":\"s\""), 10u);
+  EXPECT_EQ(count(trace, "\"ph\":\"f\""), 10u);
+  EXPECT_EQ(count(trace, "\"from\":" + std::to_string(sender->get_actor_id()) +
+    ",\"to\":" + std::to_string(receiver->get_actor_id()) + ",\"code\":\"0x2a\""), 10u);
+
+  tracer::clear();
+  std::stringstream cleared;
+  tracer::write_chrome_trace(cleared);
+  EXPECT_EQ(count(cleared.str(), "\"name\":\"send\""), 0u);
+}
+
+GTEST_TEST(Tracer, RingBuffer) {
+  if (!ENABLE_TRACING) {
+    GTEST_SKIP() << "ZAF is built without ENABLE_TRACING";
+  }
+  tracer::clear();
+  tracer::enable();
+  // only the last events are kept, and the oldest one of the full buffer is not exported
+  for (size_t i = 0; i < tracer::EventsPerThread + 100; i++) {
+    tracer::record(TraceEventType::NetSend, 1, 0, i, 0);
+  }
+  tracer::disable();
+  std::stringstream out;
+  tracer::write_chrome_trace(out);
+  auto trace = out.str();
+  EXPECT_EQ(count(trace, "\"name\":\"net send\""), tracer::EventsPerThread - 1);
+  EXPECT_EQ(count(trace, "\"messages\":100,"), 0u);
+  EXPECT_EQ(count(trace, "\"messages\":101,"), 1u);
+  EXPECT_EQ(count(trace, "\"messages\":" + std::to_string(tracer::EventsPerThread + 99) + ","), 1u);
+  tracer::clear();
+}
+} // namespace zaf